@@ -113,8 +113,10 @@ SOURCES += \
     caretlist.cpp \
     codesnippetsmanager.cpp \
     colorscheme.cpp \
+    compiler/compilecache.cpp \
     compiler/compilerinfo.cpp \
     compiler/ojproblemcasesrunner.cpp \
+    compiler/processoutputcapture.cpp \
     compiler/projectcompiler.cpp \
     compiler/runner.cpp \
     customfileiconprovider.cpp \
@@ -134,6 +136,7 @@ SOURCES += \
     parser/cpptokenizer.cpp \
     parser/parserutils.cpp \
     parser/statementmodel.cpp \
+    parser/symbolcache.cpp \
     problems/competitivecompenionhandler.cpp \
     problems/freeprojectsetformat.cpp \
     problems/ojproblemset.cpp \
@@ -249,12 +252,14 @@ HEADERS += \
     caretlist.h \
     codesnippetsmanager.h \
     colorscheme.h \
+    compiler/compilecache.h \
     compiler/compiler.h \
     compiler/compilerinfo.h \
     compiler/compilermanager.h \
     compiler/executablerunner.h \
     compiler/filecompiler.h \
     compiler/ojproblemcasesrunner.h \
+    compiler/processoutputcapture.h \
     compiler/projectcompiler.h \
     compiler/runner.h \
     compiler/stdincompiler.h \
@@ -270,6 +275,7 @@ HEADERS += \
     parser/cpptokenizer.h \
     parser/parserutils.h \
     parser/statementmodel.h \
+    parser/symbolcache.h \
     problems/competitivecompenionhandler.h \
     problems/freeprojectsetformat.h \
     problems/ojproblemset.h \
@@ -523,6 +529,9 @@ win32: {
 }
 
 linux: {
+    SOURCES += compiler/caseprocess.cpp
+    HEADERS += compiler/caseprocess.h
+
     # legacy glibc compatibility -- modern Unices have all components in `libc.so`
     LIBS += -lrt -ldl
 
@@ -0,0 +1,218 @@
+/*
+ * Copyright (C) 2020-2022 Roy Qu (royqh1979@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "caseprocess.h"
+#include <QFile>
+#include <QTemporaryFile>
+#include <algorithm>
+#include <sched.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+//same as RPF_REPORT_USAGE of consolepauser
+static const int ReportUsageFlag = 0x0004;
+//address space for shared libraries and thread stacks, added to the RLIMIT_AS backstop
+static const size_t AddressSpaceHeadroom = 256*1024*1024;
+
+static QByteArray readProcFile(const QString& fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QFile::ReadOnly))
+        return QByteArray();
+    return file.readAll();
+}
+
+//value of the key in files like /proc/<pid>/status, -1 if not found
+static qlonglong valueOf(const QByteArray& content, const QByteArray& key)
+{
+    foreach (const QByteArray& line, content.split('\n')) {
+        if (line.startsWith(key))
+            return line.mid(key.length()).trimmed().split(' ').first().toLongLong();
+    }
+    return -1;
+}
+
+CaseProcess::CaseProcess(const QString &launcher, bool useSystemdScope,
+                         size_t memoryLimit, int cpu, QObject *parent):
+    QProcess(parent),
+    mLauncher(launcher),
+    mUseSystemdScope(useSystemdScope && !launcher.isEmpty()),
+    mMemoryLimit(memoryLimit),
+    mCpu(cpu),
+    mProgramPid(0),
+    mUsageReported(false),
+    mCpuTime(0),
+    mCpuTimeSampled(false),
+    mPeakMemory(0),
+    mOomKilled(false)
+{
+}
+
+CaseProcess::~CaseProcess()
+{
+}
+
+void CaseProcess::setCommand(const QString &program, const QStringList &arguments)
+{
+    if (!mLauncher.isEmpty()) {
+        mReportFile = std::make_unique<QTemporaryFile>();
+        if (!mReportFile->open())
+            mReportFile.reset();
+    }
+    if (!mReportFile) {
+        setProgram(program);
+        setArguments(arguments);
+        return;
+    }
+    QStringList args;
+    args.append(QString::number(ReportUsageFlag));
+    args.append(mReportFile->fileName());
+    args.append(program);
+    args.append(arguments);
+    if (mUseSystemdScope) {
+        QStringList scopeArgs{"--user", "--scope", "--quiet", "--collect",
+                    "-p", "OOMPolicy=continue", "-p", "MemorySwapMax=0"};
+        if (mMemoryLimit>0)
+            scopeArgs<<"-p"<<QString("MemoryMax=%1").arg(mMemoryLimit);
+        scopeArgs<<"--"<<mLauncher;
+        setProgram("systemd-run");
+        setArguments(scopeArgs + args);
+    } else {
+        setProgram(mLauncher);
+        setArguments(args);
+    }
+}
+
+void CaseProcess::sample()
+{
+    readReport();
+    sampleProc();
+}
+
+void CaseProcess::finish()
+{
+    readReport();
+    if (!mReportFile)
+        sampleProc();
+}
+
+qulonglong CaseProcess::cpuTime() const
+{
+    return mCpuTime;
+}
+
+bool CaseProcess::cpuTimeSampled() const
+{
+    return mCpuTimeSampled;
+}
+
+qulonglong CaseProcess::peakMemory() const
+{
+    return mPeakMemory;
+}
+
+bool CaseProcess::memoryLimitExceeded() const
+{
+    return mMemoryLimit>0 && (mOomKilled || mPeakMemory>=mMemoryLimit);
+}
+
+bool CaseProcess::systemdScopeAvailable()
+{
+    static const bool available = [](){
+        //the scope must be created, and its memory limit must be set
+        QProcess process;
+        process.start("systemd-run", QStringList{
+                          "--user", "--scope", "--quiet", "--collect",
+                          "-p", "OOMPolicy=continue", "-p", "MemorySwapMax=0",
+                          "-p", "MemoryMax=64M", "--",
+                          "/bin/sh", "-c",
+                          "cat \"/sys/fs/cgroup$(sed -n 's/^0:://p' /proc/self/cgroup)/memory.max\""});
+        if (!process.waitForFinished(5000)) {
+            process.kill();
+            process.waitForFinished();
+            return false;
+        }
+        return process.exitStatus()==QProcess::NormalExit && process.exitCode()==0
+                && process.readAllStandardOutput().trimmed()=="67108864";
+    }();
+    return available;
+}
+
+//runs in the child process forked by QProcess, only async-signal-safe functions can be used
+void CaseProcess::setupChildProcess()
+{
+    if (mCpu>=0) {
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        CPU_SET(mCpu, &cpuSet);
+        sched_setaffinity(0, sizeof(cpuSet), &cpuSet);
+    }
+    if (mMemoryLimit>0 && !mUseSystemdScope) {
+        struct rlimit limit;
+        limit.rlim_cur = 2*mMemoryLimit + AddressSpaceHeadroom;
+        limit.rlim_max = limit.rlim_cur;
+        setrlimit(RLIMIT_AS, &limit);
+    }
+}
+
+void CaseProcess::readReport()
+{
+    if (!mReportFile)
+        return;
+    QByteArray report = readProcFile(mReportFile->fileName());
+    if (mProgramPid==0) {
+        qlonglong pid = valueOf(report, "pid ");
+        if (pid>0)
+            mProgramPid = pid;
+    }
+    qlonglong cpuTime = valueOf(report, "cpu_usec ");
+    if (cpuTime<0)
+        return;
+    //the program is finished
+    mUsageReported = true;
+    mCpuTime = cpuTime / 1000;
+    mCpuTimeSampled = true;
+    qlonglong maxRSS = valueOf(report, "max_rss_kb ");
+    if (maxRSS>0)
+        mPeakMemory = std::max(mPeakMemory, (qulonglong)maxRSS * 1024);
+    //only meaningful in our own scope
+    if (mUseSystemdScope)
+        mOomKilled = valueOf(report, "oom_kill ")>0;
+}
+
+void CaseProcess::sampleProc()
+{
+    if (mUsageReported)
+        return;
+    qint64 pid = mReportFile ? mProgramPid : processId();
+    if (pid==0)
+        return;
+    QByteArray stat = readProcFile(QString("/proc/%1/stat").arg(pid));
+    // the process name may contain spaces
+    int pos = stat.lastIndexOf(')');
+    if (pos>=0) {
+        QList<QByteArray> fields = stat.mid(pos+2).split(' ');
+        //utime and stime are the 14th and 15th fields
+        if (fields.count()>12) {
+            qulonglong ticks = fields[11].toULongLong() + fields[12].toULongLong();
+            mCpuTime = std::max(mCpuTime, ticks * 1000 / sysconf(_SC_CLK_TCK));
+            mCpuTimeSampled = true;
+        }
+    }
+    qlonglong peak = valueOf(readProcFile(QString("/proc/%1/status").arg(pid)), "VmHWM:");
+    if (peak>0)
+        mPeakMemory = std::max(mPeakMemory, (qulonglong)peak * 1024);
+}
@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2020-2022 Roy Qu (royqh1979@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef CASEPROCESS_H
+#define CASEPROCESS_H
+
+#include <QProcess>
+#include <QStringList>
+#include <memory>
+
+class QTemporaryFile;
+
+/**
+ * @brief Runs the program of a problem case on linux, and accounts its cpu time and peak memory
+ *
+ * QProcess reaps the child by itself, so we can't wait4() it. And a child forked from the
+ * ide inherits the ide's peak rss in ru_maxrss. So the program is run by consolepauser
+ * (the launcher), which is small, waits for it, and writes its pid, cpu time and peak rss
+ * to a report file. The program is killed if the launcher is killed.
+ *
+ * If systemd scopes are used, the launcher is run by "systemd-run --user --scope", which
+ * puts it (and the program) in a new cgroup delegated to us, with memory.max set to the
+ * memory limit. The kernel then enforces the limit, and the oom kill is reported as
+ * memory limit exceeded. No cgroup is created or changed by the ide itself.
+ *
+ * Otherwise the memory limit is only approximated: the program's memory is sampled while
+ * it's running and it's stopped when the limit is reached; after it exits, its peak memory
+ * is compared with the limit. As a backstop for programs that allocate faster than they
+ * are sampled, the address space is limited (RLIMIT_AS) to twice the limit, plus room for
+ * shared libraries. Going beyond that makes allocations fail (a runtime error or wrong
+ * answer, not memory limit exceeded), and programs using much more virtual memory than
+ * resident memory (like those built with sanitizers) may fail with it.
+ */
+class CaseProcess : public QProcess
+{
+public:
+    //launcher: path of consolepauser, run the program directly if empty (only sampled)
+    explicit CaseProcess(const QString& launcher, bool useSystemdScope,
+                         size_t memoryLimit, int cpu, QObject *parent = nullptr);
+    CaseProcess(const CaseProcess&)=delete;
+    CaseProcess& operator=(const CaseProcess&)=delete;
+    ~CaseProcess();
+
+    //set the program to run, instead of setProgram()/setArguments()
+    void setCommand(const QString& program, const QStringList& arguments);
+
+    //sample the usage of the running program
+    void sample();
+    //called after the process is finished
+    void finish();
+
+    //cpu time (user+sys) in milliseconds
+    qulonglong cpuTime() const;
+    bool cpuTimeSampled() const;
+    //peak resident memory in bytes
+    qulonglong peakMemory() const;
+    bool memoryLimitExceeded() const;
+
+    //if systemd-run can run a scope with memory limit (checked only once)
+    static bool systemdScopeAvailable();
+protected:
+    void setupChildProcess() override;
+private:
+    void readReport();
+    void sampleProc();
+private:
+    QString mLauncher;
+    bool mUseSystemdScope;
+    size_t mMemoryLimit;
+    int mCpu;
+    std::unique_ptr<QTemporaryFile> mReportFile;
+    qint64 mProgramPid;
+    bool mUsageReported;
+    qulonglong mCpuTime;
+    bool mCpuTimeSampled;
+    qulonglong mPeakMemory;
+    bool mOomKilled;
+};
+
+#endif // CASEPROCESS_H
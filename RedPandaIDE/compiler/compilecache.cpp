@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2020-2022 Roy Qu (royqh1979@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "compilecache.h"
+#include "../utils.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+CompileCache::CompileCache(const QString &cacheDir, qint64 maxSize):
+    mCacheDir(cacheDir),
+    mMaxSize(maxSize),
+    mHits(0),
+    mMisses(0),
+    mSavedHits(0),
+    mSavedMisses(0)
+{
+    QDir().mkpath(mCacheDir);
+    loadStatistics();
+}
+
+QByteArray CompileCache::makeKey(const QString &compiler, const QStringList &arguments, const QByteArray &inputs)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    //the same path may be a different compiler after upgrading
+    QFileInfo info(compiler);
+    hash.addData(info.absoluteFilePath().toUtf8());
+    hash.addData(QByteArray::number(info.size()));
+    hash.addData(QByteArray::number(info.lastModified().toMSecsSinceEpoch()));
+    foreach (const QString& argument, arguments) {
+        hash.addData(argument.toUtf8());
+        hash.addData("\0", 1);
+    }
+    hash.addData(inputs);
+    return hash.result().toHex();
+}
+
+CompileCache::~CompileCache()
+{
+    if (mHits!=mSavedHits || mMisses!=mSavedMisses)
+        saveStatistics();
+}
+
+bool CompileCache::fetch(const QByteArray &key, const QString &outputFile)
+{
+    QString fileName = cachedFileName(key);
+    if (!fileExists(fileName)) {
+        mMisses++;
+        return false;
+    }
+    //the output of the last build is usually still there, and QFile::copy() won't overwrite it
+    QString tempFileName = outputFile + ".cache.tmp";
+    QFile::remove(tempFileName);
+    if (!QFile::copy(fileName, tempFileName))
+        return false;
+    QFile::remove(outputFile);
+    if (!QFile::rename(tempFileName, outputFile)) {
+        QFile::remove(tempFileName);
+        return false;
+    }
+    //used recently, don't remove it when trimming
+    QFile file(fileName);
+    if (file.open(QFile::ReadWrite))
+        file.setFileTime(QDateTime::currentDateTime(), QFile::FileModificationTime);
+    mHits++;
+    return true;
+}
+
+void CompileCache::store(const QByteArray &key, const QString &outputFile)
+{
+    QString fileName = cachedFileName(key);
+    QString tempFileName = fileName + ".tmp";
+    QFile::remove(tempFileName);
+    if (!QFile::copy(outputFile, tempFileName))
+        return;
+    QFile::remove(fileName);
+    if (!QFile::rename(tempFileName, fileName)) {
+        QFile::remove(tempFileName);
+        return;
+    }
+    trim();
+}
+
+int CompileCache::hits() const
+{
+    return mHits;
+}
+
+int CompileCache::misses() const
+{
+    return mMisses;
+}
+
+QString CompileCache::cachedFileName(const QByteArray &key) const
+{
+    return includeTrailingPathDelimiter(mCacheDir) + QString::fromLatin1(key) + ".bin";
+}
+
+void CompileCache::trim()
+{
+    QDir dir(mCacheDir);
+    QFileInfoList files = dir.entryInfoList(QStringList{"*.bin"}, QDir::Files, QDir::Time);
+    qint64 totalSize = 0;
+    foreach (const QFileInfo& info, files) {
+        totalSize += info.size();
+    }
+    //sorted by time, the newest first
+    while (totalSize > mMaxSize && !files.isEmpty()) {
+        QFileInfo info = files.takeLast();
+        if (QFile::remove(info.absoluteFilePath()))
+            totalSize -= info.size();
+    }
+}
+
+void CompileCache::loadStatistics()
+{
+    QList<QByteArray> values = readFileToByteArray(
+                includeTrailingPathDelimiter(mCacheDir) + "statistics").split(' ');
+    if (values.count()==2) {
+        mHits = values[0].toInt();
+        mMisses = values[1].toInt();
+    }
+    mSavedHits = mHits;
+    mSavedMisses = mMisses;
+}
+
+void CompileCache::saveStatistics()
+{
+    QFile file(includeTrailingPathDelimiter(mCacheDir) + "statistics");
+    if (file.open(QFile::WriteOnly | QFile::Truncate)) {
+        file.write(QByteArray::number(mHits) + " " + QByteArray::number(mMisses));
+        mSavedHits = mHits;
+        mSavedMisses = mMisses;
+    }
+}
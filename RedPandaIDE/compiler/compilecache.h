@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2020-2022 Roy Qu (royqh1979@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef COMPILECACHE_H
+#define COMPILECACHE_H
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+
+/**
+ * @brief On-disk cache of the executables and object files built from single files
+ *
+ * Each file is saved by its key, which should be the hash of everything that affects
+ * the output (the preprocessed source, the libraries linked, the compiler and the compile
+ * arguments). When the cache is larger than the max size, the least recently used files
+ * are removed.
+ */
+class CompileCache
+{
+public:
+    explicit CompileCache(const QString& cacheDir, qint64 maxSize);
+    ~CompileCache();
+    /**
+     * @brief make the cache key
+     * @param compiler path of the compiler, its size and modification time are used
+     * @param arguments compile arguments, without the output file name
+     * @param inputs hash of the inputs: the preprocessed source, and the path, size and
+     * modification time of the libraries and object files linked
+     */
+    static QByteArray makeKey(const QString& compiler,
+                              const QStringList& arguments,
+                              const QByteArray& inputs);
+    /**
+     * @brief copy the cached file of the key to outputFile
+     * @return false if it's not in the cache, or the output file can't be replaced.
+     * Only the former is counted as a miss.
+     */
+    bool fetch(const QByteArray& key, const QString& outputFile);
+    void store(const QByteArray& key, const QString& outputFile);
+    int hits() const;
+    int misses() const;
+private:
+    QString cachedFileName(const QByteArray& key) const;
+    void trim();
+    void loadStatistics();
+    void saveStatistics();
+private:
+    QString mCacheDir;
+    qint64 mMaxSize;
+    int mHits;
+    int mMisses;
+    int mSavedHits;
+    int mSavedMisses;
+};
+
+#endif // COMPILECACHE_H
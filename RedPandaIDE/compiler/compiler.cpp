@@ -19,10 +19,15 @@
 #include "utils/escape.h"
 #include "utils/parsearg.h"
 #include "compilermanager.h"
+#include "compilecache.h"
 #include "../systemconsts.h"
 
 #include <cmath>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
 #include <QFileInfo>
+#include <QMutex>
 #include <QProcess>
 #include <QString>
 #include <QTextCodec>
@@ -66,17 +71,32 @@ void Compiler::run()
         mWarningCount = 0;
         QElapsedTimer timer;
         timer.start();
-        runCommand(mCompiler, mArguments, mDirectory, pipedText());
-        for(int i=0;i<mExtraArgumentsList.count();i++) {
-            if (!beforeRunExtraCommand(i))
-                break;
-            QString command = escapeCommandForLog(mExtraCompilersList[i], mExtraArgumentsList[i]);
-            if (mExtraOutputFilesList[i].isEmpty()) {
-                log(tr(" - Command: %1").arg(command));
-            } else {
-                log(tr(" - Command: %1 > %2").arg(command, escapeArgumentForPlatformShell(mExtraOutputFilesList[i], false)));
+        std::unique_ptr<CompileCache> compileCache;
+        QByteArray cacheKey;
+        if (!mOnlyCheckSyntax && !mOutputFile.isEmpty()
+                && pSettings->environment().enableCompileCache() && canUseCompileCache()) {
+            compileCache = std::make_unique<CompileCache>(
+                        includeTrailingPathDelimiter(pSettings->dirs().config())+"compilecache",
+                        (qint64)pSettings->environment().compileCacheSizeLimit()*1024*1024);
+            cacheKey = compileCacheKey();
+        }
+        if (!cacheKey.isEmpty() && !mRebuild && compileCache->fetch(cacheKey, mOutputFile)) {
+            log(tr("The source and compile options are not changed, reuse the output file in the compile cache."));
+        } else {
+            runCommand(mCompiler, mArguments, mDirectory, pipedText());
+            for(int i=0;i<mExtraArgumentsList.count();i++) {
+                if (!beforeRunExtraCommand(i))
+                    break;
+                QString command = escapeCommandForLog(mExtraCompilersList[i], mExtraArgumentsList[i]);
+                if (mExtraOutputFilesList[i].isEmpty()) {
+                    log(tr(" - Command: %1").arg(command));
+                } else {
+                    log(tr(" - Command: %1 > %2").arg(command, escapeArgumentForPlatformShell(mExtraOutputFilesList[i], false)));
+                }
+                runCommand(mExtraCompilersList[i],mExtraArgumentsList[i],mDirectory, pipedText(),mExtraOutputFilesList[i]);
             }
-            runCommand(mExtraCompilersList[i],mExtraArgumentsList[i],mDirectory, pipedText(),mExtraOutputFilesList[i]);
+            if (!cacheKey.isEmpty() && mErrorCount==0 && fileExists(mOutputFile))
+                compileCache->store(cacheKey, mOutputFile);
         }
         log("");
         log(tr("Compile Result:"));
@@ -89,6 +109,8 @@ void Compiler::run()
             log(tr("- Output Size: %1").arg(locale.formattedDataSize(QFileInfo(mOutputFile).size())));
         }
         log(tr("- Compilation Time: %1 secs").arg(timer.elapsed() / 1000.0));
+        if (compileCache)
+            log(tr("- Compile Cache: %1 hits, %2 misses").arg(compileCache->hits()).arg(compileCache->misses()));
     } catch (CompileError e) {
         emit compileErrorOccured(e.reason());
     }
@@ -239,6 +261,11 @@ bool Compiler::beforeRunExtraCommand(int /* idx */)
     return true;
 }
 
+bool Compiler::canUseCompileCache()
+{
+    return false;
+}
+
 void Compiler::processOutput(QString &line)
 {
     if (line == COMPILE_PROCESS_END) {
@@ -703,15 +730,160 @@ bool Compiler::parseForceUTF8ForAutolink(const QString &filename, QSet<QString>
     return false;
 }
 
-void Compiler::runCommand(const QString &cmd, const QStringList &arguments, const QString &workingDir, const QByteArray& inputText, const QString& outputFile)
+QByteArray Compiler::compileCacheKey()
 {
+    //the output file name doesn't affect the output
+    QStringList arguments;
+    for (int i=0;i<mArguments.count();i++) {
+        if (mArguments[i]=="-o") {
+            i++;
+            continue;
+        }
+        arguments.append(mArguments[i]);
+    }
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    //libraries are not in the preprocessed source
+    if (!hashLinkInputs(arguments, hash))
+        return QByteArray();
+    //the preprocessed source contains everything from the included headers, and the
+    //values of the macros like __DATE__ and __TIME__.
+    //It's an extra run of the preprocessor, so a cache miss is a bit slower than no cache.
     QProcess process;
-    mStop = false;
-    bool errorOccurred = false;
-    process.setProgram(cmd);
+    process.setProgram(mCompiler);
+    process.setArguments(arguments + QStringList{"-E"});
+    process.setWorkingDirectory(mDirectory);
+    process.setProcessEnvironment(compilerEnvironment(mCompiler));
+    process.setStandardErrorFile(QProcess::nullDevice());
+    process.start();
+    if (!process.waitForStarted(5000))
+        return QByteArray();
+    process.closeWriteChannel();
+    while (process.state()!=QProcess::NotRunning) {
+        process.waitForReadyRead(100);
+        hash.addData(process.readAllStandardOutput());
+        if (mStop) {
+            process.kill();
+            process.waitForFinished();
+            return QByteArray();
+        }
+    }
+    hash.addData(process.readAllStandardOutput());
+    if (process.exitStatus()!=QProcess::NormalExit || process.exitCode()!=0) {
+        //let the compiler report the errors
+        return QByteArray();
+    }
+    return CompileCache::makeKey(mCompiler, arguments, hash.result());
+}
+
+static void hashInputFile(const QFileInfo& info, QCryptographicHash& hash)
+{
+    hash.addData(info.absoluteFilePath().toUtf8());
+    hash.addData(QByteArray::number(info.size()));
+    hash.addData(QByteArray::number(info.lastModified().toMSecsSinceEpoch()));
+}
+
+bool Compiler::hashLinkInputs(const QStringList &arguments, QCryptographicHash &hash)
+{
+    if (arguments.contains("-c"))
+        return true;
+    QStringList libDirs;
+    QStringList libs;
+    bool linkStatic = false;
+    for (int i=0;i<arguments.count();i++) {
+        const QString& argument = arguments[i];
+        if (argument=="-L" || argument=="-l") {
+            if (i+1>=arguments.count())
+                return false;
+            i++;
+            if (argument=="-L")
+                libDirs.append(arguments[i]);
+            else
+                libs.append(arguments[i]);
+        } else if (argument.startsWith("-L")) {
+            libDirs.append(argument.mid(2));
+        } else if (argument.startsWith("-l")) {
+            libs.append(argument.mid(2));
+        } else if (argument=="-static") {
+            linkStatic = true;
+        } else if (!argument.startsWith("-")) {
+            //object files and libraries given by path
+            QFileInfo info(QDir(mDirectory), argument);
+            if (info.isFile() && info.absoluteFilePath()!=QFileInfo(mFilename).absoluteFilePath())
+                hashInputFile(info, hash);
+        }
+    }
+    if (libs.isEmpty())
+        return true;
+    //-L folders are searched before the compiler's own library folders
+    libDirs += compilerLibraryDirs();
+    foreach (const QString& lib, libs) {
+        QStringList names;
+        if (lib.startsWith(':')) {
+            names.append(lib.mid(1));
+        } else if (linkStatic) {
+            names.append(QString("lib%1.a").arg(lib));
+        } else {
+#if defined(Q_OS_WIN)
+            names += {"lib%1.dll.a", "%1.dll.a", "lib%1.a", "%1.lib", "lib%1.dll", "%1.dll"};
+#elif defined(Q_OS_MACOS)
+            names += {"lib%1.dylib", "lib%1.a"};
+#else
+            names += {"lib%1.so", "lib%1.a"};
+#endif
+            for (QString& name:names)
+                name = name.arg(lib);
+        }
+        //the linker uses the first folder that has the library
+        bool found = false;
+        foreach (const QString& dir, libDirs) {
+            foreach (const QString& name, names) {
+                QFileInfo info(QDir(QDir(mDirectory).absoluteFilePath(dir)), name);
+                if (info.isFile()) {
+                    hashInputFile(info, hash);
+                    found = true;
+                }
+            }
+            if (found)
+                break;
+        }
+        if (!found) {
+            log(tr("Can't find library \"%1\", the compile cache is not used.").arg(lib));
+            return false;
+        }
+    }
+    return true;
+}
+
+QStringList Compiler::compilerLibraryDirs()
+{
+    static QMutex mutex;
+    static QHash<QString, QStringList> dirsCache;
+    QFileInfo info(mCompiler);
+    QString key = info.absoluteFilePath() + "|" + QString::number(info.lastModified().toMSecsSinceEpoch());
+    QMutexLocker locker(&mutex);
+    if (dirsCache.contains(key))
+        return dirsCache.value(key);
+    QProcess process;
+    process.setProgram(mCompiler);
+    process.setArguments(QStringList{"-print-search-dirs"});
+    process.setProcessEnvironment(compilerEnvironment(mCompiler));
+    process.start();
+    if (!process.waitForFinished(5000))
+        return QStringList();
+    QStringList dirs;
+    foreach (const QString& line, QString::fromLocal8Bit(process.readAllStandardOutput()).split('\n')) {
+        if (line.startsWith("libraries: =")) {
+            foreach (const QString& dir, line.mid(12).trimmed().split(QDir::listSeparator(), Qt::SkipEmptyParts))
+                dirs.append(QDir::cleanPath(dir));
+        }
+    }
+    dirsCache.insert(key, dirs);
+    return dirs;
+}
+
+QProcessEnvironment Compiler::compilerEnvironment(const QString &cmd)
+{
     QString cmdDir = extractFileDir(cmd);
-    bool compilerErrorUTF8=compilerSet()->isCompilerInfoUsingUTF8();
-    bool outputUTF8=compilerSet()->forceUTF8();
     QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
 #ifdef Q_OS_WIN
     QStringList binDirs=compilerSet()->binDirs();
@@ -738,7 +910,18 @@ void Compiler::runCommand(const QString &cmd, const QStringList &arguments, cons
     env.insert("LDFLAGS","");
     env.insert("CFLAGS","");
     env.insert("CXXFLAGS","");
-    process.setProcessEnvironment(env);
+    return env;
+}
+
+void Compiler::runCommand(const QString &cmd, const QStringList &arguments, const QString &workingDir, const QByteArray& inputText, const QString& outputFile)
+{
+    QProcess process;
+    mStop = false;
+    bool errorOccurred = false;
+    process.setProgram(cmd);
+    bool compilerErrorUTF8=compilerSet()->isCompilerInfoUsingUTF8();
+    bool outputUTF8=compilerSet()->forceUTF8();
+    process.setProcessEnvironment(compilerEnvironment(cmd));
     process.setArguments(arguments);
     process.setWorkingDirectory(workingDir);
     QFile output;
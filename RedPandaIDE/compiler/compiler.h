@@ -18,11 +18,13 @@
 #define COMPILER_H
 
 #include <QThread>
+#include <QProcessEnvironment>
 #include "settings.h"
 #include "../common.h"
 #include "../parser/cppparser.h"
 
 class Project;
+class QCryptographicHash;
 class Compiler : public QThread
 {
     Q_OBJECT
@@ -70,6 +72,8 @@ protected:
     virtual QByteArray pipedText();
     virtual bool prepareForRebuild() = 0;
     virtual bool beforeRunExtraCommand(int idx);
+    //if the output can be reused from the compile cache
+    virtual bool canUseCompileCache();
     virtual QStringList getCharsetArgument(const QByteArray& encoding, FileType fileType, bool onlyCheckSyntax);
     virtual QStringList getCCompileArguments(bool checkSyntax);
     virtual QStringList getCppCompileArguments(bool checkSyntax);
@@ -85,6 +89,7 @@ protected:
             QSet<QString>& parsedFiles);
     void log(const QString& msg);
     void error(const QString& msg);
+    QProcessEnvironment compilerEnvironment(const QString& cmd);
     void runCommand(const QString& cmd, const QStringList& arguments, const QString& workingDir, const QByteArray& inputText=QByteArray(), const QString& outputFile=QString());
     QString escapeCommandForLog(const QString &cmd, const QStringList &arguments);
 
@@ -107,6 +112,12 @@ protected:
     PCppParser mParserForFile;
     bool mForceEnglishOutput;
 
+private:
+    QByteArray compileCacheKey();
+    //add the libraries and object files linked to the hash, false if a library can't be found
+    bool hashLinkInputs(const QStringList& arguments, QCryptographicHash& hash);
+    //folders searched for libraries by the compiler itself
+    QStringList compilerLibraryDirs();
 private:
     bool mStop;
 };
@@ -381,6 +381,9 @@ void CompilerManager::doRunProblem(const QString &filename, const QString &argum
         execRunner->setExecTimeout(timeLimit);
     if (memoryLimit)
         execRunner->setMemoryLimit(memoryLimit);
+    execRunner->setConcurrency(pSettings->executor().problemCasesConcurrency());
+    execRunner->setValidateType(pSettings->executor().problemCaseValidateType());
+    execRunner->setFailFast(pSettings->executor().problemCaseFailFast());
     connect(mRunner, &Runner::finished, this ,&CompilerManager::onRunnerTerminated);
     connect(mRunner, &Runner::finished, mRunner ,&Runner::deleteLater);
     connect(mRunner, &Runner::finished, pMainWindow ,&MainWindow::onRunProblemFinished);
@@ -190,6 +190,18 @@ bool FileCompiler::prepareForCompile()
     return true;
 }
 
+bool FileCompiler::canUseCompileCache()
+{
+    //only executables and object files, other outputs are for reading
+    if (mCompileType!=CppCompileType::Normal || !mExtraArgumentsList.isEmpty())
+        return false;
+    if (compilerSet()->compilationStage()!=Settings::CompilerSet::CompilationStage::GenerateExecutable
+            && compilerSet()->compilationStage()!=Settings::CompilerSet::CompilationStage::AssemblingOnly)
+        return false;
+    FileType fileType = getFileType(mFilename);
+    return fileType==FileType::CSource || fileType==FileType::CppSource;
+}
+
 bool FileCompiler::prepareForRebuild()
 {
     QString exeName=compilerSet()->getOutputFilename(mFilename);
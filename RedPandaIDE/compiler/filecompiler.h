@@ -31,6 +31,7 @@ public:
 
 protected:
     bool prepareForCompile() override;
+    bool canUseCompileCache() override;
 
 private:
     QByteArray mEncoding;
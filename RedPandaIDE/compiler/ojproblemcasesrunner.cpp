@@ -18,18 +18,64 @@
 #include "../utils.h"
 #include "../settings.h"
 #include "../systemconsts.h"
+#include "../problems/problemcasevalidator.h"
+#include "processoutputcapture.h"
+#include <QAtomicInt>
 #include <QElapsedTimer>
+#include <QMutex>
 #include <QProcess>
+#include <QSemaphore>
+#include <QThreadPool>
+#include <algorithm>
+#include <memory>
 #ifdef Q_OS_WINDOWS
 #include <psapi.h>
 #endif
+#ifdef Q_OS_LINUX
+#include "caseprocess.h"
+#include <sched.h>
+#endif
+
+//output larger than this is saved to a temporary file, and only its beginning is shown
+static const int MaxOutputInMemory = 4*1024*1024;
+//size of the output's last part that's shown while running, after it's too large
+static const int OutputTailSize = 64*1024;
+
+//cpus the ide is allowed to run on, used to pin the cases running concurrently
+static QVector<int> availableCpus()
+{
+    QVector<int> cpus;
+#ifdef Q_OS_LINUX
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    if (sched_getaffinity(0, sizeof(cpuSet), &cpuSet)==0) {
+        for (int i=0;i<CPU_SETSIZE;i++) {
+            if (CPU_ISSET(i, &cpuSet))
+                cpus.append(i);
+        }
+    }
+#elif defined(Q_OS_WIN)
+    DWORD_PTR processMask;
+    DWORD_PTR systemMask;
+    if (GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask)) {
+        for (int i=0;i<(int)sizeof(DWORD_PTR)*8;i++) {
+            if (processMask & ((DWORD_PTR)1<<i))
+                cpus.append(i);
+        }
+    }
+#endif
+    return cpus;
+}
 
 
 OJProblemCasesRunner::OJProblemCasesRunner(const QString& filename, const QStringList& arguments, const QString& workDir,
                                            const QVector<POJProblemCase>& problemCases, QObject *parent):
     Runner(filename,arguments,workDir,parent),
     mExecTimeout(0),
-    mMemoryLimit(0)
+    mMemoryLimit(0),
+    mConcurrency(1),
+    mValidateType(ProblemCaseValidateType::Exact),
+    mFailFast(false)
 {
     mProblemCases = problemCases;
     mBufferSize = 8192;
@@ -41,7 +87,10 @@ OJProblemCasesRunner::OJProblemCasesRunner(const QString& filename, const QStrin
                                            POJProblemCase problemCase, QObject *parent):
     Runner(filename,arguments,workDir,parent),
     mExecTimeout(0),
-    mMemoryLimit(0)
+    mMemoryLimit(0),
+    mConcurrency(1),
+    mValidateType(ProblemCaseValidateType::Exact),
+    mFailFast(false)
 {
     mProblemCases.append(problemCase);
     mBufferSize = 8192;
@@ -55,16 +104,134 @@ void OJProblemCasesRunner::runCase(int index,POJProblemCase problemCase)
     auto action = finally([this,&index, &problemCase]{
         emit caseFinished(problemCase->getId(), index, mProblemCases.count());
     });
+    executeCase(problemCase, -1, nullptr);
+}
+
+void OJProblemCasesRunner::runCasesConcurrently()
+{
+    enum CaseState {
+        Pending,
+        Started,
+        Finished,
+        Skipped
+    };
+    struct RunningCase {
+        POJProblemCase problemCase;
+        CaseRunLog log;
+        QAtomicInt state;
+    };
+    using PRunningCase = std::shared_ptr<RunningCase>;
+
+    int threadCount = std::min(mConcurrency, mProblemCases.count());
+    QVector<int> cpus = availableCpus();
+    if (!cpus.isEmpty())
+        threadCount = std::min(threadCount, cpus.count());
+    // each worker takes a free cpu when starting a case, and gives it back when finished,
+    // so no two cases share the same cpu and their running time is comparable
+    QList<int> freeCpus = cpus.mid(0, threadCount).toList();
+    QMutex cpusMutex;
+    // released by the workers each time a case changes its state
+    QSemaphore stateChanged;
+    QVector<PRunningCase> runningCases;
+    //must be destroyed (and waited for) before the objects used by the workers
+    QThreadPool pool;
+    pool.setMaxThreadCount(threadCount);
+    for (int i=0;i<mProblemCases.count();i++) {
+        PRunningCase runningCase = std::make_shared<RunningCase>();
+        runningCase->problemCase = mProblemCases[i];
+        runningCase->state.storeRelaxed(Pending);
+        runningCases.append(runningCase);
+        pool.start([this, runningCase, &freeCpus, &cpusMutex, &stateChanged](){
+            if (mStop) {
+                runningCase->state.storeRelease(Skipped);
+                stateChanged.release();
+                return;
+            }
+            int cpu = -1;
+            {
+                QMutexLocker locker(&cpusMutex);
+                if (!freeCpus.isEmpty())
+                    cpu = freeCpus.takeFirst();
+            }
+            runningCase->state.storeRelease(Started);
+            stateChanged.release();
+            auto action = finally([runningCase, &stateChanged]{
+                runningCase->state.storeRelease(Finished);
+                stateChanged.release();
+            });
+            executeCase(runningCase->problemCase, cpu, &runningCase->log);
+            if (cpu>=0) {
+                QMutexLocker locker(&cpusMutex);
+                freeCpus.append(cpu);
+            }
+        });
+    }
+    //report cases started and finished in their order, no matter which one is run first
+    int startedCount = 0;
+    int finishedCount = 0;
+    bool skipped = false;
+    while (true) {
+        while (!skipped && startedCount<runningCases.count()) {
+            int state = runningCases[startedCount]->state.loadAcquire();
+            if (state==Pending)
+                break;
+            if (state==Skipped) {
+                //the cases after it are skipped too
+                skipped = true;
+                break;
+            }
+            emit caseStarted(runningCases[startedCount]->problemCase->getId(),
+                             startedCount, mProblemCases.count());
+            startedCount++;
+        }
+        while (finishedCount<startedCount
+               && runningCases[finishedCount]->state.loadAcquire()==Finished) {
+            PRunningCase runningCase = runningCases[finishedCount];
+            QString id = runningCase->problemCase->getId();
+            if (!runningCase->log.stderrOutput.isEmpty())
+                emit logStderrOutput(runningCase->log.stderrOutput);
+            foreach (const QString& error, runningCase->log.errors) {
+                emit runErrorOccurred(error);
+            }
+            emit resetOutput(id, runningCase->problemCase->output);
+            emit caseFinished(id, finishedCount, mProblemCases.count());
+            finishedCount++;
+        }
+        if (finishedCount==startedCount
+                && (skipped || startedCount==runningCases.count()))
+            break;
+        stateChanged.acquire();
+    }
+    pool.waitForDone();
+}
+
+void OJProblemCasesRunner::executeCase(POJProblemCase problemCase, int cpu, CaseRunLog *log)
+{
+#ifdef Q_OS_LINUX
+    QString launcher = includeTrailingPathDelimiter(pSettings->dirs().appLibexecDir())+CONSOLE_PAUSER;
+    if (!fileExists(launcher))
+        launcher.clear();
+    bool useSystemdScope = mMemoryLimit>0
+            && pSettings->executor().caseMemoryLimitInSystemdScope()
+            && CaseProcess::systemdScopeAvailable();
+    CaseProcess process(launcher, useSystemdScope, mMemoryLimit, cpu);
+#else
     QProcess process;
+#endif
     bool errorOccurred = false;
     QByteArray readed;
     QByteArray buffer;
-    QByteArray output;
-    int noOutputTime = 0;
+    PProcessOutputCapture output = std::make_shared<ProcessOutputCapture>(MaxOutputInMemory, OutputTailSize);
+    QElapsedTimer refreshTimer;
     QElapsedTimer elapsedTimer;
     bool execTimeouted = false;
+    bool memoryExceeded = false;
+#ifdef Q_OS_LINUX
+    process.setCommand(mFilename, mArguments);
+#else
     process.setProgram(mFilename);
     process.setArguments(mArguments);
+#endif
     process.setWorkingDirectory(mWorkDir);
     QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
     QString path = env.value("PATH");
@@ -84,7 +251,7 @@ void OJProblemCasesRunner::runCase(int index,POJProblemCase problemCase)
     env.insert("PATH",path);
     process.setProcessEnvironment(env);
     if (pSettings->executor().redirectStderrToToolLog()) {
-        emit logStderrOutput("\n"+tr("--- stderr from %1 ---").arg(problemCase->name)+"\n");
+        logStderr("\n"+tr("--- stderr from %1 ---").arg(problemCase->name)+"\n", log);
     } else {
         process.setProcessChannelMode(QProcess::MergedChannels);
         process.setReadChannel(QProcess::StandardOutput);
@@ -95,6 +262,11 @@ void OJProblemCasesRunner::runCase(int index,POJProblemCase problemCase)
         errorOccurred= true;
     });
     problemCase->output.clear();
+    problemCase->outputCapture = output;
+    problemCase->outputShownSize = 0;
+    problemCase->validatedState = ProblemCaseTestState::NotTested;
+    ProblemCaseValidator validator;
+    validator.start(problemCase, mValidateType);
     process.start();
     process.waitForStarted(5000);
 #ifdef Q_OS_WIN
@@ -102,6 +274,9 @@ void OJProblemCasesRunner::runCase(int index,POJProblemCase problemCase)
     if (process.processId()!=0) {
         hProcess = OpenProcess(PROCESS_ALL_ACCESS,FALSE,process.processId());
     }
+    if (cpu>=0 && hProcess!=NULL) {
+        SetProcessAffinityMask(hProcess, (DWORD_PTR)1<<cpu);
+    }
 #endif
     if (process.state()==QProcess::Running) {
         if (fileExists(problemCase->inputFileName))
@@ -112,24 +287,54 @@ void OJProblemCasesRunner::runCase(int index,POJProblemCase problemCase)
     }
 
     elapsedTimer.start();
+    refreshTimer.start();
+#ifdef Q_OS_LINUX
+    qint64 lastSampleTime = -mWaitForFinishTime;
+#endif
     while (true) {
         if (process.bytesToWrite()==0 && !writeChannelClosed) {
             writeChannelClosed = true;
             process.closeWriteChannel();
         }
-        process.waitForFinished(mWaitForFinishTime);
+        //wake up as soon as there's new output, so the program is never blocked by a full pipe
+        qint64 waitStartTime = elapsedTimer.elapsed();
+        if (!process.waitForReadyRead(mWaitForFinishTime)
+                && process.state()==QProcess::Running) {
+            //the output channel may be closed by the program, don't spin
+            qint64 rest = mWaitForFinishTime - (elapsedTimer.elapsed() - waitStartTime);
+            if (rest>0)
+                process.waitForFinished(rest);
+        }
         if (process.state()!=QProcess::Running) {
             break;
         }
+#ifdef Q_OS_LINUX
+        if (elapsedTimer.elapsed()-lastSampleTime>=mWaitForFinishTime) {
+            lastSampleTime = elapsedTimer.elapsed();
+            process.sample();
+            if (process.memoryLimitExceeded())
+                memoryExceeded = true;
+        }
+        if (mExecTimeout>0 && process.cpuTimeSampled()) {
+            //time limit is for cpu time, wall time is only used to stop the
+            //process that's blocked or sleeping
+            if (process.cpuTime()>(qulonglong)mExecTimeout
+                    || elapsedTimer.elapsed()>2*(qint64)mExecTimeout) {
+                execTimeouted=true;
+            }
+        } else
+#endif
         if (mExecTimeout>0) {
             int msec = elapsedTimer.elapsed();
             if (msec>mExecTimeout) {
                 execTimeouted=true;
             }
         }
-        if (mStop || execTimeouted) {
+        if (mStop || execTimeouted || memoryExceeded
+                || (mFailFast && validator.failed())) {
             process.terminate();
             process.kill();
+            process.waitForFinished();
             break;
         }
         if (errorOccurred)
@@ -137,19 +342,28 @@ void OJProblemCasesRunner::runCase(int index,POJProblemCase problemCase)
         if (pSettings->executor().redirectStderrToToolLog()) {
             QString s = QString::fromLocal8Bit(process.readAllStandardError());
             if (!s.isEmpty())
-                emit logStderrOutput(s);
+                logStderr(s, log);
         }
-        readed = process.read(mBufferSize);
-        buffer += readed;
-        if (buffer.length()>=mBufferSize || noOutputTime > mOutputRefreshTime) {
-            if (!buffer.isEmpty()) {
-                emit newOutputGetted(problemCase->getId(),QString::fromLocal8Bit(buffer));
-                output.append(buffer);
+        readed = process.readAll();
+        validator.feed(readed);
+        output->append(readed);
+        if (!output->spilled())
+            buffer += readed;
+        if (buffer.length()>=mBufferSize || refreshTimer.elapsed() > mOutputRefreshTime) {
+            if (output->spilled()) {
+                //too large to show all of it, only show its last part
+                if (!log && !readed.isEmpty()) {
+                    QByteArray tail = output->tail();
+                    tail.remove(0, tail.indexOf('\n')+1);
+                    emit resetOutput(problemCase->getId(),QString::fromLocal8Bit(tail));
+                }
+                buffer.clear();
+            } else if (!buffer.isEmpty()) {
+                if (!log)
+                    emit newOutputGetted(problemCase->getId(),QString::fromLocal8Bit(buffer));
                 buffer.clear();
             }
-            noOutputTime = 0;
-        } else {
-            noOutputTime += mWaitForFinishTime;
+            refreshTimer.restart();
         }
     }
     problemCase->runningTime=elapsedTimer.elapsed();
@@ -173,43 +387,81 @@ void OJProblemCasesRunner::runCase(int index,POJProblemCase problemCase)
             problemCase->runningTime=(double)t/10000;
         }
     }
+#elif defined(Q_OS_LINUX)
+    process.finish();
+    if (process.cpuTimeSampled())
+        problemCase->runningTime = process.cpuTime();
+    problemCase->runningMemory = process.peakMemory();
+    if (process.memoryLimitExceeded())
+        memoryExceeded = true;
+    if (!memoryExceeded && mExecTimeout>0 && process.cpuTimeSampled()
+            && process.cpuTime()>(qulonglong)mExecTimeout)
+        execTimeouted = true;
 #endif
-    if (execTimeouted) {
+    if (memoryExceeded) {
+        problemCase->output = tr("Memory limit exceeded!");
+        if (!log)
+            emit resetOutput(problemCase->getId(), problemCase->output);
+    } else if (execTimeouted) {
         problemCase->output = tr("Time limit exceeded!");
-        emit resetOutput(problemCase->getId(), problemCase->output);
-    } else if (mMemoryLimit>0 && problemCase->runningMemory>mMemoryLimit) {
+        if (!log)
+            emit resetOutput(problemCase->getId(), problemCase->output);
+    } else if (mMemoryLimit>0 && problemCase->runningMemory>=mMemoryLimit) {
         problemCase->output = tr("Memory limit exceeded!");
-        emit resetOutput(problemCase->getId(), problemCase->output);
+        if (!log)
+            emit resetOutput(problemCase->getId(), problemCase->output);
     } else {
         if (pSettings->executor().redirectStderrToToolLog()) {
             QString s = QString::fromLocal8Bit(process.readAllStandardError());
             if (!s.isEmpty())
-                emit logStderrOutput(s);
+                logStderr(s, log);
+        }
+        if (process.state() == QProcess::ProcessState::NotRunning) {
+            readed = process.readAll();
+            validator.feed(readed);
+            output->append(readed);
+            if (!output->spilled())
+                buffer += readed;
+        }
+        if (output->spilled()) {
+            //show the beginning of the output, which contains the first wrong line in most cases.
+            //The rest is loaded on demand (MainWindow::on_btnProblemCaseOutputLoadMore_clicked())
+            QByteArray head = output->read(0, MaxOutputInMemory);
+            int lineEnd = head.lastIndexOf('\n');
+            if (lineEnd>=0)
+                head.truncate(lineEnd+1);
+            problemCase->output = QString::fromLocal8Bit(head);
+            problemCase->outputShownSize = head.length();
+            if (!log)
+                emit resetOutput(problemCase->getId(), problemCase->output);
+        } else {
+            if (!log)
+                emit newOutputGetted(problemCase->getId(),QString::fromLocal8Bit(buffer));
+            problemCase->output = QString::fromLocal8Bit(output->read(0, output->size()));
+            problemCase->outputShownSize = output->size();
         }
-        if (process.state() == QProcess::ProcessState::NotRunning)
-            buffer += process.readAll();
-        emit newOutputGetted(problemCase->getId(),QString::fromLocal8Bit(buffer));
-        output.append(buffer);
-        problemCase->output = QString::fromLocal8Bit(output);
+        problemCase->validatedState = validator.finish()?
+                    ProblemCaseTestState::Passed:
+                    ProblemCaseTestState::Failed;
 
         if (errorOccurred) {
             //qDebug()<<"process error:"<<process.error();
             switch (process.error()) {
             case QProcess::FailedToStart:
-                emit runErrorOccurred(tr("The runner process '%1' failed to start.").arg(mFilename));
+                reportRunError(tr("The runner process '%1' failed to start.").arg(mFilename), log);
                 break;
     //        case QProcess::Crashed:
     //            if (!mStop)
     //                emit runErrorOccurred(tr("The runner process crashed after starting successfully."));
     //            break;
             case QProcess::Timedout:
-                emit runErrorOccurred(tr("The last waitFor...() function timed out."));
+                reportRunError(tr("The last waitFor...() function timed out."), log);
                 break;
             case QProcess::WriteError:
-                emit runErrorOccurred(tr("An error occurred when attempting to write to the runner process."));
+                reportRunError(tr("An error occurred when attempting to write to the runner process."), log);
                 break;
             case QProcess::ReadError:
-                emit runErrorOccurred(tr("An error occurred when attempting to read from the runner process."));
+                reportRunError(tr("An error occurred when attempting to read from the runner process."), log);
                 break;
             default:
                 break;
@@ -218,12 +470,32 @@ void OJProblemCasesRunner::runCase(int index,POJProblemCase problemCase)
     }
 }
 
+void OJProblemCasesRunner::logStderr(const QString &msg, CaseRunLog *log)
+{
+    if (log)
+        log->stderrOutput.append(msg);
+    else
+        emit logStderrOutput(msg);
+}
+
+void OJProblemCasesRunner::reportRunError(const QString &reason, CaseRunLog *log)
+{
+    if (log)
+        log->errors.append(reason);
+    else
+        emit runErrorOccurred(reason);
+}
+
 void OJProblemCasesRunner::run()
 {
     emit started();
     auto action = finally([this]{
         emit terminated();
     });
+    if (mConcurrency>1 && mProblemCases.count()>1) {
+        runCasesConcurrently();
+        return;
+    }
     for (int i=0; i < mProblemCases.size(); i++) {
         if (mStop)
             break;
@@ -232,6 +504,36 @@ void OJProblemCasesRunner::run()
     }
 }
 
+int OJProblemCasesRunner::concurrency() const
+{
+    return mConcurrency;
+}
+
+void OJProblemCasesRunner::setConcurrency(int newConcurrency)
+{
+    mConcurrency = std::max(1, newConcurrency);
+}
+
+ProblemCaseValidateType OJProblemCasesRunner::validateType() const
+{
+    return mValidateType;
+}
+
+void OJProblemCasesRunner::setValidateType(ProblemCaseValidateType newValidateType)
+{
+    mValidateType = newValidateType;
+}
+
+bool OJProblemCasesRunner::failFast() const
+{
+    return mFailFast;
+}
+
+void OJProblemCasesRunner::setFailFast(bool newFailFast)
+{
+    mFailFast = newFailFast;
+}
+
 int OJProblemCasesRunner::execTimeout() const
 {
     return mExecTimeout;
@@ -20,6 +20,7 @@
 #include "runner.h"
 #include <QVector>
 #include "../problems/ojproblemset.h"
+#include "../utils.h"
 
 class OJProblemCasesRunner : public Runner
 {
@@ -52,6 +53,17 @@ public:
     bool includeOutputFromStderr() const;
     void setIncludeOutputFromStderr(bool newIncludeOutputFromStderr);
 
+    //max number of cases running at the same time
+    int concurrency() const;
+    void setConcurrency(int newConcurrency);
+
+    ProblemCaseValidateType validateType() const;
+    void setValidateType(ProblemCaseValidateType newValidateType);
+
+    //stop the case at its first wrong output line
+    bool failFast() const;
+    void setFailFast(bool newFailFast);
+
 signals:
     void caseStarted(const QString &caseId, int current, int total);
     void caseFinished(const QString &caseId, int current, int total);
@@ -59,7 +71,17 @@ signals:
     void resetOutput(const QString &caseId, const QString &newOutputLine);
     void logStderrOutput(const QString& msg);
 private:
+    //stderr output and errors of a case running in the worker thread,
+    //which are reported after the case is finished
+    struct CaseRunLog {
+        QString stderrOutput;
+        QStringList errors;
+    };
     void runCase(int index, POJProblemCase problemCase);
+    void runCasesConcurrently();
+    void executeCase(POJProblemCase problemCase, int cpu, CaseRunLog* log);
+    void logStderr(const QString& msg, CaseRunLog* log);
+    void reportRunError(const QString& reason, CaseRunLog* log);
 private:
     QVector<POJProblemCase> mProblemCases;
 
@@ -72,6 +94,9 @@ private:
     int mExecTimeout;
     size_t mMemoryLimit;
     bool mIncludeOutputFromStderr;
+    int mConcurrency;
+    ProblemCaseValidateType mValidateType;
+    bool mFailFast;
 };
 
 #endif // OJPROBLEMCASESRUNNER_H
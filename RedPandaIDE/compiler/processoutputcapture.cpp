@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2020-2022 Roy Qu (royqh1979@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "processoutputcapture.h"
+#include <QDir>
+#include <QTemporaryFile>
+
+ProcessOutputCapture::ProcessOutputCapture(qint64 memoryLimit, int tailSize):
+    mMemoryLimit(memoryLimit),
+    mTailSize(tailSize),
+    mSize(0),
+    mSpillFailed(false)
+{
+
+}
+
+ProcessOutputCapture::~ProcessOutputCapture()
+{
+
+}
+
+void ProcessOutputCapture::append(const QByteArray &data)
+{
+    if (data.isEmpty())
+        return;
+    mSize += data.length();
+    if (!mFile) {
+        mData.append(data);
+        if (mData.length()<=mMemoryLimit || mSpillFailed || spill())
+            return;
+    } else if (mFile->write(data)!=data.length()) {
+        //disk is full, the output is incomplete but we still keep the tail
+        mSpillFailed = true;
+    }
+    mTail.append(data);
+    //trim it lazily, so we don't move it for each small chunk
+    if (mTail.length()>2*mTailSize)
+        mTail.remove(0, mTail.length()-mTailSize);
+}
+
+qint64 ProcessOutputCapture::size() const
+{
+    return mSize;
+}
+
+bool ProcessOutputCapture::spilled() const
+{
+    return (bool)mFile;
+}
+
+QString ProcessOutputCapture::fileName() const
+{
+    if (mFile)
+        return mFile->fileName();
+    return QString();
+}
+
+QByteArray ProcessOutputCapture::tail() const
+{
+    if (mFile)
+        return mTail.right(mTailSize);
+    return mData.right(mTailSize);
+}
+
+QByteArray ProcessOutputCapture::read(qint64 pos, qint64 maxSize)
+{
+    if (!mFile)
+        return mData.mid(pos, maxSize);
+    QByteArray result;
+    if (mFile->seek(pos))
+        result = mFile->read(maxSize);
+    mFile->seek(mFile->size());
+    return result;
+}
+
+bool ProcessOutputCapture::spill()
+{
+    std::unique_ptr<QTemporaryFile> file = std::make_unique<QTemporaryFile>(
+                QDir::tempPath() + "/redpanda_XXXXXX.output");
+    if (!file->open() || file->write(mData)!=mData.length()) {
+        mSpillFailed = true;
+        return false;
+    }
+    mFile = std::move(file);
+    mTail = mData.right(mTailSize);
+    mData.clear();
+    mData.squeeze();
+    return true;
+}
@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2020-2022 Roy Qu (royqh1979@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef PROCESSOUTPUTCAPTURE_H
+#define PROCESSOUTPUTCAPTURE_H
+
+#include <QByteArray>
+#include <QString>
+#include <memory>
+
+class QTemporaryFile;
+
+/**
+ * @brief Keeps the output of a running program
+ *
+ * The output is kept in memory until it's larger than the memory limit. Then it's
+ * written to a temporary file, and only its last part is kept in memory for live
+ * displaying. The whole output can be read back page by page.
+ */
+class ProcessOutputCapture
+{
+public:
+    explicit ProcessOutputCapture(qint64 memoryLimit, int tailSize);
+    ProcessOutputCapture(const ProcessOutputCapture&)=delete;
+    ProcessOutputCapture& operator=(const ProcessOutputCapture&)=delete;
+    ~ProcessOutputCapture();
+
+    void append(const QByteArray& data);
+    qint64 size() const;
+    bool spilled() const;
+    //name of the temporary file that keeps the output, empty if not spilled
+    QString fileName() const;
+    //last (at most tailSize) bytes of the output
+    QByteArray tail() const;
+    QByteArray read(qint64 pos, qint64 maxSize);
+private:
+    bool spill();
+private:
+    qint64 mMemoryLimit;
+    int mTailSize;
+    qint64 mSize;
+    QByteArray mData;
+    QByteArray mTail;
+    std::unique_ptr<QTemporaryFile> mFile;
+    bool mSpillFailed;
+};
+
+using PProcessOutputCapture = std::shared_ptr<ProcessOutputCapture>;
+
+#endif // PROCESSOUTPUTCAPTURE_H
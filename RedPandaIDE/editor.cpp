@@ -34,6 +34,7 @@
 #include <QScrollBar>
 #include <QScreen>
 #include <memory>
+#include <algorithm>
 #include <QFileDialog>
 #include <QMessageBox>
 #include <QDebug>
@@ -59,6 +60,8 @@
 #include "utils/escape.h"
 
 QHash<ParserLanguage,std::weak_ptr<CppParser>> Editor::mSharedParsers;
+QHash<QString,std::weak_ptr<const ParserBaseLayer>> Editor::mParserBaseLayers;
+QHash<QString,std::shared_ptr<Editor::ParserBaseLayerBuild>> Editor::mParserBaseLayerBuilds;
 
 static QSet<QString> CppTypeQualifiers {
     "const",
@@ -72,6 +75,9 @@ static QSet<QString> CppTypeQualifiers {
     "inline"
 };
 
+template<class Lines>
+static QStringList expressionAtPosition(const Lines& lines, const QSynedit::BufferCoord &pos);
+
 Editor::Editor(QWidget *parent):
     Editor(parent,"untitled",ENCODING_AUTO_DETECT,nullptr,true,nullptr)
 {
@@ -95,10 +101,13 @@ Editor::Editor(QWidget *parent, const QString& filename,
   mCurrentTipType{TipType::None},
   mSaving{false},
   mHoverModifiedLine{-1},
-  mWheelAccumulatedDelta{0}
+  mWheelAccumulatedDelta{0},
+  mDocumentRevision{0},
+  mSemanticTokenBuilds{0}
 {
     mLastFocusOutTime = 0;
     mInited=false;
+    mCompletionShownWhileParsing = false;
     mBackupFile=nullptr;
     mHighlightCharPos1 = QSynedit::BufferCoord{0,0};
     mHighlightCharPos2 = QSynedit::BufferCoord{0,0};
@@ -172,6 +181,17 @@ Editor::Editor(QWidget *parent, const QString& filename,
             this, &Editor::onLinesDeleted);
     connect(this,&QSynEdit::linesInserted,
             this, &Editor::onLinesInserted);
+    connect(document().get(), &QSynedit::Document::inserted,
+            this, &Editor::onDocumentLinesInserted);
+    connect(document().get(), &QSynedit::Document::deleted,
+            this, &Editor::onDocumentLinesDeleted);
+    connect(document().get(), &QSynedit::Document::putted,
+            this, &Editor::onDocumentLinePutted);
+    connect(document().get(), &QSynedit::Document::cleared,
+            this, [this]{
+        mSemanticTokens.clear();
+        mDocumentRevision++;
+    });
 
     setContextMenuPolicy(Qt::CustomContextMenu);
 
@@ -247,6 +267,8 @@ Editor::Editor(QWidget *parent, const QString& filename,
 Editor::~Editor() {
     //qDebug()<<"editor "<<mFilename<<" deleted";
     cleanAutoBackup();
+    mParser = nullptr;
+    pruneParserBaseLayers();
 }
 
 void Editor::loadFile(QString filename) {
@@ -1339,20 +1361,7 @@ void Editor::onPreparePaintHighlightToken(int line, int aChar, const QString &to
             //Syntax color for different identifier types
             QSynedit::BufferCoord p{aChar,line};
 
-            StatementKind kind;
-            if (mParser->parsing()){
-                kind=mIdentCache.value(QString("%1 %2").arg(aChar).arg(token),StatementKind::Unknown);
-            } else {
-                QStringList expression = getExpressionAtPosition(p);
-                PStatement statement = parser()->findStatementOf(
-                            filename(),
-                            expression,
-                            p.line);
-                while (statement && statement->kind == StatementKind::Alias)
-                    statement = mParser->findAliasedStatement(statement);
-                kind = getKindOfStatement(statement);
-                mIdentCache.insert(QString("%1 %2").arg(aChar).arg(token),kind);
-            }
+            StatementKind kind = getSemanticTokenKind(line, aChar, token);
             if (kind == StatementKind::Unknown) {
                 QSynedit::BufferCoord pBeginPos,pEndPos;
                 QString s= getWordAtPosition(this,p, pBeginPos,pEndPos, WordPurpose::wpInformation);
@@ -2033,6 +2042,145 @@ void Editor::onLinesInserted(int first, int count)
     }
 }
 
+StatementKind Editor::getSemanticTokenKind(int line, int aChar, const QString &token)
+{
+    if (line<1)
+        return StatementKind::Unknown;
+    if (line>mSemanticTokens.count())
+        mSemanticTokens.resize(line);
+    SemanticTokenLine& tokens = mSemanticTokens[line-1];
+    auto it = std::lower_bound(tokens.begin(), tokens.end(), aChar,
+                               [](const SemanticToken& t, int ch) {
+        return t.start < ch;
+    });
+    bool found = (it!=tokens.end() && it->start == aChar);
+    if (found && it->length == token.length())
+        return it->kind;
+    if (mParser->parsing()) {
+        // can't find statements while parsing, use the last result
+        return found?it->kind:StatementKind::Unknown;
+    }
+    QStringList expression = getExpressionAtPosition(QSynedit::BufferCoord{aChar,line});
+    PStatement statement = mParser->findStatementOf(
+                filename(),
+                expression,
+                line);
+    while (statement && statement->kind == StatementKind::Alias)
+        statement = mParser->findAliasedStatement(statement);
+    StatementKind kind = getKindOfStatement(statement);
+    if (found) {
+        it->length = token.length();
+        it->kind = kind;
+    } else {
+        tokens.insert(it, SemanticToken{aChar, token.length(), kind});
+    }
+    return kind;
+}
+
+bool Editor::buildSemanticTokens(const PCppParser &parser, const QString &fileName,
+                                 const QStringList &lines,
+                                 const QVector<QSynedit::SyntaxState> &states,
+                                 QVector<SemanticTokenLine> &semanticTokens)
+{
+    struct Snapshot {
+        const QStringList& lines;
+        const QVector<QSynedit::SyntaxState>& states;
+        int count() const { return lines.count(); }
+        QString getLine(int line) const { return lines[line]; }
+        QSynedit::SyntaxState getSyntaxState(int line) const { return states[line]; }
+    } snapshot{lines, states};
+    QSynedit::CppSyntaxer syntaxer;
+    semanticTokens.resize(lines.count());
+    for (int i=0;i<lines.count();i++) {
+        // statements can't be found while the file is parsed again
+        if (parser->parsing())
+            return false;
+        if (i==0)
+            syntaxer.resetState();
+        else
+            syntaxer.setState(states[i-1]);
+        syntaxer.setLine(lines[i],i);
+        SemanticTokenLine& tokens = semanticTokens[i];
+        while (!syntaxer.eol()) {
+            if (syntaxer.getTokenAttribute()->tokenType() == QSynedit::TokenType::Identifier) {
+                int start = syntaxer.getTokenPos()+1;
+                QString token = syntaxer.getToken();
+                QStringList expression = expressionAtPosition(snapshot, QSynedit::BufferCoord{start,i+1});
+                PStatement statement = parser->findStatementOf(fileName, expression, i+1);
+                while (statement && statement->kind == StatementKind::Alias)
+                    statement = parser->findAliasedStatement(statement);
+                tokens.append(SemanticToken{start, token.length(), getKindOfStatement(statement)});
+            }
+            syntaxer.next();
+        }
+    }
+    return true;
+}
+
+void Editor::setSemanticTokens(int documentRevision, bool built, const QVector<SemanticTokenLine> &semanticTokens)
+{
+    mSemanticTokenBuilds--;
+    if (mSemanticTokenBuilds>0)
+        return;
+    if (built && documentRevision == mDocumentRevision)
+        mSemanticTokens = semanticTokens;
+    else
+        mSemanticTokens.clear();
+    document()->invalidateAllNonTempLineWidth();
+    invalidate();
+}
+
+void Editor::parseFileAndBuildSemanticTokens()
+{
+    if (!mParser || !mParser->enabled())
+        return;
+    // snapshot of the lines to be parsed, the index is built from it in the parser thread
+    QStringList lines;
+    QVector<QSynedit::SyntaxState> states;
+    int count = document()->count();
+    lines.reserve(count);
+    states.reserve(count);
+    for (int i=0;i<count;i++) {
+        lines.append(document()->getLine(i));
+        states.append(document()->getSyntaxState(i));
+    }
+    PCppParser parser = mParser;
+    QString fileName = mFilename;
+    int documentRevision = mDocumentRevision;
+    QPointer<Editor> editor(this);
+    mSemanticTokenBuilds++;
+    ::parseFile(mParser, mFilename, inProject(), false, true,
+                [parser, fileName, lines, states, documentRevision, editor]{
+        QVector<SemanticTokenLine> semanticTokens;
+        bool built = buildSemanticTokens(parser, fileName, lines, states, semanticTokens);
+        QMetaObject::invokeMethod(pMainWindow, [editor, documentRevision, built, semanticTokens]{
+            if (editor)
+                editor->setSemanticTokens(documentRevision, built, semanticTokens);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void Editor::onDocumentLinesInserted(int index, int count)
+{
+    mDocumentRevision++;
+    if (index<mSemanticTokens.count())
+        mSemanticTokens.insert(index, count, SemanticTokenLine());
+}
+
+void Editor::onDocumentLinesDeleted(int index, int count)
+{
+    mDocumentRevision++;
+    if (index<mSemanticTokens.count())
+        mSemanticTokens.remove(index, std::min(count, mSemanticTokens.count()-index));
+}
+
+void Editor::onDocumentLinePutted(int index)
+{
+    mDocumentRevision++;
+    if (index<mSemanticTokens.count())
+        mSemanticTokens[index].clear();
+}
+
 void Editor::onFunctionTipsTimer()
 {
     mFunctionTipTimer.stop();
@@ -2221,9 +2369,19 @@ void Editor::onTooltipTimer()
 
 void Editor::onEndParsing()
 {
-    mIdentCache.clear();
-    document()->invalidateAllNonTempLineWidth();
-    invalidate();
+    // keep the index until the one built after this parse is set
+    if (mSemanticTokenBuilds==0) {
+        mSemanticTokens.clear();
+        document()->invalidateAllNonTempLineWidth();
+        invalidate();
+    }
+    if (mCompletionShownWhileParsing) {
+        mCompletionShownWhileParsing = false;
+        if (mCompletionPopup->isVisible() && pMainWindow->editorList()->getEditor() == this) {
+            mCompletionPopup->hide();
+            showCompletion(mCompletionPreWord, false, mCompletionType);
+        }
+    }
 }
 
 void Editor::resolveAutoDetectEncodingOption()
@@ -2369,27 +2527,28 @@ QStringList Editor::getOwnerExpressionAndMemberAtPositionForCompletion(
     return getOwnerExpressionAndMember(expression,memberOperator,memberExpression);
 }
 
-QStringList Editor::getExpressionAtPosition(
-        const QSynedit::BufferCoord &pos)
+// Lines provides count(), getLine() and getSyntaxState() like QSynedit::Document,
+// so the expression can be found in a snapshot of the document in other threads.
+template<class Lines>
+static QStringList expressionAtPosition(const Lines& lines, const QSynedit::BufferCoord &pos)
 {
+    using LastSymbolType = Editor::LastSymbolType;
     QStringList result;
-    if (!parser())
-        return result;
     int line = pos.line-1;
     int ch = pos.ch-1;
     int symbolMatchingLevel = 0;
     LastSymbolType lastSymbolType=LastSymbolType::None;
     QSynedit::CppSyntaxer syntaxer;
     while (true) {
-        if (line>=lineCount() || line<0)
+        if (line>=lines.count() || line<0)
             break;
         QStringList tokens;
         if (line==0) {
             syntaxer.resetState();
         } else {
-            syntaxer.setState(document()->getSyntaxState(line-1));
+            syntaxer.setState(lines.getSyntaxState(line-1));
         }
-        QString sLine = document()->getLine(line);
+        QString sLine = lines.getLine(line);
         syntaxer.setLine(sLine,line-1);
         while (!syntaxer.eol()) {
             int start = syntaxer.getTokenPos();
@@ -2421,7 +2580,7 @@ QStringList Editor::getExpressionAtPosition(
                 if (token==">") {
                     lastSymbolType=LastSymbolType::MatchingAngleQuotation;
                     symbolMatchingLevel=0;
-                } else if (isIdentStartChar(token.front())) {
+                } else if (syntaxer.isIdentStartChar(token.front())) {
                     lastSymbolType=LastSymbolType::Identifier;
                 } else
                     return result;
@@ -2436,7 +2595,7 @@ QStringList Editor::getExpressionAtPosition(
                 } else if (token == "]") {
                     lastSymbolType=LastSymbolType::MatchingBracket;
                     symbolMatchingLevel = 0;
-                } else if (isIdentStartChar(token.front())) {
+                } else if (syntaxer.isIdentStartChar(token.front())) {
                     lastSymbolType=LastSymbolType::Identifier;
                 } else
                     return result;
@@ -2445,7 +2604,7 @@ QStringList Editor::getExpressionAtPosition(
                 if (token == '*') {                    
                 } else {
                     QChar ch=token.front();
-                    if (isIdentChar(ch)
+                    if (syntaxer.isIdentChar(ch)
                             || ch.isDigit()
                             || ch == '.'
                             || ch == ')' ) {
@@ -2457,7 +2616,7 @@ QStringList Editor::getExpressionAtPosition(
             case LastSymbolType::AmpersandSign: // before '&':
             {
                 QChar ch=token.front();
-                if (isIdentChar(ch)
+                if (syntaxer.isIdentChar(ch)
                         || ch.isDigit()
                         || ch == '.'
                         || ch == ')' ) {
@@ -2489,7 +2648,7 @@ QStringList Editor::getExpressionAtPosition(
                     lastSymbolType=LastSymbolType::AsteriskSign;
                 } else if (token == "&") {
                     lastSymbolType=LastSymbolType::AmpersandSign;
-                } else if (isIdentStartChar(token.front())) {
+                } else if (syntaxer.isIdentStartChar(token.front())) {
                     lastSymbolType=LastSymbolType::Identifier;
                 } else
                     return result;
@@ -2501,13 +2660,13 @@ QStringList Editor::getExpressionAtPosition(
                 } else if (token == "]") {
                     lastSymbolType=LastSymbolType::MatchingBracket;
                     symbolMatchingLevel = 0;
-                } else if (isIdentStartChar(token.front())) {
+                } else if (syntaxer.isIdentStartChar(token.front())) {
                     lastSymbolType=LastSymbolType::Identifier;
                 } else
                     return result;
                 break;
             case LastSymbolType::AngleQuotationMatched: //before '<>'
-                if (isIdentStartChar(token.front())) {
+                if (syntaxer.isIdentStartChar(token.front())) {
                     lastSymbolType=LastSymbolType::Identifier;
                 } else
                     return result;
@@ -2529,7 +2688,7 @@ QStringList Editor::getExpressionAtPosition(
                 } else if (token == "]") {
                     lastSymbolType=LastSymbolType::MatchingBracket;
                     symbolMatchingLevel = 0;
-                } else if (isIdentStartChar(token.front())) {
+                } else if (syntaxer.isIdentStartChar(token.front())) {
                     lastSymbolType=LastSymbolType::Identifier;
                 } else
                     return result;
@@ -2602,11 +2761,19 @@ QStringList Editor::getExpressionAtPosition(
 
         line--;
         if (line>=0)
-            ch = document()->getLine(line).length()+1;
+            ch = lines.getLine(line).length()+1;
     }
     return result;
 }
 
+QStringList Editor::getExpressionAtPosition(
+        const QSynedit::BufferCoord &pos)
+{
+    if (!parser())
+        return QStringList();
+    return expressionAtPosition(*document(), pos);
+}
+
 QString Editor::getWordForCompletionSearch(const QSynedit::BufferCoord &pos,bool permitTilde)
 {
     QString result = "";
@@ -2798,6 +2965,7 @@ bool Editor::handleParentheseSkip()
       if (lineCount()==0)
           return false;
       if (syntaxer()->supportBraceLevel()) {
+          finishPendingReparse();
           QSynedit::SyntaxState lastLineState = document()->getSyntaxState(lineCount()-1);
           if (lastLineState.parenthesisLevel==0) {
               setCaretXY( QSynedit::BufferCoord{caretX() + 1, caretY()}); // skip over
@@ -2845,6 +3013,7 @@ bool Editor::handleBracketSkip()
     if (lineCount()==0)
         return false;
     if (syntaxer()->supportBraceLevel()) {
+        finishPendingReparse();
         QSynedit::SyntaxState lastLineState = document()->getSyntaxState(lineCount()-1);
         if (lastLineState.bracketLevel==0) {
             setCaretXY( QSynedit::BufferCoord{caretX() + 1, caretY()}); // skip over
@@ -2959,6 +3128,7 @@ bool Editor::handleBraceSkip()
         return false;
 
     if (syntaxer()->supportBraceLevel()) {
+        finishPendingReparse();
         QSynedit::SyntaxState lastLineState = document()->getSyntaxState(lineCount()-1);
         if (lastLineState.braceLevel==0) {
             bool oldInsertMode = insertMode();
@@ -3157,13 +3327,14 @@ void Editor::initParser()
                         std::bind(
                             &EditorList::getContentFromOpenedEditor,pMainWindow->editorList(),
                             std::placeholders::_1, std::placeholders::_2));
-            resetCppParser(mParser);
+            resetNonSharedParser();
             mParser->setEnabled(
                         pSettings->codeCompletion().enabled() &&
                         (syntaxer()->language() == QSynedit::ProgrammingLanguage::CPP));
         }
     } else {
         mParser = nullptr;
+        pruneParserBaseLayers();
     }
 }
 
@@ -3241,13 +3412,15 @@ void Editor::reparse(bool resetParser)
         } else {
             if (language!=mParser->language()) {
                 mParser->setLanguage(language);
-                resetCppParser(mParser);
+                resetNonSharedParser();
             } else if (resetParser) {
-                resetCppParser(mParser);
+                resetNonSharedParser();
             }
+            if (waitForParserBaseLayer())
+                return;
         }
     }
-    parseFile(mParser,mFilename, inProject());
+    parseFileAndBuildSemanticTokens();
 }
 
 void Editor::reparseTodo()
@@ -3608,6 +3781,11 @@ void Editor::showCompletion(const QString& preWord,bool autoComplete, CodeComple
                     mParser->findScopeStatement(mFilename, caretY())
                     );
     }
+    // queries don't wait for the parser, only keywords are found now
+    mCompletionShownWhileParsing = mParser && mParser->parsing()
+            && type != CodeCompletionType::KeywordsOnly;
+    mCompletionPreWord = preWord;
+    mCompletionType = type;
     pMainWindow->functionTip()->hide();
     mCompletionPopup->show();
 
@@ -3802,9 +3980,10 @@ void Editor::completionInsert(bool appendFunc)
 
     if (pSettings->codeCompletion().recordUsage()
             && statement->kind != StatementKind::UserCodeSnippet) {
-        statement->usageCount+=1;
+        //don't touch the statement, it may be shared by other editors' parsers
+        PSymbolUsage usage = pMainWindow->symbolUsageManager()->findUsage(statement->fullName);
         pMainWindow->symbolUsageManager()->updateUsage(statement->fullName,
-                                                         statement->usageCount);
+                                                         usage ? usage->count+1 : 1);
     }
 
     QString funcAddOn = "";
@@ -4608,6 +4787,99 @@ PCppParser Editor::sharedParser(ParserLanguage language)
     return parser;
 }
 
+void Editor::resetNonSharedParser()
+{
+    resetCppParser(mParser);
+    pruneParserBaseLayers();
+    PParserBaseLayer layer = mParserBaseLayers.value(mParser->symbolCacheKey()).lock();
+    if (layer)
+        mParser->attachBaseLayer(layer);
+}
+
+bool Editor::waitForParserBaseLayer()
+{
+    // only for a non-shared parser that hasn't parsed the file
+    if (inProject() || pSettings->codeCompletion().shareParser()
+            || !mParser || mParser->baseLayer() || !mParser->parseGlobalHeaders()
+            || mParser->isFileParsed(mFilename))
+        return false;
+    QString key = mParser->symbolCacheKey();
+    std::shared_ptr<ParserBaseLayerBuild> build = mParserBaseLayerBuilds.value(key);
+    if (!build) {
+        PParserBaseLayer layer = mParserBaseLayers.value(key).lock();
+        if (layer) {
+            mParser->attachBaseLayer(layer);
+            return false;
+        }
+        // parse the system headers that the file includes by another parser, and
+        //   share them with the other editors in a base layer
+        QStringList includes;
+        foreach (const QString& line, contents()) {
+            QString trimmedLine = line.trimmed();
+            if (trimmedLine.startsWith('#')
+                    && trimmedLine.mid(1).trimmed().startsWith("include")
+                    && trimmedLine.contains('<'))
+                includes.append(trimmedLine);
+        }
+        if (includes.isEmpty())
+            return false;
+        PCppParser parser = std::make_shared<CppParser>();
+        parser->setLanguage(mParser->language());
+        resetCppParser(parser);
+        if (parser->symbolCacheKey() != key)
+            return false;
+        QString includesFile = QDir::temp().absoluteFilePath(
+                    mParser->language()==ParserLanguage::C ?
+                        "redpanda-base-layer.c" : "redpanda-base-layer.cpp");
+        EditorList* editorList = pMainWindow->editorList();
+        parser->setOnGetFileStream([includesFile, includes, editorList](const QString& fileName, QStringList& buffer){
+            if (fileName == includesFile) {
+                buffer = includes;
+                return true;
+            }
+            return editorList->getContentFromOpenedEditor(fileName, buffer);
+        });
+        connect(parser.get(), &CppParser::onEndParsing, pMainWindow, [key]{
+            onParserBaseLayerBuilt(key);
+        });
+        build = std::make_shared<ParserBaseLayerBuild>();
+        build->parser = parser;
+        mParserBaseLayerBuilds.insert(key, build);
+        ::parseFile(parser, includesFile, false);
+    }
+    if (!build->editors.contains(this))
+        build->editors.append(this);
+    return true;
+}
+
+void Editor::onParserBaseLayerBuilt(const QString &key)
+{
+    std::shared_ptr<ParserBaseLayerBuild> build = mParserBaseLayerBuilds.take(key);
+    if (!build)
+        return;
+    PParserBaseLayer layer = build->parser->createBaseLayer();
+    if (layer)
+        mParserBaseLayers.insert(key, layer);
+    foreach (const QPointer<Editor>& editor, build->editors) {
+        if (!editor || !editor->mParser)
+            continue;
+        if (layer)
+            editor->mParser->attachBaseLayer(layer);
+        editor->parseFileAndBuildSemanticTokens();
+    }
+}
+
+void Editor::pruneParserBaseLayers()
+{
+    // remove layers that no parser uses any more
+    for (auto it=mParserBaseLayers.begin();it!=mParserBaseLayers.end();) {
+        if (it.value().expired())
+            it = mParserBaseLayers.erase(it);
+        else
+            ++it;
+    }
+}
+
 bool Editor::canAutoSave() const
 {
     return mCanAutoSave;
@@ -5444,6 +5716,7 @@ void Editor::applySettings()
 
     setMouseWheelScrollSpeed(pSettings->editor().mouseWheelScrollSpeed());
     setMouseSelectionScrollSpeed(pSettings->editor().mouseSelectionScrollSpeed());
+    setMaxUndoMemoryUsage((qint64)pSettings->editor().undoMemoryLimit() * 1024 * 1024);
     invalidate();
     decPaintLock();
 }
@@ -5543,7 +5816,7 @@ void Editor::applyColorScheme(const QString& schemeName)
         mCurrentHighlighWordBackground = selectedBackground();
     }
     document()->invalidateAllNonTempLineWidth();
-    invalidate();
+    invalidateRenderedLines();
 }
 
 void Editor::updateCaption(const QString& newCaption) {
@@ -20,6 +20,7 @@
 #include <QObject>
 #include <utils.h>
 #include <QTabWidget>
+#include <QPointer>
 #include "qsynedit/qsynedit.h"
 #include "colorscheme.h"
 #include "common.h"
@@ -266,6 +267,26 @@ private slots:
     void onEndParsing();
 
 private:
+    // kind of an identifier in the file. The index is built in the parser thread after
+    // the file is parsed; tokens not in it are resolved when they're painted.
+    struct SemanticToken {
+        int start;
+        int length;
+        StatementKind kind;
+    };
+    using SemanticTokenLine = QVector<SemanticToken>; // sorted by start
+
+    StatementKind getSemanticTokenKind(int line, int aChar, const QString& token);
+    static bool buildSemanticTokens(const PCppParser& parser, const QString& fileName,
+                                    const QStringList& lines,
+                                    const QVector<QSynedit::SyntaxState>& states,
+                                    QVector<SemanticTokenLine>& semanticTokens);
+    void setSemanticTokens(int documentRevision, bool built,
+                           const QVector<SemanticTokenLine>& semanticTokens);
+    void parseFileAndBuildSemanticTokens();
+    void onDocumentLinesInserted(int index, int count);
+    void onDocumentLinesDeleted(int index, int count);
+    void onDocumentLinePutted(int index);
     void resolveAutoDetectEncodingOption();
     bool isBraceChar(QChar ch);
     bool shouldOpenInReadonly();
@@ -287,6 +308,10 @@ private:
 
     bool handleCodeCompletion(QChar key);
     void initParser();
+    void resetNonSharedParser();
+    bool waitForParserBaseLayer();
+    static void onParserBaseLayerBuilt(const QString& key);
+    static void pruneParserBaseLayers();
     ParserLanguage calcParserLanguage();
     void undoSymbolCompletion(int pos);
     QuoteStatus getQuoteStatus();
@@ -355,6 +380,10 @@ private:
     int mActiveBreakpointLine;
     PCppParser mParser;
     std::shared_ptr<CodeCompletionPopup> mCompletionPopup;
+    // the completion popup is shown while the parser is busy, search it again after parsing
+    bool mCompletionShownWhileParsing;
+    QString mCompletionPreWord;
+    CodeCompletionType mCompletionType;
     std::shared_ptr<HeaderCompletionPopup> mHeaderCompletionPopup;
     bool mUseCppSyntax;
     QString mCurrentWord;
@@ -382,10 +411,19 @@ private:
     QTimer mTooltipTimer;
     int mHoverModifiedLine;
     int mWheelAccumulatedDelta;
-    QMap<QString,StatementKind> mIdentCache;
+    QVector<SemanticTokenLine> mSemanticTokens; // index is line - 1
+    int mDocumentRevision; // changed when lines are inserted, deleted or changed
+    int mSemanticTokenBuilds; // builds not finished yet
     qint64 mLastFocusOutTime;
 
     static QHash<ParserLanguage,std::weak_ptr<CppParser>> mSharedParsers;
+    static QHash<QString,std::weak_ptr<const ParserBaseLayer>> mParserBaseLayers; // keyed by parser's symbol cache key
+
+    struct ParserBaseLayerBuild {
+        PCppParser parser; // parses only the system headers, dropped when done
+        QList<QPointer<Editor>> editors; // editors waiting for the layer to parse their files
+    };
+    static QHash<QString,std::shared_ptr<ParserBaseLayerBuild>> mParserBaseLayerBuilds; // keyed by symbol cache key
 
     // QWidget interface
 protected:
@@ -70,6 +70,7 @@
 #include "widgets/darkfusionstyle.h"
 #include "widgets/lightfusionstyle.h"
 #include "problems/problemcasevalidator.h"
+#include "compiler/processoutputcapture.h"
 #include "problems/freeprojectsetformat.h"
 #include "widgets/ojproblempropertywidget.h"
 #include "iconsmanager.h"
@@ -158,12 +159,16 @@ MainWindow::MainWindow(QWidget *parent)
     mFileInfoStatus=new QLabel();
     mFileEncodingStatus = new LabelWithMenu();
     mFileModeStatus = new QLabel();
+    mPaintStatisticsStatus = new QLabel();
 
     mFileInfoStatus->setStyleSheet("margin-left:5px; margin-right:5px");
     mFileEncodingStatus->setStyleSheet("margin-left:5px; margin-right:5px");
     mFileModeStatus->setStyleSheet("margin-left:5px; margin-right:5px");
+    mPaintStatisticsStatus->setStyleSheet("margin-left:5px; margin-right:5px");
+    mPaintStatisticsStatus->setVisible(false);
     prepareTabInfosData();
     prepareTabMessagesData();
+    ui->statusbar->insertPermanentWidget(0,mPaintStatisticsStatus);
     ui->statusbar->insertPermanentWidget(0,mFileModeStatus);
     ui->statusbar->insertPermanentWidget(0,mFileEncodingStatus);
     ui->statusbar->insertPermanentWidget(0,mFileInfoStatus);
@@ -438,6 +443,8 @@ MainWindow::MainWindow(QWidget *parent)
     connect(&mAutoSaveTimer, &QTimer::timeout,
             this, &MainWindow::onAutoSaveTimeout);
     resetAutoSaveTimer();
+    connect(&mPaintStatisticsTimer, &QTimer::timeout,
+            this, &MainWindow::onPaintStatisticsTimeout);
 
     connect(ui->menuFile, &QMenu::aboutToShow,
             this,&MainWindow::rebuildOpenedFileHisotryMenu);
@@ -555,6 +562,13 @@ void MainWindow::updateEditorSettings()
                 calIconSize(pSettings->editor().fontName(),pSettings->editor().fontSize())
                 );
     mEditorList->applySettings();
+    if (pSettings->editor().showPaintStatistics()) {
+        mPaintStatisticsTimer.start(1000);
+    } else {
+        mPaintStatisticsTimer.stop();
+        mPaintStatisticsStatus->clear();
+    }
+    mPaintStatisticsStatus->setVisible(pSettings->editor().showPaintStatistics());
 }
 
 void MainWindow::updateEditorBookmarks()
@@ -1022,6 +1036,7 @@ void MainWindow::applySettings()
     //fix for qstatusbar bug
     mFileEncodingStatus->setPalette(appTheme->palette());
     mFileModeStatus->setPalette(appTheme->palette());
+    mPaintStatisticsStatus->setPalette(appTheme->palette());
     mFileInfoStatus->setPalette(appTheme->palette());
 
     updateEditorColorSchemes();
@@ -3830,6 +3845,27 @@ void MainWindow::onAutoSaveTimeout()
     }
 }
 
+void MainWindow::onPaintStatisticsTimeout()
+{
+    Editor *e = mEditorList->getEditor();
+    if (!e) {
+        mPaintStatisticsStatus->clear();
+        return;
+    }
+    //statistics are collected in the last second
+    const QSynedit::PaintStatistics& statistics = e->paintStatistics();
+    qint64 avgFrameTime = statistics.frames>0 ? statistics.totalFrameTime / statistics.frames : 0;
+    mPaintStatisticsStatus->setText(
+                tr("%1 fps, frame time(ms): %2 avg/%3 max, glyph runs cached/prepared: %4/%5, scrolls blitted: %6")
+                .arg(statistics.frames)
+                .arg(avgFrameTime / 1000.0, 0, 'f', 1)
+                .arg(statistics.maxFrameTime / 1000.0, 0, 'f', 1)
+                .arg(statistics.cachedRuns)
+                .arg(statistics.preparedRuns)
+                .arg(statistics.blittedScrolls));
+    e->resetPaintStatistics();
+}
+
 void MainWindow::onWatchViewContextMenu(const QPoint &pos)
 {
     QMenu menu(this);
@@ -4318,6 +4354,7 @@ void MainWindow::onProblemCaseIndexChanged(const QModelIndex &current, const QMo
             ui->txtProblemCaseOutput->clearAll();
             ui->txtProblemCaseOutput->setPlainText(problemCase->output);
             updateProblemCaseOutput(problemCase);
+            updateProblemCaseOutputActions(problemCase);
             return;
         }
     }
@@ -4340,6 +4377,7 @@ void MainWindow::onProblemCaseIndexChanged(const QModelIndex &current, const QMo
     ui->txtProblemCaseExpected->clearAll();
     ui->txtProblemCaseExpected->setReadOnly(true);
     ui->txtProblemCaseOutput->clearAll();
+    updateProblemCaseOutputActions(POJProblemCase());
 
     ui->lblProblemCaseExpected->clear();
     ui->lblProblemCaseOutput->clear();
@@ -6128,19 +6166,27 @@ void MainWindow::onRunProblemFinished()
 
 void MainWindow::onOJProblemCaseStarted(const QString& id,int current, int total)
 {
+    Q_UNUSED(current);
+    //cases may be started concurrently, the progress is updated when they are finished
     ui->pbProblemCases->setVisible(true);
     ui->pbProblemCases->setMaximum(total);
-    ui->pbProblemCases->setValue(current);
     int row = mOJProblemModel.getCaseIndexById(id);
     if (row>=0) {
         POJProblemCase problemCase = mOJProblemModel.getCase(row);
         problemCase->testState = ProblemCaseTestState::Testing;
         mOJProblemModel.update(row);
+        //same condition as OJProblemCasesRunner::run()
+        bool concurrent = pSettings->executor().problemCasesConcurrency()>1 && total>1;
         QModelIndex idx = ui->tblProblemCases->currentIndex();
-        if (!idx.isValid() || row != idx.row()) {
+        if (concurrent) {
+            //don't jump between the running cases, only reset the output of the selected one
+            if (!idx.isValid() || row != idx.row())
+                return;
+        } else if (!idx.isValid() || row != idx.row()) {
             ui->tblProblemCases->setCurrentIndex(mOJProblemModel.index(row,0));
         }
         ui->txtProblemCaseOutput->clearAll();
+        updateProblemCaseOutputActions(problemCase);
         if (ui->txtProblemCaseExpected->document()->blockCount()<=5000) {
             ui->txtProblemCaseExpected->clearFormat();
         }
@@ -6152,12 +6198,19 @@ void MainWindow::onOJProblemCaseFinished(const QString& id, int current, int tot
     int row = mOJProblemModel.getCaseIndexById(id);
     if (row>=0) {
         POJProblemCase problemCase = mOJProblemModel.getCase(row);
-        ProblemCaseValidator validator;
-        problemCase->testState = validator.validate(problemCase,pSettings->executor().problemCaseValidateType())?
-                    ProblemCaseTestState::Passed:
-                    ProblemCaseTestState::Failed;
+        if (problemCase->validatedState!=ProblemCaseTestState::NotTested) {
+            problemCase->testState = problemCase->validatedState;
+        } else {
+            ProblemCaseValidator validator;
+            problemCase->testState = validator.validate(problemCase,pSettings->executor().problemCaseValidateType())?
+                        ProblemCaseTestState::Passed:
+                        ProblemCaseTestState::Failed;
+        }
         mOJProblemModel.update(row);
-        updateProblemCaseOutput(problemCase);
+        if (row == ui->tblProblemCases->currentIndex().row()) {
+            updateProblemCaseOutput(problemCase);
+            updateProblemCaseOutputActions(problemCase);
+        }
     }
     ui->pbProblemCases->setMaximum(total);
     ui->pbProblemCases->setValue(current);
@@ -6169,8 +6222,12 @@ void MainWindow::onOJProblemCaseNewOutputGetted(const QString &/* id */, const Q
     ui->txtProblemCaseOutput->appendPlainText(line);
 }
 
-void MainWindow::onOJProblemCaseResetOutput(const QString &/* id */, const QString &line)
+void MainWindow::onOJProblemCaseResetOutput(const QString &id, const QString &line)
 {
+    //another case may be selected when cases are run concurrently
+    int row = mOJProblemModel.getCaseIndexById(id);
+    if (row<0 || row != ui->tblProblemCases->currentIndex().row())
+        return;
     ui->txtProblemCaseOutput->clearAll();
     ui->txtProblemCaseOutput->setPlainText(line);
 }
@@ -8295,6 +8352,28 @@ void MainWindow::updateProblemCaseOutput(POJProblemCase problemCase)
     }
 }
 
+void MainWindow::updateProblemCaseOutputActions(POJProblemCase problemCase)
+{
+    //only the beginning of a large output is shown, the rest is in a temporary file
+    bool partial = problemCase
+            && problemCase->testState != ProblemCaseTestState::Testing
+            && problemCase->outputCapture
+            && problemCase->outputCapture->spilled();
+    ui->btnProblemCaseOutputLoadMore->setVisible(partial);
+    ui->btnProblemCaseOutputOpen->setVisible(partial);
+    if (partial) {
+        QLocale locale = QLocale::system();
+        qint64 size = problemCase->outputCapture->size();
+        ui->btnProblemCaseOutputLoadMore->setEnabled(problemCase->outputShownSize < size);
+        ui->lblProblemCaseOutputCaption->setText(
+                    tr("Output (%1 of %2 shown)")
+                    .arg(locale.formattedDataSize(problemCase->outputShownSize),
+                         locale.formattedDataSize(size)));
+    } else {
+        ui->lblProblemCaseOutputCaption->setText(tr("Output"));
+    }
+}
+
 void MainWindow::applyCurrentProblemCaseChanges()
 {
     QModelIndex idx = ui->tblProblemCases->currentIndex();
@@ -9666,6 +9745,45 @@ void MainWindow::on_txtProblemCaseOutput_cursorPositionChanged()
 }
 
 
+void MainWindow::on_btnProblemCaseOutputLoadMore_clicked()
+{
+    QModelIndex idx = ui->tblProblemCases->currentIndex();
+    if (!idx.isValid())
+        return;
+    POJProblemCase problemCase = mOJProblemModel.getCase(idx.row());
+    if (!problemCase || !problemCase->outputCapture
+            || problemCase->testState == ProblemCaseTestState::Testing)
+        return;
+    const int pageSize = 4*1024*1024;
+    PProcessOutputCapture output = problemCase->outputCapture;
+    QByteArray page = output->read(problemCase->outputShownSize, pageSize);
+    if (problemCase->outputShownSize + page.length() < output->size()) {
+        int lineEnd = page.lastIndexOf('\n');
+        if (lineEnd>=0)
+            page.truncate(lineEnd+1);
+    }
+    if (page.isEmpty())
+        return;
+    QString text = QString::fromLocal8Bit(page);
+    problemCase->output += text;
+    problemCase->outputShownSize += page.length();
+    QTextCursor cursor(ui->txtProblemCaseOutput->document());
+    cursor.movePosition(QTextCursor::End);
+    cursor.insertText(text);
+    updateProblemCaseOutputActions(problemCase);
+}
+
+void MainWindow::on_btnProblemCaseOutputOpen_clicked()
+{
+    QModelIndex idx = ui->tblProblemCases->currentIndex();
+    if (!idx.isValid())
+        return;
+    POJProblemCase problemCase = mOJProblemModel.getCase(idx.row());
+    if (!problemCase || !problemCase->outputCapture || !problemCase->outputCapture->spilled())
+        return;
+    openFile(problemCase->outputCapture->fileName());
+}
+
 void MainWindow::on_txtProblemCaseExpected_cursorPositionChanged()
 {
     QTextCursor cursor = ui->txtProblemCaseExpected->textCursor();
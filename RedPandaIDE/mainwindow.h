@@ -317,6 +317,7 @@ private:
     void doCompileRun(RunType runType);
     void doGenerateAssembly();
     void updateProblemCaseOutput(POJProblemCase problemCase);
+    void updateProblemCaseOutputActions(POJProblemCase problemCase);
     void applyCurrentProblemCaseChanges();
     void showHideInfosTab(QWidget *widget, bool show);
     void showHideMessagesTab(QWidget *widget, bool show);
@@ -352,6 +353,7 @@ private slots:
     void invalidateProjectProxyModel();
     void onEditorRenamed(const QString &oldFilename, const QString &newFilename, bool firstSave);
     void onAutoSaveTimeout();
+    void onPaintStatisticsTimeout();
     void onFileChanged(const QString &path);
     void onDirChanged(const QString &path);
     void onFilesViewPathChanged();
@@ -751,6 +753,10 @@ private slots:
 
     void on_txtProblemCaseOutput_cursorPositionChanged();
 
+    void on_btnProblemCaseOutputLoadMore_clicked();
+
+    void on_btnProblemCaseOutputOpen_clicked();
+
     void on_txtProblemCaseExpected_cursorPositionChanged();
 
     void on_txtProblemCaseInput_cursorPositionChanged();
@@ -867,6 +873,7 @@ private:
     QLabel *mFileInfoStatus;
     LabelWithMenu *mFileEncodingStatus;
     QLabel *mFileModeStatus;
+    QLabel *mPaintStatisticsStatus;
     QMenu *mMenuEncoding;
     QMenu *mMenuNewline;
     QMenu *mMenuExport;
@@ -934,6 +941,7 @@ private:
     QMap<QWidget*, PTabWidgetInfo> mTabMessagesData;
 
     QTimer mAutoSaveTimer;
+    QTimer mPaintStatisticsTimer;
 
     CaretList mCaretList;
 
@@ -20,11 +20,15 @@
 #include "qsynedit/syntaxer/cpp.h"
 
 #include <QApplication>
+#include <QCryptographicHash>
 #include <QDate>
+#include <QFileInfo>
 #include <QHash>
 #include <QQueue>
 #include <QRegularExpression>
+#include <QSemaphore>
 #include <QThread>
+#include <QThreadPool>
 #include <QTime>
 
 static QAtomicInt cppParserCount(0);
@@ -64,7 +68,11 @@ CppParser::CppParser(QObject *parent) : QObject(parent),
 
     mCppKeywords = CppKeywords;
     mCppTypeKeywords = CppTypeKeywords;
+    mTokenizer.setKeywords(mCppKeywords);
     mEnabled = true;
+    mSymbolCacheLoaded = false;
+    mParseFilesConcurrently = false;
+    mRecordFunctionBodies = false;
 
     internalClear();
 
@@ -818,7 +826,7 @@ QStringList CppParser::getClassesList() const
         for (PStatement& child:statementMap) {
             if (child->kind == StatementKind::Class)
                 list.append(child->command);
-            if (!child->children.isEmpty())
+            if (!mStatementList.childrenStatements(child).isEmpty())
                 queue.enqueue(child);
         }
     }
@@ -1030,10 +1038,21 @@ void CppParser::parseFile(const QString &fileName, bool inProject, bool onlyIfNo
             }
             mParsing = false;
         });
+        loadSymbolCache();
         QString fName = fileName;
         if (onlyIfNotParsed && mPreprocessor.fileScanned(fName))
             return;
 
+        if (fileName != mIncrementalParseFile) {
+            mIncrementalParseFile = fileName;
+            clearIncrementalParseInfo();
+        }
+        if (parseFileIncrementally(fileName)) {
+            mFilesToScanCount = 1;
+            mFilesScannedCount = 1;
+            emit onProgress(fileName,mFilesToScanCount,mFilesScannedCount);
+            return;
+        }
         if (inProject) {
             QSet<QString> filesToReparsed = calculateFilesToBeReparsed(fileName);
             QStringList files = sortFilesByIncludeRelations(filesToReparsed);
@@ -1042,15 +1061,10 @@ void CppParser::parseFile(const QString &fileName, bool inProject, bool onlyIfNo
             mFilesToScanCount = files.count();
             mFilesScannedCount = 0;
 
-            foreach (const QString& file,files) {
-                mFilesScannedCount++;
-                emit onProgress(file,mFilesToScanCount,mFilesScannedCount);
-                if (!mPreprocessor.fileScanned(file)) {
-                    internalParse(file);
-                }
-            }
+            parseFiles(files);
         } else {
             internalInvalidateFile(fileName);
+            mStringPool.pruneIfGrown();
             mFilesToScanCount = 1;
             mFilesScannedCount = 0;
 
@@ -1058,6 +1072,7 @@ void CppParser::parseFile(const QString &fileName, bool inProject, bool onlyIfNo
             emit onProgress(fileName,mFilesToScanCount,mFilesScannedCount);
             internalParse(fileName);
         }
+        saveSymbolCache();
     }
 }
 
@@ -1083,20 +1098,18 @@ void CppParser::parseFileList(bool updateView)
             else
                 emit onEndParsing(mFilesScannedCount,0);
         });
+        loadSymbolCache();
+        mIncrementalParseFile.clear();
+        clearIncrementalParseInfo();
         // Support stopping of parsing when files closes unexpectedly
         mFilesScannedCount = 0;
         mFilesToScanCount = mFilesToScan.count();
 
         QStringList files = sortFilesByIncludeRelations(mFilesToScan);
         // parse header files in the first parse
-        foreach (const QString& file, files) {
-            mFilesScannedCount++;
-            emit onProgress(mCurrentFile,mFilesToScanCount,mFilesScannedCount);
-            if (!mPreprocessor.fileScanned(file)) {
-                internalParse(file);
-            }
-        }
+        parseFiles(files);
         mFilesToScan.clear();
+        saveSymbolCache();
     }
 }
 
@@ -1179,6 +1192,14 @@ void CppParser::resetParser()
         mClassInheritances.clear();
         mPreprocessor.clear();
         mTokenizer.clear();
+
+        mSymbolCacheDir.clear();
+        mSymbolCacheLoaded = false;
+        mCachedFiles.clear();
+        mBaseLayer.reset();
+        mIncrementalParseFile.clear();
+        clearIncrementalParseInfo();
+        mStringPool.clear();
     }
 }
 
@@ -1436,7 +1457,8 @@ PStatement CppParser::addStatement(const PStatement& parent,
         //find
         if (properties.testFlag(StatementProperty::HasDefinition)) {
             PStatement oldStatement = findStatementInScope(newCommand,noNameArgs,kind,parent);
-            if (oldStatement  && !oldStatement->hasDefinition()) {
+            if (oldStatement  && !oldStatement->hasDefinition()
+                    && !oldStatement->inBaseLayer()) {
                 oldStatement->setHasDefinition(true);
                 if (oldStatement->fileName!=fileName) {
                     PParsedFileInfo fileInfo = mPreprocessor.findFileInfo(fileName);
@@ -1452,25 +1474,26 @@ PStatement CppParser::addStatement(const PStatement& parent,
     }
     PStatement result = std::make_shared<Statement>();
     result->parentScope = parent;
-    result->type = newType;
+    // names, types and file names are highly duplicated, so share them
+    result->type = mStringPool.intern(newType);
     if (!newCommand.isEmpty())
-        result->command = newCommand;
+        result->command = mStringPool.intern(newCommand);
     else {
         mUniqId++;
         result->command = QString("__STATEMENT__%1").arg(mUniqId);
     }
-    result->args = args;
-    result->noNameArgs = noNameArgs;
-    result->value = value;
-    result->templateSpecializationParams = templateSpecializationParams;
+    result->args = mStringPool.intern(args);
+    result->noNameArgs = mStringPool.intern(noNameArgs);
+    result->value = mStringPool.intern(value);
+    result->templateSpecializationParams = mStringPool.intern(templateSpecializationParams);
     result->kind = kind;
     result->scope = scope;
     result->accessibility = accessibility;
     result->properties = properties;
     result->line = line;
     result->definitionLine = line;
-    result->fileName = fileName;
-    result->definitionFileName = fileName;
+    result->fileName = mStringPool.intern(fileName);
+    result->definitionFileName = result->fileName;
     if (!fileName.isEmpty()) {
         result->setInProject(mIsProjectFile);
         result->setInSystemHeader(mIsSystemHeader);
@@ -1482,12 +1505,7 @@ PStatement CppParser::addStatement(const PStatement& parent,
         result->fullName =  newCommand;
     else
         result->fullName =  getFullStatementName(newCommand + templateSpecializationParams, parent);
-    result->usageCount = -1;
 
-    result->args.squeeze();
-    result->noNameArgs.squeeze();
-    result->value.squeeze();
-    result->type.squeeze();
     mStatementList.add(result);
     if (result->kind == StatementKind::Namespace) {
         PStatementList namespaceList = doFindNamespace(result->fullName);
@@ -1642,8 +1660,8 @@ void CppParser::setInheritance(int index, const PStatement& classStatement, bool
             index=mTokenizer[index]->matchIndex;
         } else if (currentText=="::"
                    || (isIdentChar(currentText[0]))) {
-            KeywordType keywordType = mCppKeywords.value(currentText, KeywordType::None);
-            if (keywordType!=KeywordType::None) {
+            KeywordType keywordType = mTokenizer[index]->keywordType;
+            if (keywordType!=KeywordType::None && keywordType!=KeywordType::NotKeyword) {
                 StatementAccessibility inheritScopeType = getClassMemberAccessibility(mTokenizer[index]->text);
                 if (inheritScopeType != StatementAccessibility::None) {
                     lastInheritScopeType = inheritScopeType;
@@ -1784,7 +1802,7 @@ void CppParser::removeScopeLevel(int line, int maxIndex)
     PParsedFileInfo fileInfo = mPreprocessor.findFileInfo(mCurrentFile);
     if (currentScope) {
         if (currentScope->kind == StatementKind::Block) {
-            if (currentScope->children.isEmpty()) {
+            if (mStatementList.childrenStatements(currentScope).isEmpty()) {
                 // remove no children block
                 if (fileInfo)
                     fileInfo->removeLastScope();
@@ -2042,7 +2060,7 @@ int CppParser::evaluateLiteralNumber(int endIndex, bool &ok)
 
 bool CppParser::checkForKeyword(KeywordType& keywordType)
 {
-    keywordType = mCppKeywords.value(mTokenizer[mIndex]->text,KeywordType::NotKeyword);
+    keywordType = mTokenizer[mIndex]->keywordType;
     switch(keywordType) {
     case KeywordType::Catch:
     case KeywordType::For:
@@ -2108,7 +2126,7 @@ bool CppParser::checkForStructs(KeywordType keywordType, int maxIndex)
             mIndex++;
             return false;
         }
-        result = (mCppKeywords.value(mTokenizer[mIndex+dis]->text,KeywordType::None)==KeywordType::Struct);
+        result = (mTokenizer[mIndex+dis]->keywordType==KeywordType::Struct);
     } else {
         result = (keywordType==KeywordType::Struct);
     }
@@ -2167,7 +2185,7 @@ bool CppParser::checkForTypedefStruct(int maxIndex)
     //should call CheckForTypedef first!!!
     if (mIndex+1 >= maxIndex)
         return false;
-    return (mCppKeywords.value(mTokenizer[mIndex+1]->text,KeywordType::None)==KeywordType::Struct);
+    return (mTokenizer[mIndex+1]->keywordType==KeywordType::Struct);
 
 }
 
@@ -2891,14 +2909,14 @@ void CppParser::handleForBlock(int maxIndex)
     if (i2>=maxIndex)
         return;
     if (mTokenizer[i2]->text=='{') {
-        mTokenizer[mIndex]->text="{";
+        mTokenizer.setTokenText(mIndex,"{");
         mTokenizer[mIndex]->matchIndex = mTokenizer[i2]->matchIndex;
         mTokenizer[mTokenizer[mIndex]->matchIndex]->matchIndex = mIndex;
-        mTokenizer[i]->text=";";
-        mTokenizer[i2]->text=";";
+        mTokenizer.setTokenText(i,";");
+        mTokenizer.setTokenText(i2,";");
     } else {
-        mTokenizer[mIndex]->text=";";
-        mTokenizer[i]->text=";";
+        mTokenizer.setTokenText(mIndex,";");
+        mTokenizer.setTokenText(i,";");
         mIndex++; //skip ';'
     }
 }
@@ -3190,6 +3208,8 @@ void CppParser::handleMethod(StatementKind functionKind,const QString &sType, co
     }
 
     if ((mIndex < maxIndex) && mTokenizer[mIndex]->text.startsWith('{')) {
+        if (mRecordFunctionBodies)
+            recordFunctionBody(functionStatement, mIndex);
         addSoloScopeLevel(functionStatement,startLine);
         mIndex++; //skip '{'
     } else if ((mIndex < maxIndex) && mTokenizer[mIndex]->text.startsWith(';')) {
@@ -3558,7 +3578,7 @@ bool CppParser::handleStatement(int maxIndex)
 //        handleLambda();
     } else if (mTokenizer[mIndex]->text=='(') {
         if (mIndex+1<maxIndex &&
-                mTokenizer[mIndex+1]->text=="operator") {
+                mTokenizer[mIndex+1]->keywordType==KeywordType::Operator) {
             // things like (operator int)
             mIndex++; //just skip '('
         } else
@@ -4390,9 +4410,12 @@ void CppParser::handleInheritance(PStatement derivedStatement, PClassInheritance
                               inheritanceInfo->visibility);
 //        inheritanceInfo->parentClassFilename = statement->fileName;
         inheritanceInfo->handled = true;
-        PParsedFileInfo fileInfo = mPreprocessor.findFileInfo(statement->fileName);
-        Q_ASSERT(fileInfo!=nullptr);
-        fileInfo->addHandledInheritances(inheritanceInfo);
+        //files in the base layer are never invalidated
+        if (!statement->inBaseLayer()) {
+            PParsedFileInfo fileInfo = mPreprocessor.findFileInfo(statement->fileName);
+            Q_ASSERT(fileInfo!=nullptr);
+            fileInfo->addHandledInheritances(inheritanceInfo);
+        }
     }
 
 }
@@ -4466,6 +4489,20 @@ void CppParser::internalParse(const QString &fileName)
         mTokenizer.clear();
     });
     //timer.start();
+    QStringList preprocessResult = preprocessFile(fileName);
+    //qDebug()<<"preprocess"<<timer.elapsed();
+
+    //timer.restart();
+    // Tokenize the preprocessed buffer file
+    mTokenizer.tokenize(preprocessResult);
+    //reduce memory usage
+    preprocessResult.clear();
+    //qDebug()<<"tokenize"<<timer.elapsed();
+    handleTokens(fileName);
+}
+
+QStringList CppParser::preprocessFile(const QString &fileName)
+{
     // Let the preprocessor augment the include records
     mPreprocessor.setScanOptions(mParseGlobalHeaders, mParseLocalHeaders);
     mPreprocessor.preprocess(fileName);
@@ -4476,18 +4513,23 @@ void CppParser::internalParse(const QString &fileName)
        // mPreprocessor.dumpDefinesTo("z:\\defines.txt");
        // mPreprocessor.dumpIncludesListTo("z:\\includes.txt");
 #endif
-    //qDebug()<<"preprocess"<<timer.elapsed();
     //reduce memory usage
-    //timer.restart();
     mPreprocessor.clearTempResults();
-    //qDebug()<<"preprocess clean"<<timer.elapsed();
+    return preprocessResult;
+}
 
-    //timer.restart();
-    // Tokenize the preprocessed buffer file
-    mTokenizer.tokenize(preprocessResult);
-    //reduce memory usage
-    preprocessResult.clear();
-    //qDebug()<<"tokenize"<<timer.elapsed();
+void CppParser::handleTokens(const QString& fileName)
+{
+    if (fileName == mIncrementalParseFile) {
+        clearIncrementalParseInfo();
+        mIncrementalParseTokens.reserve(mTokenizer.tokenCount());
+        for (int i=0;i<mTokenizer.tokenCount();i++)
+            mIncrementalParseTokens.append(*mTokenizer[i]);
+        mRecordFunctionBodies = true;
+    }
+    auto action = finally([this]{
+        mRecordFunctionBodies = false;
+    });
     if (mTokenizer.tokenCount() == 0)
         return;
 #ifdef QT_DEBUG
@@ -4516,6 +4558,492 @@ void CppParser::internalParse(const QString &fileName)
     internalClear();
 }
 
+namespace {
+struct TokenizingFile {
+    QString fileName;
+    bool skipped;
+    CppTokenizer tokenizer;
+    QSemaphore tokenized;
+};
+}
+
+void CppParser::parseFiles(const QStringList &files)
+{
+    if (!mParseFilesConcurrently || files.count()<2) {
+        foreach (const QString& file,files) {
+            mFilesScannedCount++;
+            emit onProgress(file,mFilesToScanCount,mFilesScannedCount);
+            if (!mPreprocessor.fileScanned(file)) {
+                internalParse(file);
+            }
+        }
+        return;
+    }
+    if (!mEnabled)
+        return;
+    // Statements must be handled in order (a file may use symbols defined in the files before it),
+    // and preprocessing depends on the defines of the headers processed before.
+    // So only tokenizing runs in parallel: we preprocess a few files ahead,
+    // tokenize them in the thread pool, and handle their tokens in order.
+    QThreadPool *pool = QThreadPool::globalInstance();
+    int maxPending = std::max(2, pool->maxThreadCount() * 2);
+    QQueue<std::shared_ptr<TokenizingFile>> pendingFiles;
+    int next = 0;
+    while (next < files.count() || !pendingFiles.isEmpty()) {
+        while (next < files.count() && pendingFiles.count() < maxPending) {
+            std::shared_ptr<TokenizingFile> pendingFile = std::make_shared<TokenizingFile>();
+            pendingFile->fileName = files[next];
+            next++;
+            pendingFiles.enqueue(pendingFile);
+            // it may be scanned as a header when preprocessing the files before it
+            pendingFile->skipped = mPreprocessor.fileScanned(pendingFile->fileName);
+            if (pendingFile->skipped) {
+                pendingFile->tokenized.release();
+                continue;
+            }
+            QStringList preprocessResult = preprocessFile(pendingFile->fileName);
+            pendingFile->tokenizer.setKeywords(mCppKeywords);
+            pool->start([pendingFile, preprocessResult]{
+                pendingFile->tokenizer.tokenize(preprocessResult);
+                pendingFile->tokenized.release();
+            });
+        }
+        std::shared_ptr<TokenizingFile> pendingFile = pendingFiles.dequeue();
+        mFilesScannedCount++;
+        emit onProgress(pendingFile->fileName,mFilesToScanCount,mFilesScannedCount);
+        pendingFile->tokenized.acquire();
+        if (pendingFile->skipped)
+            continue;
+        mTokenizer.swap(pendingFile->tokenizer);
+        handleTokens(pendingFile->fileName);
+        mTokenizer.clear();
+    }
+}
+
+bool CppParser::parseFileIncrementally(const QString &fileName)
+{
+    if (!mEnabled || fileName != mIncrementalParseFile || mIncrementalParseTokens.isEmpty())
+        return false;
+    PParsedFileInfo oldFileInfo = mPreprocessor.findFileInfo(fileName);
+    if (!oldFileInfo)
+        return false;
+    PDefineMap oldDefines = mPreprocessor.fileDefines(fileName);
+    PDefineMap oldUndefines = mPreprocessor.fileUndefines(fileName);
+
+    auto action = finally([this]{
+        mTokenizer.clear();
+    });
+    mPreprocessor.removeScannedFile(fileName);
+    QStringList preprocessResult = preprocessFile(fileName);
+    mTokenizer.tokenize(preprocessResult);
+    preprocessResult.clear();
+    PParsedFileInfo fileInfo = mPreprocessor.findFileInfo(fileName);
+
+    // compare with the tokens of the last parse:
+    // tokens in [prefix, oldEnd) are replaced by tokens in [prefix, newEnd),
+    // and old tokens after them are moved by lineDelta lines.
+    const QVector<CppTokenizer::Token>& oldTokens = mIncrementalParseTokens;
+    int oldCount = oldTokens.count();
+    int newCount = mTokenizer.tokenCount();
+    int prefix = 0;
+    while (prefix<oldCount && prefix<newCount
+           && oldTokens[prefix].line == mTokenizer[prefix]->line
+           && oldTokens[prefix].text == mTokenizer[prefix]->text)
+        prefix++;
+    int lineDelta = 0;
+    if (oldCount>0 && newCount>0)
+        lineDelta = mTokenizer[newCount-1]->line - oldTokens[oldCount-1].line;
+    int suffix = 0;
+    while (prefix+suffix<oldCount && prefix+suffix<newCount) {
+        const CppTokenizer::Token& oldToken = oldTokens[oldCount-1-suffix];
+        const CppTokenizer::Token* newToken = mTokenizer[newCount-1-suffix];
+        if (newToken->line - oldToken.line != lineDelta
+                || newToken->text != oldToken.text)
+            break;
+        suffix++;
+    }
+    int oldEnd = oldCount - suffix;
+    int newEnd = newCount - suffix;
+    int indexDelta = newCount - oldCount;
+    int shiftLine = (oldEnd<oldCount)?oldTokens[oldEnd].line:INT_MAX;
+
+    // the changes must be inside the body of a function (and not preprocessor lines),
+    // so only statements in that body are affected
+    bool canPatch = fileInfo && newCount>0;
+    if (canPatch && lineDelta!=0 && prefix>0 && oldTokens[prefix-1].line>=shiftLine)
+        canPatch = false;
+    for (int i=prefix;canPatch && i<oldEnd;i++) {
+        if (oldTokens[i].text.startsWith('#'))
+            canPatch = false;
+    }
+    for (int i=prefix;canPatch && i<newEnd;i++) {
+        if (mTokenizer[i]->text.startsWith('#'))
+            canPatch = false;
+    }
+    PStatement function;
+    int bodyStart = -1;
+    int scopeStart = -1;
+    int scopeEnd = -1;
+    const QVector<PCppScope>& oldScopes = oldFileInfo->scopes().scopes();
+    auto isInFunction = [&function](PStatement statement) {
+        while (statement) {
+            if (statement == function)
+                return true;
+            statement = statement->parentScope.lock();
+        }
+        return false;
+    };
+    if (canPatch && (prefix<oldEnd || prefix<newEnd)) {
+        auto it = mIncrementalParseBodies.upperBound(prefix-1);
+        if (it == mIncrementalParseBodies.begin()) {
+            canPatch = false;
+        } else {
+            --it;
+            bodyStart = it.key();
+            function = it.value().function.lock();
+            scopeStart = it.value().scopeIndex;
+            int bodyEnd = oldTokens[bodyStart].matchIndex;
+            if (!function
+                    || bodyEnd < oldEnd
+                    || mTokenizer[bodyStart]->matchIndex != bodyEnd + indexDelta
+                    || scopeStart >= oldScopes.count()
+                    || oldScopes[scopeStart]->statement != function) {
+                canPatch = false;
+            } else {
+                // scopes inside the function body
+                scopeEnd = scopeStart + 1;
+                while (scopeEnd<oldScopes.count() && isInFunction(oldScopes[scopeEnd]->statement))
+                    scopeEnd++;
+                if (scopeEnd>=oldScopes.count())
+                    canPatch = false;
+            }
+        }
+    }
+    if (!canPatch) {
+        // restore, and let the caller do a full reparse
+        mPreprocessor.removeScannedFile(fileName);
+        mPreprocessor.addScannedFile(oldFileInfo, oldDefines, oldUndefines);
+        return false;
+    }
+
+    QVector<CppTokenizer::Token> newTokens;
+    newTokens.reserve(newCount);
+    for (int i=0;i<newCount;i++)
+        newTokens.append(*mTokenizer[i]);
+
+    // remove old statements in the function body (but keep its parameters)
+    auto isFunctionParameter = [&function](const PStatement& statement) {
+        return statement->parentScope.lock() == function
+                && (statement->kind == StatementKind::Parameter
+                    || statement->command == "this"
+                    || statement->command == "__func__");
+    };
+    if (function) {
+        foreach (const PStatement& statement, oldFileInfo->statements()) {
+            if (statement!=function && isInFunction(statement) && !isFunctionParameter(statement))
+                mStatementList.deleteStatement(statement);
+        }
+        foreach (const PStatement& statement, mStatementList.childrenStatements(function)) {
+            if (!isFunctionParameter(statement))
+                mStatementList.deleteStatement(statement);
+        }
+    }
+    // keep other statements, and move them to their new lines
+    QSet<Statement*> movedStatements;
+    foreach (const PStatement& statement, oldFileInfo->statements()) {
+        if (function && statement!=function && isInFunction(statement) && !isFunctionParameter(statement))
+            continue;
+        fileInfo->addStatement(statement);
+        if (lineDelta==0 || movedStatements.contains(statement.get()))
+            continue;
+        movedStatements.insert(statement.get());
+        if (statement->fileName == fileName && statement->line >= shiftLine)
+            statement->line += lineDelta;
+        if (statement->definitionFileName == fileName && statement->definitionLine >= shiftLine)
+            statement->definitionLine += lineDelta;
+    }
+    foreach (const QString& usingName, oldFileInfo->usings())
+        fileInfo->addUsing(usingName);
+    foreach (const std::weak_ptr<ClassInheritanceInfo>& info, oldFileInfo->handledInheritances())
+        fileInfo->addHandledInheritances(info);
+
+    // parse the function body again
+    int newScopeCount = 0;
+    if (function) {
+        fileInfo->addScope(oldScopes[scopeStart]->startLine, function);
+        mCurrentFile = fileName;
+        mIsSystemHeader = isSystemHeaderFile(mCurrentFile) || isProjectHeaderFile(mCurrentFile);
+        mIsProjectFile = mProjectFiles.contains(mCurrentFile);
+        mIsHeader = isHFile(mCurrentFile);
+        mCurrentScope.append(function);
+        mCurrentMemberAccessibility = StatementAccessibility::Public;
+        mMemberAccessibilities.push_back(mCurrentMemberAccessibility);
+        while (mTokenizer.lambdasCount()>0 && mTokenizer.indexOfFirstLambda()<=bodyStart)
+            mTokenizer.removeFirstLambda();
+        int bodyEnd = mTokenizer[bodyStart]->matchIndex;
+        mIndex = bodyStart + 1;
+#ifdef QT_DEBUG
+        mLastIndex = -1;
+#endif
+        if (mIndex < bodyEnd) {
+            while (handleStatement(bodyEnd))
+                ;
+        }
+        handleInheritances();
+        internalClear();
+        newScopeCount = fileInfo->scopes().scopes().count();
+    }
+
+    // merge the scopes
+    CppScopes scopes;
+    auto addOldScope=[&scopes, shiftLine, lineDelta](const PCppScope& scope) {
+        scopes.addScope(scope->startLine>=shiftLine?scope->startLine+lineDelta:scope->startLine,
+                        scope->statement);
+    };
+    if (function) {
+        for (int i=0;i<scopeStart;i++)
+            addOldScope(oldScopes[i]);
+        foreach (const PCppScope& scope, fileInfo->scopes().scopes())
+            scopes.addScope(scope->startLine, scope->statement);
+        for (int i=scopeEnd;i<oldScopes.count();i++)
+            addOldScope(oldScopes[i]);
+    } else {
+        foreach (const PCppScope& scope, oldScopes)
+            addOldScope(scope);
+    }
+    fileInfo->setScopes(scopes);
+
+    // update infos for the next incremental parse
+    int scopeIndexDelta = function?(newScopeCount - (scopeEnd - scopeStart)):0;
+    QMap<int,FunctionBody> bodies;
+    for (auto it=mIncrementalParseBodies.begin();it!=mIncrementalParseBodies.end();++it) {
+        if (it.key() < prefix) {
+            bodies.insert(it.key(), it.value());
+        } else {
+            FunctionBody body = it.value();
+            body.scopeIndex += scopeIndexDelta;
+            bodies.insert(it.key() + indexDelta, body);
+        }
+    }
+    mIncrementalParseBodies = bodies;
+    mIncrementalParseTokens = newTokens;
+    return true;
+}
+
+void CppParser::recordFunctionBody(const PStatement &functionStatement, int bodyStart)
+{
+    if (!functionStatement || mCurrentFile != mIncrementalParseFile)
+        return;
+    // only top level functions
+    PStatement scope = functionStatement->parentScope.lock();
+    while (scope) {
+        switch (scope->kind) {
+        case StatementKind::Function:
+        case StatementKind::Constructor:
+        case StatementKind::Destructor:
+        case StatementKind::Block:
+        case StatementKind::Lambda:
+            return;
+        default:
+            break;
+        }
+        scope = scope->parentScope.lock();
+    }
+    PParsedFileInfo fileInfo = mPreprocessor.findFileInfo(mCurrentFile);
+    if (!fileInfo)
+        return;
+    FunctionBody body;
+    body.function = functionStatement;
+    body.scopeIndex = fileInfo->scopes().scopes().count();
+    mIncrementalParseBodies.insert(bodyStart, body);
+}
+
+void CppParser::clearIncrementalParseInfo()
+{
+    mIncrementalParseTokens.clear();
+    mIncrementalParseBodies.clear();
+}
+
+QString CppParser::symbolCacheKey() const
+{
+    QStringList defines;
+    foreach (const PDefine& define, mPreprocessor.hardDefines()) {
+        defines.append(QString("%1%2 %3").arg(define->name, define->args, define->value));
+    }
+    defines.sort();
+    return QString("%1\n%2\n%3").arg(
+                QString::number((int)mLanguage),
+                QStringList(mPreprocessor.includePathList()).join(";"),
+                defines.join("\n"));
+}
+
+QString CppParser::symbolCacheFileName() const
+{
+    QByteArray hash = QCryptographicHash::hash(symbolCacheKey().toUtf8(), QCryptographicHash::Sha1).toHex();
+    return includeTrailingPathDelimiter(mSymbolCacheDir) + QString::fromLatin1(hash) + ".symbols";
+}
+
+void CppParser::loadSymbolCache()
+{
+    if (mSymbolCacheLoaded)
+        return;
+    mSymbolCacheLoaded = true;
+    if (mSymbolCacheDir.isEmpty() || !mParseGlobalHeaders)
+        return;
+    QList<SymbolCacheFile> files;
+    StatementList statements;
+    if (!SymbolCache::load(symbolCacheFileName(), symbolCacheKey(), files, statements))
+        return;
+    foreach (const SymbolCacheFile& file, files) {
+        //don't mix with files that's already parsed
+        if (mPreprocessor.fileScanned(file.fileName))
+            return;
+    }
+    foreach (const PStatement& statement, statements) {
+        mStatementList.add(statement);
+        if (statement->kind == StatementKind::Namespace) {
+            PStatementList namespaceList = doFindNamespace(statement->fullName);
+            if (!namespaceList) {
+                namespaceList=std::make_shared<StatementList>();
+                mNamespaces.insert(statement->fullName,namespaceList);
+            }
+            namespaceList->append(statement);
+        }
+    }
+    foreach (const SymbolCacheFile& file, files) {
+        mPreprocessor.addScannedFile(file.fileInfo, file.defines, file.undefines);
+        mCachedFiles.insert(file.fileName);
+    }
+}
+
+void CppParser::saveSymbolCache()
+{
+    if (mSymbolCacheDir.isEmpty() || !mParseGlobalHeaders)
+        return;
+    QSet<QString> systemFiles = systemHeaderFiles();
+    if (systemFiles.isEmpty() || systemFiles == mCachedFiles)
+        return;
+
+    QList<SymbolCacheFile> files;
+    StatementList statements;
+    collectSymbols(systemFiles, files, statements);
+    if (SymbolCache::save(symbolCacheFileName(), symbolCacheKey(), files, statements))
+        mCachedFiles = systemFiles;
+}
+
+QSet<QString> CppParser::systemHeaderFiles() const
+{
+    QSet<QString> systemFiles;
+    foreach (const QString& file, mPreprocessor.scannedFiles()) {
+        if (mCachedFiles.contains(file)
+                || ::isSystemHeaderFile(file, mPreprocessor.includePaths()))
+            systemFiles.insert(file);
+    }
+    return systemFiles;
+}
+
+void CppParser::collectSymbols(const QSet<QString> &files, QList<SymbolCacheFile> &cacheFiles, StatementList &statements) const
+{
+    // statements in the files, parents before their children
+    std::function<void (const StatementMap&)> collectStatements =
+            [this, &statements, &files, &collectStatements](const StatementMap& map) {
+        foreach (const PStatement& statement, map) {
+            if (!files.contains(statement->fileName))
+                continue;
+            statements.append(statement);
+            collectStatements(mStatementList.childrenStatements(statement));
+        }
+    };
+    collectStatements(mStatementList.childrenStatements());
+
+    foreach (const QString& fileName, files) {
+        PParsedFileInfo fileInfo = mPreprocessor.findFileInfo(fileName);
+        if (!fileInfo)
+            continue;
+        SymbolCacheFile file;
+        file.fileName = fileName;
+        file.lastModified = QFileInfo(fileName).lastModified().toMSecsSinceEpoch();
+        file.fileInfo = fileInfo;
+        file.defines = mPreprocessor.fileDefines(fileName);
+        file.undefines = mPreprocessor.fileUndefines(fileName);
+        cacheFiles.append(file);
+    }
+}
+
+PParserBaseLayer CppParser::createBaseLayer()
+{
+    QMutexLocker locker(&mMutex);
+    if (mParsing || !mParseGlobalHeaders)
+        return PParserBaseLayer();
+    QSet<QString> systemFiles = systemHeaderFiles();
+    if (systemFiles.isEmpty())
+        return PParserBaseLayer();
+
+    QList<SymbolCacheFile> files;
+    StatementList statements;
+    collectSymbols(systemFiles, files, statements);
+
+    std::shared_ptr<ParserBaseLayer> layer = std::make_shared<ParserBaseLayer>();
+    layer->key = symbolCacheKey();
+    layer->statementCount = statements.count();
+    foreach (const PStatement& statement, statements) {
+        statement->properties.setFlag(StatementProperty::InBaseLayer);
+        if (!statement->parentScope.lock())
+            layer->statements.insert(statement->command, statement);
+        if (statement->kind == StatementKind::Namespace)
+            layer->namespaces[statement->fullName].append(statement);
+    }
+    layer->inlineNamespaces = mInlineNamespaces;
+    foreach (const SymbolCacheFile& file, files) {
+        layer->fileInfos.append(file.fileInfo);
+        if (file.defines)
+            layer->fileDefines.insert(file.fileName, file.defines);
+        if (file.undefines)
+            layer->fileUndefines.insert(file.fileName, file.undefines);
+    }
+    return layer;
+}
+
+bool CppParser::attachBaseLayer(const PParserBaseLayer &layer)
+{
+    QMutexLocker locker(&mMutex);
+    if (mParsing || !layer || mBaseLayer || !mParseGlobalHeaders)
+        return false;
+    if (layer->key != symbolCacheKey())
+        return false;
+    foreach (const PParsedFileInfo& fileInfo, layer->fileInfos) {
+        //don't mix with files that's already parsed
+        if (mPreprocessor.fileScanned(fileInfo->fileName()))
+            return false;
+    }
+    mBaseLayer = layer;
+    mStatementList.addBaseStatements(layer->statements, layer->statementCount);
+    // user files may add statements to the same namespace, so don't share the lists
+    for (auto it=layer->namespaces.begin();it!=layer->namespaces.end();++it) {
+        PStatementList namespaceList = doFindNamespace(it.key());
+        if (!namespaceList) {
+            namespaceList=std::make_shared<StatementList>();
+            mNamespaces.insert(it.key(),namespaceList);
+        }
+        namespaceList->append(it.value());
+    }
+    mInlineNamespaces.unite(layer->inlineNamespaces);
+    foreach (const PParsedFileInfo& fileInfo, layer->fileInfos) {
+        mPreprocessor.addScannedFile(fileInfo,
+                                     layer->fileDefines.value(fileInfo->fileName()),
+                                     layer->fileUndefines.value(fileInfo->fileName()));
+        mCachedFiles.insert(fileInfo->fileName());
+    }
+    // system headers are already in the layer
+    mSymbolCacheLoaded = true;
+    return true;
+}
+
+const PParserBaseLayer &CppParser::baseLayer() const
+{
+    return mBaseLayer;
+}
+
 void CppParser::inheritClassStatement(const PStatement& derived, bool isStruct,
                                       const PStatement& base, StatementAccessibility access)
 {
@@ -4526,14 +5054,15 @@ void CppParser::inheritClassStatement(const PStatement& derived, bool isStruct,
         else
             access = StatementAccessibility::Private;
     }
-    foreach (const PStatement& statement, base->children) {
+    foreach (const PStatement& statement, mStatementList.childrenStatements(base)) {
         if (statement->accessibility == StatementAccessibility::Private
                 || statement->kind == StatementKind::Constructor
                 || statement->kind == StatementKind::Destructor)
             continue;
-        if (derived->children.contains(statement->command)) {
+        const StatementMap& derivedChildren = mStatementList.childrenStatements(derived);
+        if (derivedChildren.contains(statement->command)) {
             // Check if it's overwritten(hidden) by the derived
-            QList<PStatement> children = derived->children.values(statement->command);
+            QList<PStatement> children = derivedChildren.values(statement->command);
             bool overwritten = false;
             foreach(const PStatement& child, children) {
                 if (!child->isInherited() && child->noNameArgs == statement->noNameArgs) {
@@ -6042,6 +6571,9 @@ void CppParser::internalInvalidateFile(const QString &fileName)
     if (fileName.isEmpty())
         return;
 
+    if (fileName == mIncrementalParseFile)
+        clearIncrementalParseInfo();
+
     // remove its include files list
     PParsedFileInfo p = mPreprocessor.findFileInfo(fileName);
     if (p) {
@@ -6095,6 +6627,8 @@ void CppParser::internalInvalidateFiles(const QSet<QString> &files)
 {
     for (const QString& file:files)
         internalInvalidateFile(file);
+    // release the strings of the removed statements
+    mStringPool.pruneIfGrown();
 }
 
 QSet<QString> CppParser::calculateFilesToBeReparsed(const QString &fileName)
@@ -6680,7 +7214,11 @@ int CppParser::skipAssignment(int index, int maxIndex)
 
 QString CppParser::mergeArgs(int startIndex, int endIndex)
 {
+    int length = 0;
+    for (int i=startIndex;i<=endIndex;i++)
+        length += mTokenizer[i]->text.length()+1;
     QString result;
+    result.reserve(length);
     for (int i=startIndex;i<=endIndex;i++) {
         if (i>startIndex)
             result+=' ';
@@ -6755,6 +7293,28 @@ QList<QString> CppParser::namespaces()
     return mNamespaces.keys();
 }
 
+bool CppParser::parseFilesConcurrently() const
+{
+    return mParseFilesConcurrently;
+}
+
+void CppParser::setParseFilesConcurrently(bool newParseFilesConcurrently)
+{
+    QMutexLocker locker(&mMutex);
+    mParseFilesConcurrently = newParseFilesConcurrently;
+}
+
+const QString &CppParser::symbolCacheDir() const
+{
+    return mSymbolCacheDir;
+}
+
+void CppParser::setSymbolCacheDir(const QString &newSymbolCacheDir)
+{
+    QMutexLocker locker(&mMutex);
+    mSymbolCacheDir = newSymbolCacheDir;
+}
+
 ParserLanguage CppParser::language() const
 {
     return mLanguage;
@@ -6772,6 +7332,7 @@ void CppParser::setLanguage(ParserLanguage newLanguage)
             mCppTypeKeywords.unite(SDCCTypeKeywords);
         }
 #endif
+        mTokenizer.setKeywords(mCppKeywords);
     }
 }
 
@@ -6869,11 +7430,18 @@ CppFileParserThread::CppFileParserThread(
             this,&QObject::deleteLater);
 }
 
+void CppFileParserThread::setAfterParsed(const std::function<void ()> &afterParsed)
+{
+    mAfterParsed = afterParsed;
+}
+
 void CppFileParserThread::run()
 {
     if (mParser) {
         mParser->parseFile(mFileName,mInProject,mOnlyIfNotParsed,mUpdateView,mParser);
     }
+    if (mAfterParsed)
+        mAfterParsed();
 }
 
 CppFileListParserThread::CppFileListParserThread(PCppParser parser,
@@ -6893,7 +7461,8 @@ void CppFileListParserThread::run()
     }
 }
 
-void parseFile(PCppParser parser, const QString& fileName, bool inProject, bool onlyIfNotParsed, bool updateView)
+void parseFile(PCppParser parser, const QString& fileName, bool inProject, bool onlyIfNotParsed, bool updateView,
+               const std::function<void ()>& afterParsed)
 {
     if (!parser)
         return;
@@ -6902,6 +7471,7 @@ void parseFile(PCppParser parser, const QString& fileName, bool inProject, bool
 //    qDebug()<<"parsing "<<fileName;
     //delete when finished
     CppFileParserThread* thread = new CppFileParserThread(parser,fileName,inProject,onlyIfNotParsed,updateView);
+    thread->setAfterParsed(afterParsed);
     thread->connect(thread,
                     &QThread::finished,
                     thread,
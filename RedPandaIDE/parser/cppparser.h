@@ -24,6 +24,7 @@
 #include "statementmodel.h"
 #include "cpptokenizer.h"
 #include "cpppreprocessor.h"
+#include "symbolcache.h"
 
 class CppParser : public QObject
 {
@@ -163,6 +164,29 @@ public:
 
     QList<QString> namespaces();
 
+    const QString &symbolCacheDir() const;
+    void setSymbolCacheDir(const QString &newSymbolCacheDir);
+    QString symbolCacheKey() const;
+
+    bool parseFilesConcurrently() const;
+    void setParseFilesConcurrently(bool newParseFilesConcurrently);
+
+    /**
+     * @brief hand the parsed system headers over to a read-only base layer
+     *
+     * The statements are not copied, so the parser should have parsed only system headers,
+     * and must not be used after it. The base layer can be attached to other parsers with
+     * the same symbol cache key.
+     */
+    PParserBaseLayer createBaseLayer();
+    /**
+     * @brief use the system header symbols in the base layer, instead of parsing them
+     *
+     * It should be called right after the parser is reset.
+     */
+    bool attachBaseLayer(const PParserBaseLayer& layer);
+    const PParserBaseLayer& baseLayer() const;
+
 signals:
     void onProgress(const QString& fileName, int total, int current);
     void onBusy();
@@ -540,6 +564,16 @@ private:
     void handleInheritances();
     void skipRequires(int maxIndex);
     void internalParse(const QString& fileName);
+    QStringList preprocessFile(const QString& fileName);
+    void handleTokens(const QString& fileName);
+    void parseFiles(const QStringList& files);
+    QString symbolCacheFileName() const;
+    QSet<QString> systemHeaderFiles() const;
+    void collectSymbols(const QSet<QString>& files,
+                        QList<SymbolCacheFile>& cacheFiles,
+                        StatementList& statements) const;
+    void loadSymbolCache();
+    void saveSymbolCache();
 //    function FindMacroDefine(const Command: AnsiString): PStatement;
     void inheritClassStatement(
             const PStatement& derived,
@@ -702,7 +736,16 @@ private:
                                  QString& args) const;
     QString expandMacro(const QString& text) const;
     static QStringList splitExpression(const QString& expr);
+
+    bool parseFileIncrementally(const QString& fileName);
+    void recordFunctionBody(const PStatement& functionStatement, int bodyStart);
+    void clearIncrementalParseInfo();
 private:
+    struct FunctionBody {
+        std::weak_ptr<Statement> function;
+        int scopeIndex; // index of the function's scope in the file info
+    };
+
     int mParserId;
     ParserLanguage mLanguage;
     int mSerialCount;
@@ -747,6 +790,19 @@ private:
     QSet<QString> mCppTypeKeywords;
 
     PParseFileCommand mLastParseFileCommand;
+
+    QString mSymbolCacheDir;
+    bool mSymbolCacheLoaded;
+    QSet<QString> mCachedFiles; // system headers that's saved in/loaded from the symbol cache
+    PParserBaseLayer mBaseLayer;
+    bool mParseFilesConcurrently;
+    StringPool mStringPool;
+
+    // infos of the last parse of the current editing file, used by parseFileIncrementally()
+    QString mIncrementalParseFile;
+    QVector<CppTokenizer::Token> mIncrementalParseTokens; // tokens before they're modified by the parser
+    QMap<int,FunctionBody> mIncrementalParseBodies; // top level function bodies, keyed by index of '{'
+    bool mRecordFunctionBodies;
 };
 using PCppParser = std::shared_ptr<CppParser>;
 
@@ -760,6 +816,8 @@ public:
             bool onlyIfNotParsed = false,
             bool updateView = true,
             QObject *parent = nullptr);
+    // called in the thread after the file is parsed
+    void setAfterParsed(const std::function<void ()> &afterParsed);
 
 private:
     PCppParser mParser;
@@ -767,6 +825,7 @@ private:
     bool mInProject;
     bool mOnlyIfNotParsed;
     bool mUpdateView;
+    std::function<void ()> mAfterParsed;
 
     // QThread interface
 protected:
@@ -794,7 +853,8 @@ void parseFile(
     const QString& fileName,
     bool inProject,
     bool onlyIfNotParsed = false,
-    bool updateView = true);
+    bool updateView = true,
+    const std::function<void ()>& afterParsed = std::function<void ()>());
 
 void parseFileList(
         PCppParser parser,
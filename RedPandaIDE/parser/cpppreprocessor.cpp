@@ -62,6 +62,7 @@ void CppPreprocessor::clearTempResults()
     mBranchResults.clear();// stack of branch results (boolean). last one is current branch, first one is outermost branch
     //mDefines.clear(); // working set, editable
     mProcessed.clear(); // dictionary to save filename already processed
+    mIncludedFiles.clear();
 }
 
 void CppPreprocessor::addDefineByParts(const QString &name, const QString &args, const QString &value, bool hardCoded)
@@ -240,6 +241,17 @@ void CppPreprocessor::removeScannedFile(const QString &filename)
     mFileUndefines.remove(filename);
 }
 
+void CppPreprocessor::addScannedFile(const PParsedFileInfo &fileInfo, const PDefineMap &defines, const PDefineMap &undefines)
+{
+    const QString& fileName = fileInfo->fileName();
+    mScannedFiles.insert(fileName);
+    mFileInfos.insert(fileName, fileInfo);
+    if (defines)
+        mFileDefines.insert(fileName, defines);
+    if (undefines)
+        mFileUndefines.insert(fileName, undefines);
+}
+
 QString CppPreprocessor::getNextPreprocessor()
 {
     skipToPreprocessor(); // skip until # at start of line
@@ -754,6 +766,9 @@ void CppPreprocessor::openInclude(QString fileName)
         innerMostFile->fileInfo->addDirectInclude(fileName);
         if (alreadyIncluded)
             return;
+        // Its guard is defined, so including it again doesn't change anything
+        if (isIncludeGuarded(fileInfo))
+            return;
         // Backup old position if we're entering a new file
         innerMostFile->index = mIndex;
         innerMostFile->branches = mBranchResults.count();
@@ -774,10 +789,13 @@ void CppPreprocessor::openInclude(QString fileName)
     parsedFile->fileInfo = mCurrentFileInfo;
 
     // Don't parse stuff we have already parsed
+    bool newlyScanned = false;
     if (!mScannedFiles.contains(fileName)) {
         // Parse ONCE
         //if not Assigned(Stream) then
         mScannedFiles.insert(fileName);
+        mIncludedFiles.insert(fileName);
+        newlyScanned = true;
 
         // Only load up the file if we are allowed to parse it
         bool isSystemFile = isSystemHeaderFile(fileName, mIncludePaths) || isSystemHeaderFile(fileName, mProjectIncludePaths);
@@ -798,8 +816,16 @@ void CppPreprocessor::openInclude(QString fileName)
     // Process it
     mIndex = parsedFile->index;
     mFileName = parsedFile->fileName;
-    parsedFile->buffer = removeComments(parsedFile->buffer);
+    if (!parsedFile->buffer.isEmpty())
+        parsedFile->buffer = removeComments(parsedFile->buffer);
     mBuffer = parsedFile->buffer;
+    if (newlyScanned) {
+        QString guard;
+        if (findIncludeGuard(mBuffer, guard))
+            mCurrentFileInfo->setIncludeGuard(guard);
+        else
+            mCurrentFileInfo->clearIncludeGuard();
+    }
 
 //    for (int i=0;i<mBuffer.count();i++) {
 //        mBuffer[i] = mBuffer[i].trimmed();
@@ -815,6 +841,105 @@ void CppPreprocessor::openInclude(QString fileName)
 }
 
 
+bool CppPreprocessor::isIncludeGuarded(const PParsedFileInfo &fileInfo) const
+{
+    if (!fileInfo->includeGuarded())
+        return false;
+    // The first include in this processing must add its defines
+    if (!mIncludedFiles.contains(fileInfo->fileName()))
+        return false;
+    return fileInfo->includeGuard().isEmpty()
+            || mDefines.contains(fileInfo->includeGuard());
+}
+
+bool CppPreprocessor::findIncludeGuard(const QStringList &buffer, QString &macro)
+{
+    // the buffer is comment-removed and trimmed
+    QList<int> lines; // non-empty lines
+    bool pragmaOnce = false;
+    bool directiveFound = false;
+    for (int i=0;i<buffer.count();i++) {
+        const QString& line = buffer[i];
+        if (line.isEmpty())
+            continue;
+        lines.append(i);
+        // #pragma once in a conditional branch may not take effect,
+        // so only accept it before any other directive
+        if (line.startsWith('#') && !directiveFound) {
+            directiveFound = true;
+            QString directive = line.mid(1).trimmed();
+            if (directive.startsWith("pragma") && directive.mid(6).trimmed()=="once")
+                pragmaOnce = true;
+        }
+    }
+    if (pragmaOnce) {
+        macro.clear();
+        return true;
+    }
+    if (lines.count()<3)
+        return false;
+
+    // #ifndef X / #if !defined(X)
+    QString directive = buffer[lines.front()];
+    if (!directive.startsWith('#'))
+        return false;
+    directive = directive.mid(1).trimmed();
+    QString name;
+    if (directive.startsWith("ifndef")) {
+        name = directive.mid(6).trimmed();
+    } else if (directive.startsWith("if")) {
+        name = directive.mid(2).trimmed();
+        if (!name.startsWith('!'))
+            return false;
+        name = name.mid(1).trimmed();
+        if (!name.startsWith("defined"))
+            return false;
+        name = name.mid(7).trimmed();
+        if (name.startsWith('(') && name.endsWith(')'))
+            name = name.mid(1, name.length()-2).trimmed();
+    } else
+        return false;
+    if (name.isEmpty())
+        return false;
+    foreach (const QChar& ch, name) {
+        if (!isWordChar(ch))
+            return false;
+    }
+
+    // #define X
+    directive = buffer[lines[1]];
+    if (!directive.startsWith('#'))
+        return false;
+    directive = directive.mid(1).trimmed();
+    if (!directive.startsWith("define"))
+        return false;
+    directive = directive.mid(6).trimmed();
+    if (!directive.startsWith(name)
+            || (directive.length()>name.length() && isWordChar(directive[name.length()])))
+        return false;
+
+    // the matching #endif must be the last line
+    int depth = 1;
+    for (int i=2;i<lines.count();i++) {
+        const QString& line = buffer[lines[i]];
+        if (!line.startsWith('#'))
+            continue;
+        directive = line.mid(1).trimmed();
+        if (directive.startsWith("if")) {
+            depth++;
+        } else if (directive.startsWith("endif")) {
+            depth--;
+            if (depth==0)
+                return (i==lines.count()-1);
+        } else if (directive.startsWith("el")) {
+            // #else or #elif of the guard
+            if (depth==1)
+                return false;
+        }
+    }
+    return false;
+}
+
 void CppPreprocessor::closeInclude()
 {
     if (mIncludeStack.isEmpty())
@@ -862,6 +987,8 @@ void CppPreprocessor::addDefinesInFile(const QString &fileName)
         return;
     mProcessed.insert(fileName);
 
+    mIncludedFiles.insert(fileName);
+
     // then add the defines defined in it
     PDefineMap defineList = mFileDefines.value(fileName, PDefineMap());
     if (defineList) {
@@ -872,8 +999,19 @@ void CppPreprocessor::addDefinesInFile(const QString &fileName)
 
     PParsedFileInfo fileInfo = findFileInfo(fileName);
     if (fileInfo) {
+        // includes() contains all files it includes directly or indirectly,
+        // so we don't need to go deeper.
         foreach (const QString& file, fileInfo->includes()) {
-            addDefinesInFile(file);
+            if (mProcessed.contains(file))
+                continue;
+            mProcessed.insert(file);
+            mIncludedFiles.insert(file);
+            defineList = mFileDefines.value(file, PDefineMap());
+            if (defineList) {
+                foreach (const PDefine& define, defineList->values()) {
+                    mDefines.insert(define->name,define);
+                }
+            }
         }
     }
 }
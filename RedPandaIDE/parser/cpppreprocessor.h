@@ -127,6 +127,13 @@ public:
 
     const DefineMap &hardDefines() const { return mHardDefines; }
 
+    PDefineMap fileDefines(const QString& fileName) const { return mFileDefines.value(fileName); }
+    PDefineMap fileUndefines(const QString& fileName) const { return mFileUndefines.value(fileName); }
+    /**
+     * @brief add a file that's parsed before (e.g. loaded from the symbol cache) as scanned
+     */
+    void addScannedFile(const PParsedFileInfo& fileInfo, const PDefineMap& defines, const PDefineMap& undefines);
+
     const QList<QString> &includePathList() const { return mIncludePathList; }
 
     const QList<QString> &projectIncludePathList() const { return mProjectIncludePathList; }
@@ -164,6 +171,8 @@ private:
     }
     void openInclude(QString fileName);
     void closeInclude();
+    bool isIncludeGuarded(const PParsedFileInfo& fileInfo) const;
+    static bool findIncludeGuard(const QStringList& buffer, QString& macro);
 
     // branch stuff
     BranchResult getCurrentBranch(){
@@ -280,6 +289,7 @@ private:
     QList<BranchResult> mBranchResults;// stack of branch results (boolean). last one is current branch, first one is outermost branch
     DefineMap mDefines; // working set, editable
     QSet<QString> mProcessed; // dictionary to save filename already processed
+    QSet<QString> mIncludedFiles; // files scanned or whose defines are added in this processing
 
 
     //Result across processings.
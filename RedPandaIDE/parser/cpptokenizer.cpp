@@ -28,7 +28,6 @@ CppTokenizer::CppTokenizer()
 void CppTokenizer::clear()
 {
     mTokenList.clear();
-    mBuffer.clear();
     mBufferStr.clear();
     mLastToken.clear();
     mUnmatchedBraces.clear();
@@ -41,14 +40,11 @@ void CppTokenizer::tokenize(const QStringList &buffer)
 {
     clear();
 
-    mBuffer = buffer;
-    if (mBuffer.isEmpty())
+    if (buffer.isEmpty())
         return;
-    mBufferStr = mBuffer[0];
-    for (int i=1;i<mBuffer.size();i++) {
-        mBufferStr+='\n';
-        mBufferStr+=mBuffer[i];
-    }
+    mBufferStr = buffer.join('\n');
+    //each line generates about 2~3 tokens
+    mTokenList.reserve(buffer.count()*2);
     //QByteArray is always '\0'-terminated unless it's created by QbyteArray::fromRawData()
     //mBufferStr.append(QChar(0));
     mStart = mBufferStr.constData();
@@ -78,63 +74,79 @@ void CppTokenizer::tokenize(const QStringList &buffer)
     }
 }
 
+void CppTokenizer::swap(CppTokenizer &other)
+{
+    mTokenList.swap(other.mTokenList);
+    mLambdas.swap(other.mLambdas);
+}
+
+void CppTokenizer::setTokenText(int i, const QString &text)
+{
+    Token& token = mTokenList[i];
+    token.text = text;
+    token.keywordType = mKeywords.value(text, KeywordType::NotKeyword);
+}
+
 void CppTokenizer::dumpTokens(const QString &fileName)
 {
     QFile file(fileName);
 
     if (file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
         QTextStream stream(&file);
-        foreach (const PToken& token,mTokenList) {
-            stream<<QString("%1,%2,%3").arg(token->line).arg(token->text).arg(token->matchIndex)<<Qt::endl;
+        foreach (const Token& token,mTokenList) {
+            stream<<QString("%1,%2,%3").arg(token.line).arg(token.text).arg(token.matchIndex)<<Qt::endl;
         }
     }
 }
 
 void CppTokenizer::addToken(const QString &sText, int iLine, TokenType tokenType)
 {
-    PToken token = std::make_shared<Token>();
-    token->text = sText;
-    token->line = iLine;
-#ifdef Q_DEBUG
-    token->matchIndex = 1000000000;
-#endif
+    Token token;
+    token.text = sText;
+    token.line = iLine;
+    token.matchIndex = 1000000000;
+    //only words can be keywords
+    if (isIdentChar(sText.front()))
+        token.keywordType = mKeywords.value(sText, KeywordType::NotKeyword);
+    else
+        token.keywordType = KeywordType::NotKeyword;
     switch(tokenType) {
     case TokenType::LeftBrace:
-        token->matchIndex=-1;
+        token.matchIndex=-1;
         mUnmatchedBraces.push_back(mTokenList.count());
         break;
     case TokenType::RightBrace:
         if (mUnmatchedBraces.isEmpty()) {
-            token->matchIndex=-1;
+            token.matchIndex=-1;
         } else {
-            token->matchIndex = mUnmatchedBraces.last();
-            mTokenList[token->matchIndex]->matchIndex=mTokenList.count();
+            token.matchIndex = mUnmatchedBraces.last();
+            mTokenList[token.matchIndex].matchIndex=mTokenList.count();
             mUnmatchedBraces.pop_back();
         }
         break;
     case TokenType::LeftBracket:
-        token->matchIndex=-1;
+        token.matchIndex=-1;
         mUnmatchedBrackets.push_back(mTokenList.count());
         break;
     case TokenType::RightBracket:
         if (mUnmatchedBrackets.isEmpty()) {
-            token->matchIndex=-1;
+            token.matchIndex=-1;
         } else {
-            token->matchIndex = mUnmatchedBrackets.last();
-            mTokenList[token->matchIndex]->matchIndex=mTokenList.count();
+            token.matchIndex = mUnmatchedBrackets.last();
+            mTokenList[token.matchIndex].matchIndex=mTokenList.count();
             mUnmatchedBrackets.pop_back();
         }
         break;
     case TokenType::LeftParenthesis:
-        token->matchIndex=-1;
+        token.matchIndex=-1;
         mUnmatchedParenthesis.push_back(mTokenList.count());
         break;
     case TokenType::RightParenthesis:
         if (mUnmatchedParenthesis.isEmpty()) {
-            token->matchIndex=-1;
+            token.matchIndex=-1;
         } else {
-            token->matchIndex = mUnmatchedParenthesis.last();
-            mTokenList[token->matchIndex]->matchIndex=mTokenList.count();
+            token.matchIndex = mUnmatchedParenthesis.last();
+            mTokenList[token.matchIndex].matchIndex=mTokenList.count();
             mUnmatchedParenthesis.pop_back();
         }
         break;
@@ -39,17 +39,31 @@ public:
       QString text;
       int line;
       int matchIndex;
+      KeywordType keywordType; // NotKeyword if the text is not a keyword
     };
-    using PToken = std::shared_ptr<Token>;
-    using TokenList = QVector<PToken>;
+    // tokens are stored by value, so tokenizing doesn't allocate each token on the heap
+    using TokenList = QVector<Token>;
     explicit CppTokenizer();
     CppTokenizer(const CppTokenizer&)=delete;
     CppTokenizer& operator=(const CppTokenizer&)=delete;
 
     void clear();
+    /**
+     * @brief set the keywords used to classify the tokens
+     */
+    void setKeywords(const QMap<QString,KeywordType>& keywords) { mKeywords = keywords; }
     void tokenize(const QStringList& buffer);
+    /**
+     * @brief exchange the tokenize results with another tokenizer
+     */
+    void swap(CppTokenizer& other);
     void dumpTokens(const QString& fileName);
-    const PToken& operator[](int i) const { return mTokenList[i]; }
+    Token* operator[](int i) { return &mTokenList[i]; }
+    const Token* operator[](int i) const { return &mTokenList[i]; }
+    /**
+     * @brief change the text of the token, and reclassify it
+     */
+    void setTokenText(int i, const QString& text);
     int tokenCount() const { return mTokenList.count(); }
     static bool isIdentChar(const QChar& ch) { return ch=='_' || ch.isLetter(); }
     int lambdasCount() const { return mLambdas.count(); }
@@ -144,8 +158,8 @@ private:
     }
 
 private:
-    QStringList mBuffer;
     QString mBufferStr;
+    QMap<QString,KeywordType> mKeywords;
     const QChar* mStart;
     const QChar* mCurrent;
     const QChar* mLineCount;
@@ -21,6 +21,7 @@
 #include <QFileInfo>
 #include <QDebug>
 #include <QGlobalStatic>
+#include <algorithm>
 #include "../systemconsts.h"
 #include "../utils.h"
 
@@ -754,6 +755,39 @@ bool isTypeKind(StatementKind kind)
     }
 }
 
+QString StringPool::intern(const QString &s)
+{
+    if (s.isEmpty())
+        return QString();
+    auto it = mStrings.constFind(s);
+    if (it!=mStrings.constEnd())
+        return *it;
+    QString str = s;
+    str.squeeze();
+    mStrings.insert(str);
+    return str;
+}
+
+void StringPool::prune()
+{
+    for (auto it=mStrings.begin();it!=mStrings.end();) {
+        //only referenced by the pool
+        if (it->isDetached())
+            it = mStrings.erase(it);
+        else
+            ++it;
+    }
+    mCountAfterPrune = mStrings.count();
+}
+
+void StringPool::pruneIfGrown()
+{
+    // grown by a half (and at least 4096 strings) since the last prune
+    if (mStrings.count() - mCountAfterPrune < std::max(4096, mCountAfterPrune / 2))
+        return;
+    prune();
+}
+
 bool ParsedFileInfo::isLineVisible(int line) const
 {
     int lastI=-1;
@@ -167,7 +167,8 @@ enum class StatementProperty {
     Constexpr =           0x0080,
     FunctionPointer =     0x0100,
     OperatorOverloading = 0x0200,
-    DummyStatement     =  0x0400
+    DummyStatement     =  0x0400,
+    InBaseLayer =         0x0800
 };
 
 Q_DECLARE_FLAGS(StatementProperties, StatementProperty)
@@ -203,14 +204,6 @@ struct Statement {
     QSet<QString> lambdaCaptures;
     StatementProperties properties;
 
-    // fields for code completion
-    int usageCount; //Usage Count
-    uint16_t matchPosTotal; // total of matched positions
-    uint16_t matchPosSpan; // distance between the first match pos and the last match pos;
-    uint16_t firstMatchLength; // length of first match;
-    uint16_t caseMatched; // if match with case
-    QList<PStatementMathPosition> matchPositions;
-
     // definiton line/filename is valid
     bool hasDefinition() {
         return properties.testFlag(StatementProperty::HasDefinition);
@@ -241,6 +234,10 @@ struct Statement {
     bool isInherited() {
         return properties.testFlag(StatementProperty::Inherited);
     } // inherted member;
+    // statement in the shared base layer, which must not be modified
+    bool inBaseLayer() {
+        return properties.testFlag(StatementProperty::InBaseLayer);
+    }
 
 };
 
@@ -302,6 +299,7 @@ public:
             mScopes.pop_back();
     }
     void clear() { mScopes.clear(); }
+    const QVector<PCppScope>& scopes() const { return mScopes; }
 private:
     QVector<PCppScope> mScopes;
 };
@@ -321,7 +319,7 @@ using PClassInheritanceInfo = std::shared_ptr<ClassInheritanceInfo>;
 
 class ParsedFileInfo {
 public:
-    ParsedFileInfo(const QString& fileName): mFileName {fileName} { }
+    ParsedFileInfo(const QString& fileName): mFileName {fileName}, mIncludeGuarded {false} { }
     ParsedFileInfo(const ParsedFileInfo&)=delete;
     ParsedFileInfo& operator=(const ParsedFileInfo&)=delete;
     void insertBranch(int level, bool branchTrue) { mBranches.insert(level, branchTrue); }
@@ -333,11 +331,18 @@ public:
     void addStatement(const PStatement &statement) { mStatements.insert(statement->fullName,statement); }
     void clearStatements() { mStatements.clear(); }
     void addScope(int line, const PStatement &scope) { mScopes.addScope(line,scope); }
+    void setScopes(const CppScopes& scopes) { mScopes = scopes; }
     void removeLastScope() { mScopes.removeLastScope(); }
     PStatement lastScope() const { return mScopes.lastScope(); }
     void addUsing(const QString &usingSymbol) { mUsings.insert(usingSymbol); }
     void addHandledInheritances(std::weak_ptr<ClassInheritanceInfo> classInheritanceInfo) { mHandledInheritances.append(classInheritanceInfo); }
     void clearHandledInheritances() { mHandledInheritances.clear(); }
+    /**
+     * @brief the whole file is guarded by "#ifndef macro ... #endif" or "#pragma once"
+     * @param macro name of the guard macro, empty for "#pragma once"
+     */
+    void setIncludeGuard(const QString& macro) { mIncludeGuarded = true; mIncludeGuard = macro; }
+    void clearIncludeGuard() { mIncludeGuarded = false; mIncludeGuard.clear(); }
 
     QString fileName() const { return mFileName; }
     const StatementMap& statements() const { return mStatements; }
@@ -345,6 +350,10 @@ public:
     const QStringList& directIncludes() const { return mDirectIncludes; }
     const QSet<QString>& includes() const { return mIncludes; }
     const QList<std::weak_ptr<ClassInheritanceInfo> >& handledInheritances() const { return mHandledInheritances; }
+    const CppScopes& scopes() const { return mScopes; }
+    const QMap<int,bool>& branches() const { return mBranches; }
+    bool includeGuarded() const { return mIncludeGuarded; }
+    const QString& includeGuard() const { return mIncludeGuard; }
 
 private:
     QString mFileName;
@@ -355,10 +364,52 @@ private:
     CppScopes mScopes; // int is start line of the statement scope
     QMap<int,bool> mBranches;
     QList<std::weak_ptr<ClassInheritanceInfo>> mHandledInheritances;
+    bool mIncludeGuarded;
+    QString mIncludeGuard;
 };
 
 using PParsedFileInfo = std::shared_ptr<ParsedFileInfo>;
 
+/**
+ * @brief Pool of shared strings
+ *
+ * Names, types and file names of statements are highly duplicated.
+ * Strings returned by intern() share their data, so each of them is stored only once.
+ * Strings that are no longer used by any statement are released by prune().
+ */
+class StringPool {
+public:
+    QString intern(const QString& s);
+    void prune();
+    // prune() walks the whole pool, so only do it after the pool has grown enough
+    void pruneIfGrown();
+    void clear() { mStrings.clear(); mCountAfterPrune = 0; }
+    int count() const { return mStrings.count(); }
+private:
+    QSet<QString> mStrings;
+    int mCountAfterPrune = 0;
+};
+
+/**
+ * @brief Read-only symbols of the system headers, shared by parsers
+ *
+ * Parsers with the same language, include paths and hard defines can attach it
+ * instead of parsing the system headers again, and only keep statements of their
+ * own files. Nothing in it should be modified after it's created.
+ */
+struct ParserBaseLayer {
+    QString key; // language, include paths and hard defines of the parsers
+    StatementMap statements; // global statements
+    int statementCount; // all statements, including the children
+    QHash<QString, StatementList> namespaces;
+    QSet<QString> inlineNamespaces;
+    QList<PParsedFileInfo> fileInfos;
+    QHash<QString, PDefineMap> fileDefines;
+    QHash<QString, PDefineMap> fileUndefines;
+};
+
+using PParserBaseLayer = std::shared_ptr<const ParserBaseLayer>;
+
 extern QStringList CppDirectives;
 extern QStringList JavadocTags;
 extern QMap<QString,KeywordType> CppKeywords;
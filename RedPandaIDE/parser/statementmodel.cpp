@@ -17,7 +17,9 @@
 #include "statementmodel.h"
 
 #include <QFile>
+#include <QSet>
 #include <QTextStream>
+#include <functional>
 
 StatementModel::StatementModel(QObject *parent) : QObject(parent)
 {
@@ -31,7 +33,14 @@ void StatementModel::add(const PStatement& statement)
     }
     PStatement parent = statement->parentScope.lock();
     if (parent) {
-        addMember(parent->children,statement);
+        if (parent->inBaseLayer()) {
+            auto it = mBaseChildren.find(parent.get());
+            if (it == mBaseChildren.end())
+                it = mBaseChildren.insert(parent.get(), parent->children);
+            addMember(it.value(),statement);
+        } else {
+            addMember(parent->children,statement);
+        }
     } else {
         addMember(mGlobalStatements,statement);
     }
@@ -41,6 +50,12 @@ void StatementModel::add(const PStatement& statement)
 #endif
 }
 
+void StatementModel::addBaseStatements(const StatementMap &statements, int count)
+{
+    mGlobalStatements.unite(statements);
+    mCount += count;
+}
+
 void StatementModel::deleteStatement(const PStatement& statement)
 {
     if (!statement) {
@@ -49,7 +64,14 @@ void StatementModel::deleteStatement(const PStatement& statement)
     PStatement parent = statement->parentScope.lock();
     int count = 0;
     if (parent) {
-        count = deleteMember(parent->children,statement);
+        if (parent->inBaseLayer()) {
+            auto it = mBaseChildren.find(parent.get());
+            if (it == mBaseChildren.end())
+                return;
+            count = deleteMember(it.value(),statement);
+        } else {
+            count = deleteMember(parent->children,statement);
+        }
     } else {
         count = deleteMember(mGlobalStatements,statement);
     }
@@ -60,6 +82,49 @@ void StatementModel::deleteStatement(const PStatement& statement)
 
 }
 
+QString StatementModel::memoryUsage() const
+{
+    int count = 0;
+    qint64 size = 0;
+    qint64 unsharedSize = 0;
+    QSet<const QChar*> countedStrings;
+    auto stringSize = [&](const QString& s) {
+        if (s.isNull())
+            return;
+        qint64 bytes = (s.capacity()+1)*sizeof(QChar) + sizeof(QArrayData);
+        unsharedSize += bytes;
+        if (countedStrings.contains(s.constData()))
+            return;
+        countedStrings.insert(s.constData());
+        size += bytes;
+    };
+    std::function<void (const StatementMap&)> countStatements =
+            [&](const StatementMap& map) {
+        foreach (const PStatement& statement, map) {
+            count++;
+            size += sizeof(Statement);
+            unsharedSize += sizeof(Statement);
+            stringSize(statement->type);
+            stringSize(statement->command);
+            stringSize(statement->args);
+            stringSize(statement->value);
+            stringSize(statement->templateSpecializationParams);
+            stringSize(statement->fileName);
+            stringSize(statement->definitionFileName);
+            stringSize(statement->fullName);
+            stringSize(statement->noNameArgs);
+            countStatements(childrenStatements(statement));
+        }
+    };
+    countStatements(mGlobalStatements);
+    if (count==0)
+        return QString("no statements");
+    return QString("%1 statements, %2 bytes per statement (%3 bytes if strings are not shared)")
+            .arg(count)
+            .arg(size/count)
+            .arg(unsharedSize/count);
+}
+
 #ifdef QT_DEBUG
 void StatementModel::dump(const QString &logFile)
 {
@@ -30,23 +30,38 @@ public:
     StatementModel& operator=(const StatementModel&)=delete;
 
     void add(const PStatement& statement);
+    /**
+     * @brief add global statements of the base layer (with their children)
+     * @param count count of all statements, including the children
+     */
+    void addBaseStatements(const StatementMap& statements, int count);
     void deleteStatement(const PStatement& statement);
     const StatementMap& childrenStatements(const PStatement& statement = PStatement()) const {
         if (!statement) {
             return mGlobalStatements;
-        } else {
-            return statement->children;
+        } else if (statement->inBaseLayer()) {
+            auto it = mBaseChildren.constFind(statement.get());
+            if (it != mBaseChildren.constEnd())
+                return it.value();
         }
+        return statement->children;
     }
     const StatementMap& childrenStatements(std::weak_ptr<Statement> statement) const { return childrenStatements(statement.lock()); }
     void clear() {
         mCount=0;
         mGlobalStatements.clear();
+        mBaseChildren.clear();
 #ifdef QT_DEBUG
         mAllStatements.clear();
 #endif
     }
     int count() const { return mCount; }
+    /**
+     * @brief estimated memory used by the statements
+     *
+     * Also reports the size if strings are not shared between statements.
+     */
+    QString memoryUsage() const;
 #ifdef QT_DEBUG
     void dump(const QString& logFile);
     void dumpAll(const QString& logFile);
@@ -58,6 +73,9 @@ private:
 private:
     int mCount;
     StatementMap mGlobalStatements;  //may have overloaded functions, so use PStatementList to store
+    //children of the base layer statements (like namespace std), with the ones added by this parser.
+    //statements in the base layer are shared by other parsers, so their children can't be changed.
+    QHash<const Statement*, StatementMap> mBaseChildren;
 #ifdef QT_DEBUG
     StatementList mAllStatements;
 #endif
@@ -0,0 +1,320 @@
+/*
+ * Copyright (C) 2020-2022 Roy Qu (royqh1979@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "symbolcache.h"
+#include "../utils.h"
+
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+static const quint32 SymbolCacheMagic = 0x52505343; // "RPSC"
+static const quint32 SymbolCacheVersion = 2;
+
+static void writeDefine(QDataStream& out, const PDefine& define)
+{
+    out<<define->name
+      <<define->args
+      <<define->value
+      <<define->filename
+      <<define->hardCoded
+      <<define->argUsed
+      <<(qint32)define->varArgIndex
+      <<define->formatValue;
+}
+
+static PDefine readDefine(QDataStream& in)
+{
+    PDefine define = std::make_shared<Define>();
+    qint32 varArgIndex;
+    in>>define->name
+     >>define->args
+     >>define->value
+     >>define->filename
+     >>define->hardCoded
+     >>define->argUsed
+     >>varArgIndex
+     >>define->formatValue;
+    define->varArgIndex = varArgIndex;
+    return define;
+}
+
+static void writeDefineMap(QDataStream& out, const PDefineMap& defines)
+{
+    if (!defines) {
+        out<<(qint32)-1;
+        return;
+    }
+    out<<(qint32)defines->count();
+    foreach (const PDefine& define, *defines) {
+        writeDefine(out, define);
+    }
+}
+
+static PDefineMap readDefineMap(QDataStream& in)
+{
+    qint32 count;
+    in>>count;
+    if (count<0)
+        return PDefineMap();
+    PDefineMap defines = std::make_shared<DefineMap>();
+    for (int i=0;i<count && in.status()==QDataStream::Ok;i++) {
+        PDefine define = readDefine(in);
+        defines->insert(define->name, define);
+    }
+    return defines;
+}
+
+static void writeSymbols(QDataStream& out, const QString &key, const QList<SymbolCacheFile> &files, const StatementList &statements)
+{
+    out.setVersion(QDataStream::Qt_5_15);
+    out<<SymbolCacheMagic<<SymbolCacheVersion<<key;
+
+    QSet<QString> fileNames;
+    // header: files and their modification time, so we can validate it quickly
+    out<<(qint32)files.count();
+    foreach (const SymbolCacheFile& cachedFile, files) {
+        out<<cachedFile.fileName<<cachedFile.lastModified;
+        fileNames.insert(cachedFile.fileName);
+    }
+
+    // statements (parent first)
+    QHash<const Statement*, qint32> ids;
+    out<<(qint32)statements.count();
+    foreach (const PStatement& statement, statements) {
+        PStatement parent = statement->parentScope.lock();
+        qint32 parentId = parent?ids.value(parent.get(),-1):-1;
+        StatementProperties properties = statement->properties;
+        QString definitionFileName = statement->definitionFileName;
+        int definitionLine = statement->definitionLine;
+        if (!fileNames.contains(definitionFileName)) {
+            //defined in a file that's not cached
+            properties.setFlag(StatementProperty::HasDefinition, false);
+            definitionFileName = statement->fileName;
+            definitionLine = statement->line;
+        }
+        out<<parentId
+          <<statement->type
+          <<statement->command
+          <<statement->args
+          <<statement->value
+          <<statement->templateSpecializationParams
+          <<(qint32)statement->kind
+          <<(qint32)statement->scope
+          <<(qint32)statement->accessibility
+          <<(qint32)statement->line
+          <<(qint32)definitionLine
+          <<statement->fileName
+          <<definitionFileName
+          <<statement->friends
+          <<statement->fullName
+          <<statement->usingList
+          <<statement->noNameArgs
+          <<statement->lambdaCaptures
+          <<(quint32)properties;
+        ids.insert(statement.get(),ids.count());
+    }
+
+    // file infos and defines
+    foreach (const SymbolCacheFile& cachedFile, files) {
+        const PParsedFileInfo& fileInfo = cachedFile.fileInfo;
+        out<<fileInfo->includes().values()
+          <<fileInfo->directIncludes()
+          <<fileInfo->usings().values();
+        QList<qint32> statementIds;
+        foreach (const PStatement& statement, fileInfo->statements()) {
+            qint32 id = ids.value(statement.get(),-1);
+            if (id>=0)
+                statementIds.append(id);
+        }
+        out<<statementIds;
+        const QVector<PCppScope> &scopes = fileInfo->scopes().scopes();
+        out<<(qint32)scopes.count();
+        foreach (const PCppScope& scope, scopes) {
+            qint32 id = scope->statement?ids.value(scope->statement.get(),-1):-1;
+            out<<(qint32)scope->startLine<<id;
+        }
+        out<<fileInfo->branches();
+        out<<fileInfo->includeGuarded()<<fileInfo->includeGuard();
+        writeDefineMap(out, cachedFile.defines);
+        writeDefineMap(out, cachedFile.undefines);
+    }
+}
+
+static bool readSymbols(QDataStream& in, const QString &key, QList<SymbolCacheFile> &files, StatementList &statements)
+{
+    files.clear();
+    statements.clear();
+    in.setVersion(QDataStream::Qt_5_15);
+    quint32 magic, version;
+    QString cacheKey;
+    in>>magic>>version;
+    if (magic!=SymbolCacheMagic || version!=SymbolCacheVersion)
+        return false;
+    in>>cacheKey;
+    if (cacheKey!=key)
+        return false;
+
+    qint32 fileCount;
+    in>>fileCount;
+    if (in.status()!=QDataStream::Ok || fileCount<0)
+        return false;
+    for (int i=0;i<fileCount;i++) {
+        SymbolCacheFile cachedFile;
+        in>>cachedFile.fileName>>cachedFile.lastModified;
+        QFileInfo info(cachedFile.fileName);
+        if (!info.exists()
+                || info.lastModified().toMSecsSinceEpoch()!=cachedFile.lastModified)
+            return false;
+        files.append(cachedFile);
+    }
+
+    //file names and types are highly duplicated, share them
+    StringPool strings;
+    qint32 statementCount;
+    in>>statementCount;
+    if (in.status()!=QDataStream::Ok || statementCount<0)
+        return false;
+    statements.reserve(statementCount);
+    for (int i=0;i<statementCount;i++) {
+        PStatement statement = std::make_shared<Statement>();
+        qint32 parentId, kind, scope, accessibility, line, definitionLine;
+        quint32 properties;
+        QString type, fileName, definitionFileName;
+        in>>parentId
+         >>type
+         >>statement->command
+         >>statement->args
+         >>statement->value
+         >>statement->templateSpecializationParams
+         >>kind
+         >>scope
+         >>accessibility
+         >>line
+         >>definitionLine
+         >>fileName
+         >>definitionFileName
+         >>statement->friends
+         >>statement->fullName
+         >>statement->usingList
+         >>statement->noNameArgs
+         >>statement->lambdaCaptures
+         >>properties;
+        if (in.status()!=QDataStream::Ok || parentId>=i) {
+            statements.clear();
+            return false;
+        }
+        if (parentId>=0)
+            statement->parentScope = statements[parentId];
+        statement->type = strings.intern(type);
+        statement->command = strings.intern(statement->command);
+        statement->args = strings.intern(statement->args);
+        statement->noNameArgs = strings.intern(statement->noNameArgs);
+        statement->value = strings.intern(statement->value);
+        statement->templateSpecializationParams = strings.intern(statement->templateSpecializationParams);
+        statement->fileName = strings.intern(fileName);
+        statement->definitionFileName = strings.intern(definitionFileName);
+        statement->kind = (StatementKind)kind;
+        statement->scope = (StatementScope)scope;
+        statement->accessibility = (StatementAccessibility)accessibility;
+        statement->line = line;
+        statement->definitionLine = definitionLine;
+        statement->properties = StatementProperties(QFlag(properties));
+        statements.append(statement);
+    }
+
+    for (int i=0;i<files.count();i++) {
+        SymbolCacheFile& cachedFile = files[i];
+        PParsedFileInfo fileInfo = std::make_shared<ParsedFileInfo>(cachedFile.fileName);
+        QStringList includes, directIncludes, usings;
+        QList<qint32> statementIds;
+        in>>includes>>directIncludes>>usings>>statementIds;
+        foreach (const QString& include, includes)
+            fileInfo->addInclude(strings.intern(include));
+        foreach (const QString& include, directIncludes)
+            fileInfo->addDirectInclude(strings.intern(include));
+        foreach (const QString& usingName, usings)
+            fileInfo->addUsing(usingName);
+        foreach (qint32 id, statementIds) {
+            if (id>=0 && id<statements.count())
+                fileInfo->addStatement(statements[id]);
+        }
+        qint32 scopeCount;
+        in>>scopeCount;
+        for (int j=0;j<scopeCount && in.status()==QDataStream::Ok;j++) {
+            qint32 line, id;
+            in>>line>>id;
+            fileInfo->addScope(line, (id>=0 && id<statements.count())?statements[id]:PStatement());
+        }
+        QMap<int,bool> branches;
+        in>>branches;
+        for (auto it=branches.begin();it!=branches.end();++it)
+            fileInfo->insertBranch(it.key(),it.value());
+        bool includeGuarded;
+        QString includeGuard;
+        in>>includeGuarded>>includeGuard;
+        if (includeGuarded)
+            fileInfo->setIncludeGuard(includeGuard);
+        cachedFile.fileInfo = fileInfo;
+        cachedFile.defines = readDefineMap(in);
+        cachedFile.undefines = readDefineMap(in);
+        if (in.status()!=QDataStream::Ok) {
+            files.clear();
+            statements.clear();
+            return false;
+        }
+    }
+    return true;
+}
+
+bool SymbolCache::save(const QString &cacheFile, const QString &key, const QList<SymbolCacheFile> &files, const StatementList &statements)
+{
+    QDir().mkpath(extractFileDir(cacheFile));
+    QSaveFile file(cacheFile);
+    if (!file.open(QFile::WriteOnly | QFile::Truncate))
+        return false;
+    QDataStream out(&file);
+    writeSymbols(out, key, files, statements);
+    if (out.status()!=QDataStream::Ok) {
+        file.cancelWriting();
+        return false;
+    }
+    return file.commit();
+}
+
+bool SymbolCache::load(const QString &cacheFile, const QString &key, QList<SymbolCacheFile> &files, StatementList &statements)
+{
+    files.clear();
+    statements.clear();
+    QFile file(cacheFile);
+    if (!file.open(QFile::ReadOnly))
+        return false;
+    qint64 size = file.size();
+    uchar* mapped = file.map(0, size);
+    QByteArray data;
+    if (mapped)
+        data = QByteArray::fromRawData((const char*)mapped, size);
+    else
+        data = file.readAll();
+    auto action = finally([&file,mapped]{
+        if (mapped)
+            file.unmap(mapped);
+    });
+    QDataStream in(data);
+    return readSymbols(in, key, files, statements);
+}
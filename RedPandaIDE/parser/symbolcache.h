@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2020-2022 Roy Qu (royqh1979@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef SYMBOLCACHE_H
+#define SYMBOLCACHE_H
+
+#include "parserutils.h"
+
+struct SymbolCacheFile {
+    QString fileName;
+    qint64 lastModified; // msecs since epoch, used to validate the cache
+    PParsedFileInfo fileInfo;
+    PDefineMap defines;
+    PDefineMap undefines;
+};
+
+/**
+ * @brief On-disk cache of the parse results of system header files
+ *
+ * The cache file contains the statements, file infos and macro defines of
+ * the system headers, so a newly created parser don't need to preprocess and
+ * parse them again. It's only valid for the same key (include paths, hard defines
+ * and language), and is discarded if any header is modified after it's saved.
+ */
+class SymbolCache
+{
+public:
+    /**
+     * @brief save statements and file infos to the cache file
+     * @param statements statements to save. Parent must be saved before its children.
+     */
+    static bool save(const QString& cacheFile,
+                     const QString& key,
+                     const QList<SymbolCacheFile>& files,
+                     const StatementList& statements);
+    /**
+     * @brief load statements and file infos from the cache file
+     * @param statements loaded statements. Parent is loaded before its children.
+     */
+    static bool load(const QString& cacheFile,
+                     const QString& key,
+                     QList<SymbolCacheFile>& files,
+                     StatementList& statements);
+};
+
+#endif // SYMBOLCACHE_H
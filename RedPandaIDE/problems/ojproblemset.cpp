@@ -22,7 +22,9 @@ OJProblemCase::OJProblemCase():
     testState(ProblemCaseTestState::NotTested),
     firstDiffLine(-1),
     outputLineCounts(0),
-    expectedLineCounts(0)
+    expectedLineCounts(0),
+    validatedState(ProblemCaseTestState::NotTested),
+    outputShownSize(0)
 {
     QUuid uid = QUuid::createUuid();
     id = uid.toString();
@@ -39,6 +39,8 @@ enum class ProblemMemoryLimitUnit {
     GB
 };
 
+class ProcessOutputCapture;
+
 struct OJProblemCase {
     QString name;
     QString input;
@@ -52,6 +54,9 @@ struct OJProblemCase {
     int firstDiffLine; // no persistence
     int outputLineCounts; // no persistence
     int expectedLineCounts;
+    ProblemCaseTestState validatedState; // no persistence, set if the output is validated by the runner
+    std::shared_ptr<ProcessOutputCapture> outputCapture; // no persistence, whole output of the last run
+    qint64 outputShownSize; // no persistence, bytes of outputCapture that are in output
     OJProblemCase();
 
 public:
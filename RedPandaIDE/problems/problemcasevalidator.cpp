@@ -15,95 +15,226 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 #include "problemcasevalidator.h"
+#include <QTextCodec>
+#include <cstring>
 
-ProblemCaseValidator::ProblemCaseValidator()
+ProblemCaseValidator::ProblemCaseValidator():
+    mType(ProblemCaseValidateType::Exact),
+    mMappedExpected(nullptr),
+    mExpectedPos(nullptr),
+    mExpectedEnd(nullptr),
+    mOutputLineCount(0),
+    mExpectedLineCount(0),
+    mFirstDiffLine(-1)
 {
 
 }
 
+ProblemCaseValidator::~ProblemCaseValidator()
+{
+    if (mMappedExpected)
+        mExpectedFile.unmap(mMappedExpected);
+}
+
 bool ProblemCaseValidator::validate(POJProblemCase problemCase, ProblemCaseValidateType type)
 {
     if (!problemCase)
         return false;
-    QStringList output = textToLines(problemCase->output);
-    QStringList expected;
-    if (fileExists(problemCase->expectedOutputFileName))
-        expected = readFileToLines(problemCase->expectedOutputFileName);
-    else
-        expected = textToLines(problemCase->expected);
-    problemCase->outputLineCounts = output.count();
-    problemCase->expectedLineCounts = expected.count();
-    if (problemCase->expectedLineCounts>5000) {
-        if (output.count()<expected.count()) {
-            problemCase->firstDiffLine=output.count();
-            return false;
-        }  else if (output.count()>expected.count()) {
-            problemCase->firstDiffLine=expected.count();
-            return false;
+    start(problemCase, type);
+    feed(problemCase->output.toLocal8Bit());
+    return finish();
+}
+
+void ProblemCaseValidator::start(POJProblemCase problemCase, ProblemCaseValidateType type)
+{
+    if (mMappedExpected) {
+        mExpectedFile.unmap(mMappedExpected);
+        mMappedExpected = nullptr;
+    }
+    mExpectedFile.close();
+    mExpected.clear();
+    mPendingOutput.clear();
+    mOutputLineCount = 0;
+    mExpectedLineCount = 0;
+    mFirstDiffLine = -1;
+    mProblemCase = problemCase;
+    mType = type;
+    if (fileExists(problemCase->expectedOutputFileName)) {
+        mExpectedFile.setFileName(problemCase->expectedOutputFileName);
+        if (mExpectedFile.open(QFile::ReadOnly) && mExpectedFile.size()>0) {
+            mMappedExpected = mExpectedFile.map(0, mExpectedFile.size());
+            if (!mMappedExpected)
+                mExpected = mExpectedFile.readAll();
         }
+    } else
+        mExpected = problemCase->expected.toUtf8();
+    if (mMappedExpected) {
+        mExpectedPos = (const char*)mMappedExpected;
+        mExpectedEnd = mExpectedPos + mExpectedFile.size();
+    } else {
+        mExpectedPos = mExpected.constData();
+        mExpectedEnd = mExpectedPos + mExpected.length();
     }
-    int count=std::min(output.count(), expected.count());
-    switch(type) {
-    case ProblemCaseValidateType::Exact:
-        for (int i=0;i<count;i++) {
-            if (output[i]!=expected[i]) {
-                problemCase->firstDiffLine = i;
-                return false;
+    //skip utf-8 bom
+    if (mExpectedEnd-mExpectedPos>=3 && memcmp(mExpectedPos,"\xEF\xBB\xBF",3)==0)
+        mExpectedPos+=3;
+}
+
+bool ProblemCaseValidator::feed(const QByteArray &output)
+{
+    const char* p = output.constData();
+    const char* end = p + output.length();
+    if (failed()) {
+        //only count lines
+        while (p<end) {
+            const char* lineEnd = (const char*)memchr(p, '\n', end-p);
+            if (!lineEnd) {
+                mPendingOutput = "?";
+                break;
             }
+            mOutputLineCount++;
+            mPendingOutput.clear();
+            p = lineEnd+1;
+        }
+        return false;
+    }
+    if (!mPendingOutput.isEmpty()) {
+        const char* lineEnd = (const char*)memchr(p, '\n', end-p);
+        if (!lineEnd) {
+            mPendingOutput.append(output);
+            return true;
+        }
+        mPendingOutput.append(p, lineEnd-p);
+        compareLine(mPendingOutput.constData(), mPendingOutput.constData()+mPendingOutput.length());
+        mPendingOutput.clear();
+        p = lineEnd+1;
+    }
+    while (p<end) {
+        if (failed())
+            return feed(QByteArray::fromRawData(p, end-p));
+        const char* lineEnd = (const char*)memchr(p, '\n', end-p);
+        if (!lineEnd) {
+            mPendingOutput.append(p, end-p);
+            break;
         }
+        compareLine(p, lineEnd);
+        p = lineEnd+1;
+    }
+    return !failed();
+}
+
+bool ProblemCaseValidator::finish()
+{
+    if (!mPendingOutput.isEmpty()) {
+        compareLine(mPendingOutput.constData(), mPendingOutput.constData()+mPendingOutput.length());
+        mPendingOutput.clear();
+    }
+    mExpectedLineCount += countRestExpectedLines();
+    if (!failed() && mOutputLineCount<mExpectedLineCount)
+        mFirstDiffLine = mOutputLineCount;
+    if (mProblemCase) {
+        mProblemCase->outputLineCounts = mOutputLineCount;
+        mProblemCase->expectedLineCounts = mExpectedLineCount;
+        mProblemCase->firstDiffLine = mFirstDiffLine;
+    }
+    return !failed();
+}
+
+bool ProblemCaseValidator::failed() const
+{
+    return mFirstDiffLine>=0;
+}
+
+void ProblemCaseValidator::compareLine(const char *start, const char *end)
+{
+    int line = mOutputLineCount++;
+    if (failed())
+        return;
+    if (end>start && *(end-1)=='\r')
+        end--;
+    QString expected;
+    if (!nextExpectedLine(expected)) {
+        mFirstDiffLine = line;
+        return;
+    }
+    QString output = QString::fromLocal8Bit(start, end-start);
+    bool equal = false;
+    switch(mType) {
+    case ProblemCaseValidateType::Exact:
+        equal = (output == expected);
         break;
     case ProblemCaseValidateType::IgnoreLeadingTrailingSpaces:
-        for (int i=0;i<count;i++) {
-            if (output[i].trimmed()!=expected[i].trimmed()) {
-                problemCase->firstDiffLine = i;
-                return false;
-            }
-        }
+        equal = (output.trimmed() == expected.trimmed());
         break;
     case ProblemCaseValidateType::IgnoreSpaces:
-        for (int i=0;i<count;i++) {
-            if (!equalIgnoringSpaces(output[i],expected[i])) {
-                problemCase->firstDiffLine = i;
-                return false;
-            }
-        }
+        equal = equalIgnoringSpaces(output, expected);
         break;
     }
-    if (output.count()<expected.count()) {
-        problemCase->firstDiffLine=output.count();
-        return false;
-    }  else if (output.count()>expected.count()) {
-        problemCase->firstDiffLine=expected.count();
+    if (!equal)
+        mFirstDiffLine = line;
+}
+
+bool ProblemCaseValidator::nextExpectedLine(QString &line)
+{
+    if (mExpectedPos>=mExpectedEnd)
         return false;
+    const char* lineEnd = (const char*)memchr(mExpectedPos, '\n', mExpectedEnd-mExpectedPos);
+    const char* next;
+    if (lineEnd) {
+        next = lineEnd+1;
+    } else {
+        lineEnd = mExpectedEnd;
+        next = mExpectedEnd;
     }
+    if (lineEnd>mExpectedPos && *(lineEnd-1)=='\r')
+        lineEnd--;
+    QTextCodec::ConverterState state;
+    line = QTextCodec::codecForName(ENCODING_UTF8)->toUnicode(mExpectedPos, lineEnd-mExpectedPos, &state);
+    if (state.invalidChars>0)
+        line = QString::fromLocal8Bit(mExpectedPos, lineEnd-mExpectedPos);
+    mExpectedPos = next;
+    mExpectedLineCount++;
     return true;
 }
 
-bool ProblemCaseValidator::equalIgnoringSpaces(const QString &s1, const QString &s2)
+int ProblemCaseValidator::countRestExpectedLines()
 {
-    QStringList strList1=split(s1);
-    QStringList strList2=split(s2);
-    return (strList1==strList2);
+    int count = 0;
+    const char* p = mExpectedPos;
+    while (p<mExpectedEnd) {
+        const char* lineEnd = (const char*)memchr(p, '\n', mExpectedEnd-p);
+        count++;
+        if (!lineEnd)
+            break;
+        p = lineEnd+1;
+    }
+    mExpectedPos = mExpectedEnd;
+    return count;
 }
 
-QStringList ProblemCaseValidator::split(const QString &s)
+bool ProblemCaseValidator::equalIgnoringSpaces(const QString &s1, const QString &s2)
 {
-    QStringList result;
-    const QChar* p = getNullTerminatedStringData(s);
-    const QChar* start = p;
-    while (p->unicode()!=0) {
-        if (p->isSpace()) {
-            if (!start->isSpace()) {
-                result.append(QString(start,p-start));
-            }
-            start = p;
-        } else if (start->isSpace()) {
-            start = p;
+    const QChar* p1 = s1.constData();
+    const QChar* end1 = p1 + s1.length();
+    const QChar* p2 = s2.constData();
+    const QChar* end2 = p2 + s2.length();
+    while (true) {
+        while (p1<end1 && p1->isSpace())
+            p1++;
+        while (p2<end2 && p2->isSpace())
+            p2++;
+        if (p1==end1 || p2==end2)
+            return p1==end1 && p2==end2;
+        while (p1<end1 && p2<end2 && !p1->isSpace() && !p2->isSpace()) {
+            if (*p1!=*p2)
+                return false;
+            p1++;
+            p2++;
         }
-        p++;
-    }
-    if (!start->isSpace()) {
-        result.append(QString(start,p-start));
+        //both words must end at the same place
+        bool wordEnd1 = (p1==end1 || p1->isSpace());
+        bool wordEnd2 = (p2==end2 || p2->isSpace());
+        if (wordEnd1!=wordEnd2)
+            return false;
     }
-    return result;
 }
@@ -19,15 +19,54 @@
 
 #include "ojproblemset.h"
 #include "../utils.h"
+#include <QFile>
 
+/**
+ * @brief Compare the output of a problem case with its expected output
+ *
+ * The output can be fed chunk by chunk while the program is running. Each complete
+ * line is compared with the next line of the expected output (which is memory mapped
+ * if it's in a file), so the whole output never needs to be split into lines, and the
+ * first different line is known as soon as it's outputted.
+ */
 class ProblemCaseValidator
 {
 public:
     ProblemCaseValidator();
+    ProblemCaseValidator(const ProblemCaseValidator&)=delete;
+    ProblemCaseValidator& operator=(const ProblemCaseValidator&)=delete;
+    ~ProblemCaseValidator();
     bool validate(POJProblemCase problemCase, ProblemCaseValidateType type);
+
+    void start(POJProblemCase problemCase, ProblemCaseValidateType type);
+    /**
+     * @brief feed the next chunk of the program's output
+     * @return false if the output is already different from the expected
+     */
+    bool feed(const QByteArray& output);
+    /**
+     * @brief validate the rest output, and set the first different line and line counts of the case
+     * @return true if the output is the same as the expected
+     */
+    bool finish();
+    bool failed() const;
 private:
+    void compareLine(const char* start, const char* end);
+    bool nextExpectedLine(QString& line);
+    int countRestExpectedLines();
     bool equalIgnoringSpaces(const QString& s1, const QString& s2);
-    QStringList split(const QString& s);
+private:
+    POJProblemCase mProblemCase;
+    ProblemCaseValidateType mType;
+    QFile mExpectedFile;
+    uchar* mMappedExpected;
+    QByteArray mExpected;
+    const char* mExpectedPos;
+    const char* mExpectedEnd;
+    QByteArray mPendingOutput; // incomplete last line
+    int mOutputLineCount;
+    int mExpectedLineCount;
+    int mFirstDiffLine;
 };
 
 #endif // PROBLEMCASEVALIDATOR_H
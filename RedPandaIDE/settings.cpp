@@ -724,6 +724,26 @@ void Settings::Editor::setParseTodos(bool newParseTodos)
     mParseTodos = newParseTodos;
 }
 
+int Settings::Editor::undoMemoryLimit() const
+{
+    return mUndoMemoryLimit;
+}
+
+void Settings::Editor::setUndoMemoryLimit(int newUndoMemoryLimit)
+{
+    mUndoMemoryLimit = newUndoMemoryLimit;
+}
+
+bool Settings::Editor::showPaintStatistics() const
+{
+    return mShowPaintStatistics;
+}
+
+void Settings::Editor::setShowPaintStatistics(bool newShowPaintStatistics)
+{
+    mShowPaintStatistics = newShowPaintStatistics;
+}
+
 const QStringList &Settings::Editor::customCTypeKeywords() const
 {
     return mCustomCTypeKeywords;
@@ -1362,6 +1382,8 @@ void Settings::Editor::doSave()
     saveValue("auto_format_when_saved", mAutoFormatWhenSaved);
     saveValue("remove_trailing_spaces_when_saved",mRemoveTrailingSpacesWhenSaved);
     saveValue("parse_todos",mParseTodos);
+    saveValue("undo_memory_limit",mUndoMemoryLimit);
+    saveValue("show_paint_statistics",mShowPaintStatistics);
 
     saveValue("custom_c_type_keywords", mCustomCTypeKeywords);
     saveValue("enable_custom_c_type_keywords",mEnableCustomCTypeKeywords);
@@ -1520,6 +1542,8 @@ void Settings::Editor::doLoad()
     mAutoFormatWhenSaved = boolValue("auto_format_when_saved", false);
     mRemoveTrailingSpacesWhenSaved = boolValue("remove_trailing_spaces_when_saved",false);
     mParseTodos = boolValue("parse_todos",true);
+    mUndoMemoryLimit = intValue("undo_memory_limit",64);
+    mShowPaintStatistics = boolValue("show_paint_statistics",false);
 
     mCustomCTypeKeywords = stringListValue("custom_c_type_keywords");
     mEnableCustomCTypeKeywords = boolValue("enable_custom_c_type_keywords",false);
@@ -3816,6 +3840,8 @@ void Settings::Environment::doLoad()
 
     mHideNonSupportFilesInFileView=boolValue("hide_non_support_files_file_view",true);
     mOpenFilesInSingleInstance = boolValue("open_files_in_single_instance",false);
+    mEnableCompileCache = boolValue("enable_compile_cache",false);
+    mCompileCacheSizeLimit = intValue("compile_cache_size_limit",512);
 }
 
 int Settings::Environment::interfaceFontSize() const
@@ -3924,6 +3950,26 @@ void Settings::Environment::setHideNonSupportFilesInFileView(bool newHideNonSupp
     mHideNonSupportFilesInFileView = newHideNonSupportFilesInFileView;
 }
 
+bool Settings::Environment::enableCompileCache() const
+{
+    return mEnableCompileCache;
+}
+
+void Settings::Environment::setEnableCompileCache(bool newEnableCompileCache)
+{
+    mEnableCompileCache = newEnableCompileCache;
+}
+
+int Settings::Environment::compileCacheSizeLimit() const
+{
+    return mCompileCacheSizeLimit;
+}
+
+void Settings::Environment::setCompileCacheSizeLimit(int newCompileCacheSizeLimit)
+{
+    mCompileCacheSizeLimit = newCompileCacheSizeLimit;
+}
+
 bool Settings::Environment::openFilesInSingleInstance() const
 {
     return mOpenFilesInSingleInstance;
@@ -4101,6 +4147,8 @@ void Settings::Environment::doSave()
 
     saveValue("hide_non_support_files_file_view",mHideNonSupportFilesInFileView);
     saveValue("open_files_in_single_instance",mOpenFilesInSingleInstance);
+    saveValue("enable_compile_cache",mEnableCompileCache);
+    saveValue("compile_cache_size_limit",mCompileCacheSizeLimit);
 }
 
 QString Settings::Environment::interfaceFont() const
@@ -4230,6 +4278,36 @@ void Settings::Executor::setCaseMemoryLimit(size_t newCaseMemoryLimit)
     mCaseMemoryLimit = newCaseMemoryLimit;
 }
 
+int Settings::Executor::problemCasesConcurrency() const
+{
+    return mProblemCasesConcurrency;
+}
+
+void Settings::Executor::setProblemCasesConcurrency(int newProblemCasesConcurrency)
+{
+    mProblemCasesConcurrency = newProblemCasesConcurrency;
+}
+
+bool Settings::Executor::problemCaseFailFast() const
+{
+    return mProblemCaseFailFast;
+}
+
+void Settings::Executor::setProblemCaseFailFast(bool newProblemCaseFailFast)
+{
+    mProblemCaseFailFast = newProblemCaseFailFast;
+}
+
+bool Settings::Executor::caseMemoryLimitInSystemdScope() const
+{
+    return mCaseMemoryLimitInSystemdScope;
+}
+
+void Settings::Executor::setCaseMemoryLimitInSystemdScope(bool newCaseMemoryLimitInSystemdScope)
+{
+    mCaseMemoryLimitInSystemdScope = newCaseMemoryLimitInSystemdScope;
+}
+
 bool Settings::Executor::convertHTMLToTextForExpected() const
 {
     return mConvertHTMLToTextForExpected;
@@ -4356,6 +4434,9 @@ void Settings::Executor::doSave()
     saveValue("case_memory_limit",mCaseMemoryLimit);
     remove("case_timeout");
     saveValue("enable_case_limit", mEnableCaseLimit);
+    saveValue("problem_cases_concurrency", mProblemCasesConcurrency);
+    saveValue("problem_case_fail_fast", mProblemCaseFailFast);
+    saveValue("case_memory_limit_in_systemd_scope", mCaseMemoryLimitInSystemdScope);
 }
 
 bool Settings::Executor::pauseConsole() const
@@ -4397,6 +4478,9 @@ void Settings::Executor::doLoad()
     else
         mCaseTimeout = uintValue("case_timeout_ms", 2000); //2000ms
     mCaseMemoryLimit = uintValue("case_memory_limit",0); // kb
+    mProblemCasesConcurrency = std::max(1,intValue("problem_cases_concurrency",1));
+    mProblemCaseFailFast = boolValue("problem_case_fail_fast",false);
+    mCaseMemoryLimitInSystemdScope = boolValue("case_memory_limit_in_systemd_scope",false);
 
     mEnableCaseLimit = boolValue("enable_case_limit", true);
     //compatibility
@@ -4711,6 +4795,26 @@ void Settings::CodeCompletion::setShareParser(bool newShareParser)
     mShareParser = newShareParser;
 }
 
+bool Settings::CodeCompletion::cacheSystemHeaderSymbols() const
+{
+    return mCacheSystemHeaderSymbols;
+}
+
+void Settings::CodeCompletion::setCacheSystemHeaderSymbols(bool newCacheSystemHeaderSymbols)
+{
+    mCacheSystemHeaderSymbols = newCacheSystemHeaderSymbols;
+}
+
+bool Settings::CodeCompletion::parseFilesConcurrently() const
+{
+    return mParseFilesConcurrently;
+}
+
+void Settings::CodeCompletion::setParseFilesConcurrently(bool newParseFilesConcurrently)
+{
+    mParseFilesConcurrently = newParseFilesConcurrently;
+}
+
 bool Settings::CodeCompletion::hideSymbolsStartsWithUnderLine() const
 {
     return mHideSymbolsStartsWithUnderLine;
@@ -4850,6 +4954,8 @@ void Settings::CodeCompletion::doSave()
     saveValue("hide_symbols_start_with_two_underline", mHideSymbolsStartsWithTwoUnderLine);
     saveValue("hide_symbols_start_with_underline", mHideSymbolsStartsWithUnderLine);
     saveValue("share_parser",mShareParser);
+    saveValue("cache_system_header_symbols",mCacheSystemHeaderSymbols);
+    saveValue("parse_files_concurrently",mParseFilesConcurrently);
 }
 
 
@@ -4902,6 +5008,8 @@ void Settings::CodeCompletion::doLoad()
 //#endif
     //mClearWhenEditorHidden = boolValue("clear_when_editor_hidden",doClear);
     mShareParser = boolValue("share_parser",shouldShare);
+    mCacheSystemHeaderSymbols = boolValue("cache_system_header_symbols",true);
+    mParseFilesConcurrently = boolValue("parse_files_concurrently",false);
 }
 
 Settings::CodeFormatter::CodeFormatter(Settings *settings):
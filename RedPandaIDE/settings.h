@@ -359,6 +359,12 @@ public:
         bool parseTodos() const;
         void setParseTodos(bool newParseTodos);
 
+        int undoMemoryLimit() const;
+        void setUndoMemoryLimit(int newUndoMemoryLimit);
+
+        bool showPaintStatistics() const;
+        void setShowPaintStatistics(bool newShowPaintStatistics);
+
         const QStringList &customCTypeKeywords() const;
         void setCustomCTypeKeywords(const QStringList &newCustomTypeKeywords);
 
@@ -504,6 +510,8 @@ public:
         bool mAutoFormatWhenSaved;
         bool mRemoveTrailingSpacesWhenSaved;
         bool mParseTodos;
+        int mUndoMemoryLimit; // in MB, 0 means unlimited
+        bool mShowPaintStatistics;
 
         QStringList mCustomCTypeKeywords;
         bool mEnableCustomCTypeKeywords;
@@ -572,6 +580,12 @@ public:
         bool openFilesInSingleInstance() const;
         void setOpenFilesInSingleInstance(bool newOpenFilesInSingleInstance);
 
+        bool enableCompileCache() const;
+        void setEnableCompileCache(bool newEnableCompileCache);
+
+        int compileCacheSizeLimit() const;
+        void setCompileCacheSizeLimit(int newCompileCacheSizeLimit);
+
         double iconZoomFactor() const;
         void setIconZoomFactor(double newIconZoomFactor);
 
@@ -609,6 +623,8 @@ public:
         bool mUseCustomTerminal;
         bool mHideNonSupportFilesInFileView;
         bool mOpenFilesInSingleInstance;
+        bool mEnableCompileCache;
+        int mCompileCacheSizeLimit; //MB
 
         static const QMap<QString, QString> mTerminalArgsPatternMagicVariables;
         // _Base interface
@@ -671,6 +687,12 @@ public:
         bool shareParser();
         void setShareParser(bool newShareParser);
 
+        bool cacheSystemHeaderSymbols() const;
+        void setCacheSystemHeaderSymbols(bool newCacheSystemHeaderSymbols);
+
+        bool parseFilesConcurrently() const;
+        void setParseFilesConcurrently(bool newParseFilesConcurrently);
+
     private:
         int mWidthInColumns;
         int mHeightInLines;
@@ -689,6 +711,8 @@ public:
         bool mHideSymbolsStartsWithUnderLine;
         //bool mClearWhenEditorHidden;
         bool mShareParser;
+        bool mCacheSystemHeaderSymbols;
+        bool mParseFilesConcurrently;
 
         // _Base interface
     protected:
@@ -948,6 +972,15 @@ public:
 
         bool enableVirualTerminalSequence() const;
         void setEnableVirualTerminalSequence(bool newEnableVirualTerminalSequence);
+
+        int problemCasesConcurrency() const;
+        void setProblemCasesConcurrency(int newProblemCasesConcurrency);
+
+        bool problemCaseFailFast() const;
+        void setProblemCaseFailFast(bool newProblemCaseFailFast);
+
+        bool caseMemoryLimitInSystemdScope() const;
+        void setCaseMemoryLimitInSystemdScope(bool newCaseMemoryLimitInSystemdScope);
     private:
         // general
         bool mPauseConsole;
@@ -973,6 +1006,9 @@ public:
         bool mEnableCaseLimit;
         qulonglong mCaseTimeout; //ms
         qulonglong mCaseMemoryLimit; //kb
+        int mProblemCasesConcurrency;
+        bool mProblemCaseFailFast;
+        bool mCaseMemoryLimitInSystemdScope;
 
     protected:
         void doSave() override;
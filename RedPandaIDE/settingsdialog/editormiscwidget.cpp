@@ -72,6 +72,8 @@ void EditorMiscWidget::doLoad()
         ui->rbNone->setChecked(true);
 
     ui->chkParseTodos->setChecked(pSettings->editor().parseTodos());
+    ui->spinUndoMemoryLimit->setValue(pSettings->editor().undoMemoryLimit());
+    ui->chkShowPaintStatistics->setChecked(pSettings->editor().showPaintStatistics());
 }
 
 void EditorMiscWidget::doSave()
@@ -89,6 +91,8 @@ void EditorMiscWidget::doSave()
     pSettings->editor().setAutoFormatWhenSaved(ui->rbAutoReformat->isChecked());
     pSettings->editor().setRemoveTrailingSpacesWhenSaved(ui->rbRemoveTrailingSpaces->isChecked());
     pSettings->editor().setParseTodos(ui->chkParseTodos->isChecked());
+    pSettings->editor().setUndoMemoryLimit(ui->spinUndoMemoryLimit->value());
+    pSettings->editor().setShowPaintStatistics(ui->chkShowPaintStatistics->isChecked());
 
 
     pSettings->editor().save();
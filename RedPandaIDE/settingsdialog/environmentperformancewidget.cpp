@@ -54,13 +54,22 @@ void EnvironmentPerformanceWidget::doLoad()
 //    }
 //#endif
     ui->chkEditorsShareParser->setChecked(pSettings->codeCompletion().shareParser());
+    ui->chkCacheSystemHeaderSymbols->setChecked(pSettings->codeCompletion().cacheSystemHeaderSymbols());
+    ui->chkParseFilesConcurrently->setChecked(pSettings->codeCompletion().parseFilesConcurrently());
+    ui->grpCompileCache->setChecked(pSettings->environment().enableCompileCache());
+    ui->spinCompileCacheSize->setValue(pSettings->environment().compileCacheSizeLimit());
 }
 
 void EnvironmentPerformanceWidget::doSave()
 {
     //pSettings->codeCompletion().setClearWhenEditorHidden(ui->chkClearWhenEditorHidden->isChecked());
     pSettings->codeCompletion().setShareParser(ui->chkEditorsShareParser->isChecked());
+    pSettings->codeCompletion().setCacheSystemHeaderSymbols(ui->chkCacheSystemHeaderSymbols->isChecked());
+    pSettings->codeCompletion().setParseFilesConcurrently(ui->chkParseFilesConcurrently->isChecked());
+    pSettings->environment().setEnableCompileCache(ui->grpCompileCache->isChecked());
+    pSettings->environment().setCompileCacheSizeLimit(ui->spinCompileCacheSize->value());
 
     pSettings->codeCompletion().save();
     pSettings->editor().save();
+    pSettings->environment().save();
 }
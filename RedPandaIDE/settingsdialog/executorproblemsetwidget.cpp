@@ -27,6 +27,9 @@ ExecutorProblemSetWidget::ExecutorProblemSetWidget(const QString& name, const QS
     ui->cbProblemCaseValidateType->addItem(tr("Exact"));
     ui->cbProblemCaseValidateType->addItem(tr("Ignore leading/trailing spaces"));
     ui->cbProblemCaseValidateType->addItem(tr("Ignore spaces"));
+#ifndef Q_OS_LINUX
+    ui->chkMemoryLimitInSystemdScope->setVisible(false);
+#endif
 
 }
 
@@ -45,6 +48,8 @@ void ExecutorProblemSetWidget::doLoad()
 
     ui->cbProblemCaseValidateType->setCurrentIndex((int)(pSettings->executor().problemCaseValidateType()));
     ui->chkRedirectStderr->setChecked(pSettings->executor().redirectStderrToToolLog());
+    ui->chkFailFast->setChecked(pSettings->executor().problemCaseFailFast());
+    ui->spinCasesConcurrency->setValue(pSettings->executor().problemCasesConcurrency());
 
     ui->cbFont->setCurrentFont(QFont(pSettings->executor().caseEditorFontName()));
     ui->spinFontSize->setValue(pSettings->executor().caseEditorFontSize());
@@ -53,6 +58,7 @@ void ExecutorProblemSetWidget::doLoad()
 
     ui->spinCaseTimeout->setValue(pSettings->executor().caseTimeout());
     ui->spinMemoryLimit->setValue(pSettings->executor().caseMemoryLimit());
+    ui->chkMemoryLimitInSystemdScope->setChecked(pSettings->executor().caseMemoryLimitInSystemdScope());
 }
 
 void ExecutorProblemSetWidget::doSave()
@@ -64,12 +70,15 @@ void ExecutorProblemSetWidget::doSave()
     pSettings->executor().setConvertHTMLToTextForExpected(ui->chkConvertExpectedHTML->isChecked());
     pSettings->executor().setProblemCaseValidateType((ProblemCaseValidateType)(ui->cbProblemCaseValidateType->currentIndex()));
     pSettings->executor().setRedirectStderrToToolLog(ui->chkRedirectStderr->isChecked());
+    pSettings->executor().setProblemCaseFailFast(ui->chkFailFast->isChecked());
+    pSettings->executor().setProblemCasesConcurrency(ui->spinCasesConcurrency->value());
     pSettings->executor().setCaseEditorFontName(ui->cbFont->currentFont().family());
     pSettings->executor().setCaseEditorFontOnlyMonospaced(ui->chkOnlyMonospaced->isChecked());
     pSettings->executor().setCaseEditorFontSize(ui->spinFontSize->value());
     pSettings->executor().setEnableCaseLimit(ui->grpEnableTimeout->isChecked());
     pSettings->executor().setCaseTimeout(ui->spinCaseTimeout->value());
     pSettings->executor().setCaseMemoryLimit(ui->spinMemoryLimit->value());
+    pSettings->executor().setCaseMemoryLimitInSystemdScope(ui->chkMemoryLimitInSystemdScope->isChecked());
 
     pSettings->executor().save();
     pMainWindow->applySettings();
@@ -0,0 +1,127 @@
+// Run programs through CaseProcess (as the problem case runner does), and check the reported
+// cpu time, peak memory and memory limit.
+// Usage: test-case-process [consolepauser]
+// The programs are the test itself, run with --allocate <MB>, --spin <ms> or --ptrace.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFileInfo>
+#include <QStringList>
+#include <sys/ptrace.h>
+#include <unistd.h>
+
+#include "compiler/caseprocess.h"
+
+static const qulonglong MB = 1024 * 1024;
+
+static int allocate(int megabytes)
+{
+    size_t size = megabytes * MB;
+    char *p = static_cast<char *>(malloc(size));
+    if (!p)
+        return 2;
+    memset(p, 1, size);
+    //long enough to be sampled when run without the launcher
+    usleep(500 * 1000);
+    int result = p[size - 1] == 1 ? 0 : 3;
+    free(p);
+    return result;
+}
+
+static int spin(int msecs)
+{
+    clock_t end = clock() + (clock_t)msecs * CLOCKS_PER_SEC / 1000;
+    volatile unsigned long count = 0;
+    while (clock() < end)
+        count++;
+    return 0;
+}
+
+struct Result {
+    int exitCode;
+    qulonglong cpuTime;
+    qulonglong peakMemory;
+    bool memoryLimitExceeded;
+};
+
+static Result run(const QString& launcher, bool useSystemdScope, size_t memoryLimit, const QStringList& arguments)
+{
+    CaseProcess process(launcher, useSystemdScope, memoryLimit, -1);
+    process.setCommand(QCoreApplication::applicationFilePath(), arguments);
+    process.setProcessChannelMode(QProcess::ForwardedChannels);
+    process.start();
+    process.waitForStarted();
+    //as OJProblemCasesRunner::executeCase() does
+    while (!process.waitForFinished(100)) {
+        process.sample();
+        if (process.memoryLimitExceeded()) {
+            process.kill();
+            process.waitForFinished();
+            break;
+        }
+    }
+    process.finish();
+    return Result{process.exitCode(), process.cpuTime(), process.peakMemory(), process.memoryLimitExceeded()};
+}
+
+static int failures = 0;
+
+static void check(bool condition, const char *mode, const char *what, const Result& result)
+{
+    printf("%-8s %-36s %s (exit code %d, cpu %llu ms, peak %llu MB)\n",
+           mode, what, condition ? "ok" : "FAILED",
+           result.exitCode, result.cpuTime, result.peakMemory / MB);
+    if (!condition)
+        failures++;
+}
+
+static void testMode(const char *mode, const QString& launcher, bool useSystemdScope)
+{
+    Result result = run(launcher, useSystemdScope, 0, {"--allocate", "64"});
+    check(result.exitCode == 0 && result.peakMemory >= 64 * MB && result.peakMemory < 96 * MB
+          && !result.memoryLimitExceeded,
+          mode, "allocate 64 MB", result);
+
+    result = run(launcher, useSystemdScope, 256 * MB, {"--allocate", "64"});
+    check(result.exitCode == 0 && !result.memoryLimitExceeded, mode, "allocate 64 MB, limit 256 MB", result);
+
+    result = run(launcher, useSystemdScope, 32 * MB, {"--allocate", "64"});
+    check(result.memoryLimitExceeded, mode, "allocate 64 MB, limit 32 MB", result);
+
+    result = run(launcher, useSystemdScope, 0, {"--spin", "300"});
+    check(result.exitCode == 0 && result.cpuTime >= 290, mode, "spin 300 ms", result);
+
+    result = run(launcher, useSystemdScope, 0, {"--ptrace"});
+    check(result.exitCode == 0, mode, "program can be traced by others", result);
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc > 2 && strcmp(argv[1], "--allocate") == 0)
+        return allocate(atoi(argv[2]));
+    if (argc > 2 && strcmp(argv[1], "--spin") == 0)
+        return spin(atoi(argv[2]));
+    if (argc > 1 && strcmp(argv[1], "--ptrace") == 0)
+        return ptrace(PTRACE_TRACEME, 0, nullptr, nullptr) == 0 ? 0 : 1;
+
+    QCoreApplication app(argc, argv);
+    QString launcher = argc > 1 ? QString::fromLocal8Bit(argv[1])
+                                : QDir(QCoreApplication::applicationDirPath()).filePath("consolepauser");
+    if (!QFileInfo(launcher).isExecutable()) {
+        fprintf(stderr, "Can't find consolepauser: %s\n", launcher.toLocal8Bit().constData());
+        return 1;
+    }
+
+    testMode("direct", QString(), false);
+    testMode("launcher", launcher, false);
+    if (CaseProcess::systemdScopeAvailable())
+        testMode("scope", launcher, true);
+    else
+        printf("systemd scopes are not available, skipped\n");
+    return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,147 @@
+// Parse all C/C++ files in a directory as a project, first serially, then with tokenizing in
+// the thread pool ("parse files concurrently") using 1, 2, 4... threads, and print the time.
+// Each concurrent parse must find the same symbols as the serial parse.
+// System headers are found with "g++ -v", and parsed too.
+// The memory used by the statements (bytes per statement) is printed after the serial parse.
+// Usage: bench-parser [directory] [rounds]
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QProcess>
+#include <QStringList>
+#include <QThread>
+#include <QThreadPool>
+
+#include "parser/cppparser.h"
+
+static QStringList compilerIncludePaths()
+{
+    QProcess process;
+    process.start("g++", QStringList{"-xc++", "-E", "-v", "-"});
+    if (!process.waitForStarted())
+        return QStringList();
+    process.closeWriteChannel();
+    process.waitForFinished();
+    QStringList paths;
+    bool inList = false;
+    foreach (const QString& line, QString::fromLocal8Bit(process.readAllStandardError()).split('\n')) {
+        if (line.startsWith("#include <...> search starts here:"))
+            inList = true;
+        else if (line.startsWith("End of search list."))
+            break;
+        else if (inList)
+            paths.append(QDir::cleanPath(line.trimmed()));
+    }
+    return paths;
+}
+
+static void collectStatements(const StatementModel& model, const PStatement& scope, QStringList& lines)
+{
+    foreach (const PStatement& statement, model.childrenStatements(scope)) {
+        lines.append(QString::number((int)statement->kind) + " " + statement->type
+                     + " " + statement->fullName + statement->args
+                     + " " + statement->fileName + ":" + QString::number(statement->line)
+                     + " " + statement->definitionFileName + ":" + QString::number(statement->definitionLine));
+        collectStatements(model, statement, lines);
+    }
+}
+
+struct ParseResult {
+    qint64 time; // microseconds
+    int statements;
+    QByteArray digest; // of all statements, sorted
+    QString memoryUsage;
+};
+
+static ParseResult parse(const QStringList& files, const QString& dirName,
+                         const QStringList& includePaths, bool concurrently)
+{
+    CppParser parser;
+    parser.resetParser();
+    parser.setLanguage(ParserLanguage::CPlusPlus);
+    parser.setParseGlobalHeaders(!includePaths.isEmpty());
+    parser.setParseLocalHeaders(true);
+    parser.setParseFilesConcurrently(concurrently);
+    foreach (const QString& path, includePaths)
+        parser.addIncludePath(path);
+    parser.addProjectIncludePath(dirName);
+    parser.parseHardDefines();
+    foreach (const QString& file, files)
+        parser.addProjectFile(file, true);
+
+    ParseResult result;
+    QElapsedTimer timer;
+    timer.start();
+    parser.parseFileList(false);
+    result.time = timer.nsecsElapsed() / 1000;
+
+    QStringList lines;
+    collectStatements(parser.statementList(), PStatement(), lines);
+    lines.sort();
+    result.statements = lines.count();
+    result.digest = QCryptographicHash::hash(lines.join('\n').toUtf8(), QCryptographicHash::Md5);
+    result.memoryUsage = parser.statementList().memoryUsage();
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QString dirName = QDir(argc > 1 ? QString::fromLocal8Bit(argv[1]) : QDir::currentPath()).absolutePath();
+    int rounds = argc > 2 ? std::max(1, atoi(argv[2])) : 3;
+    if (!QDir(dirName).exists()) {
+        fprintf(stderr, "Usage: %s [directory] [rounds]\n", argv[0]);
+        return 1;
+    }
+
+    QStringList files;
+    QDirIterator it(dirName, QStringList{"*.c", "*.cpp", "*.cc", "*.cxx", "*.h", "*.hpp"},
+                    QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext())
+        files.append(it.next());
+    QStringList includePaths = compilerIncludePaths();
+
+    initParser();
+    printf("%s: %d files, %d system include paths, %d cores\n",
+           dirName.toLocal8Bit().constData(), files.count(), includePaths.count(),
+           QThread::idealThreadCount());
+
+    auto best = [&](bool concurrently) {
+        ParseResult result;
+        for (int i = 0; i < rounds; i++) {
+            ParseResult r = parse(files, dirName, includePaths, concurrently);
+            if (i == 0 || r.time < result.time)
+                result = r;
+        }
+        return result;
+    };
+
+    ParseResult serial = best(false);
+    printf("%-24s %9.1f ms  %d statements\n", "serial", serial.time / 1000.0, serial.statements);
+    printf("  %s\n", serial.memoryUsage.toLocal8Bit().constData());
+
+    bool same = true;
+    QList<int> threadCounts;
+    for (int n = 1; n < QThread::idealThreadCount(); n *= 2)
+        threadCounts.append(n);
+    threadCounts.append(QThread::idealThreadCount());
+    foreach (int threads, threadCounts) {
+        QThreadPool::globalInstance()->setMaxThreadCount(threads);
+        ParseResult result = best(true);
+        bool identical = result.digest == serial.digest;
+        same = same && identical;
+        printf("%-24s %9.1f ms  %d statements  speedup %.2fx  %s\n",
+               QString("concurrent, %1 threads").arg(threads).toLocal8Bit().constData(),
+               result.time / 1000.0, result.statements,
+               result.time > 0 ? (double)serial.time / result.time : 0.0,
+               identical ? "same symbols" : "DIFFERENT SYMBOLS");
+    }
+    return same ? 0 : 1;
+}
@@ -0,0 +1,419 @@
+// Time the editor on a generated C file. Each section times the current code next to the way
+// it was done before, so the numbers can be compared on the same machine:
+//   load     loading a very large file (about 100 MB by default), against reading it line by line
+//            and computing the glyph lists right away
+//   states   syntax states interned by the document, against a full state kept for each line
+//   widths   glyph lists and line widths with the ascii fast path, against measuring glyph by glyph
+//   search   BasicSearcher on about 100 MB of text, against the QString::indexOf() loop;
+//            both must find the same matches
+//   paint    scrolling and repainting with the render cache, against laying out all glyph runs
+//            in each frame
+// Usage: bench-qsynedit [lines] [very large file lines] [sections, comma separated, all by default]
+// Set QT_QPA_PLATFORM=offscreen to run it without a display.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QFontDatabase>
+#include <QFontMetrics>
+#include <QStringList>
+#include <QTemporaryDir>
+#include <QTextStream>
+
+#include <qsynedit/document.h>
+#include <qsynedit/qsynedit.h>
+#include <qsynedit/searcher/basicsearcher.h>
+#include <qsynedit/syntaxer/cpp.h>
+#include <qt_utils/utils.h>
+
+static const char* const FunctionTemplate[] = {
+    "/* function %1",
+    " * returns the weighted count of newlines in s */",
+    "static int function%1(int count, const char *s) // count is the length of s",
+    "{",
+    "    int total = 0; // 换行符的加权个数",
+    "    for (int i = 0; i < count; i++) {",
+    "        if (s[i] == '\\n')",
+    "            total += i * 3;",
+    "    }",
+    "    printf(\"function%1: %d\\n\", total);",
+    "    return total;",
+    "}",
+    "",
+};
+
+static void generateFile(const QString& fileName, int lines)
+{
+    QFile file(fileName);
+    if (!file.open(QFile::WriteOnly | QFile::Truncate)) {
+        fprintf(stderr, "Can't create %s\n", fileName.toLocal8Bit().constData());
+        exit(1);
+    }
+    QTextStream stream(&file);
+    stream.setCodec("UTF-8");
+    const int templateLines = sizeof(FunctionTemplate) / sizeof(FunctionTemplate[0]);
+    for (int i = 0; i < lines; i++) {
+        stream << QString(FunctionTemplate[i % templateLines]).arg(i / templateLines) << "\n";
+    }
+}
+
+// calcGlyphStartCharList() before the ascii fast path: every char is checked for
+// surrogates, joiners, combining chars and variation selectors
+static QList<int> calcGlyphStartCharListGlyphByGlyph(const QString &text)
+{
+    QList<int> glyphStartCharList;
+    int i=0;
+    bool consecutive = false;
+    while (i<text.length()) {
+        QChar ch = text[i];
+        if (ch.isHighSurrogate() && i+1<text.length() && QChar::isLowSurrogate(text[i+1].unicode())) {
+            uint ucs4 = QChar::surrogateToUcs4(ch, text[i+1]);
+            if (QChar::combiningClass(ucs4)!=0 && !glyphStartCharList.isEmpty()) {
+            } else if (ucs4>=0xE0100 && ucs4 <= 0xE01EF) {
+            } else if (ucs4>=0x1F3FB && ucs4 <= 0x1F3FF) {
+            } else if (!consecutive) {
+                glyphStartCharList.append(i);
+                consecutive = (ucs4>=0x1F1E6 && ucs4<=0x1F1FF);
+            } else {
+                consecutive = false;
+            }
+            i+=2;
+            continue;
+        } else if (ch.unicode() == 0x200D || ch.unicode() == 0x200C ) {
+            consecutive = true;
+        } else if (ch.combiningClass()!=0 && !glyphStartCharList.isEmpty()) {
+        } else if (ch.unicode()>=0xFE00 && ch.unicode()<=0xFE0F) {
+        } else {
+            if (!consecutive)
+                glyphStartCharList.append(i);
+            consecutive = false;
+        }
+        i++;
+    }
+    return glyphStartCharList;
+}
+
+// load a file as Document::loadFromFile() did before: one QFile::readLine() per line,
+// and the glyph list of each line computed when the line is added
+static int loadLineByLine(const QString& fileName, QStringList& lines, QList<QList<int>>& glyphStartCharLists)
+{
+    QFile file(fileName);
+    if (!file.open(QFile::ReadOnly))
+        return 0;
+    while (!file.atEnd()) {
+        QByteArray line = file.readLine();
+        if (line.endsWith("\r\n"))
+            line.remove(line.length()-2,2);
+        else if (line.endsWith("\r") || line.endsWith("\n"))
+            line.remove(line.length()-1,1);
+        QString text = QString::fromUtf8(line);
+        glyphStartCharLists.append(calcGlyphStartCharListGlyphByGlyph(text));
+        lines.append(text);
+    }
+    return lines.count();
+}
+
+// find all matches as BasicSearcher::findAll() did before: a QString::indexOf() loop
+static int findAllWithIndexOf(const QString& text, const QString& pattern, QSynedit::SearchOptions options)
+{
+    auto isDelimitChar = [](const QChar& ch) {
+        return !(ch == '_' || ch.isLetterOrNumber());
+    };
+    int count = 0;
+    int start = 0;
+    while (true) {
+        int next = text.indexOf(pattern, start,
+                                options.testFlag(QSynedit::ssoMatchCase) ? Qt::CaseSensitive : Qt::CaseInsensitive);
+        if (next < 0)
+            break;
+        start = next + pattern.length();
+        if (!options.testFlag(QSynedit::ssoWholeWord)
+                || ((next <= 0 || isDelimitChar(text[next-1]))
+                    && (start >= text.length() || isDelimitChar(text[start]))))
+            count++;
+    }
+    return count;
+}
+
+static qint64 residentMemory()
+{
+#ifdef Q_OS_LINUX
+    QFile file("/proc/self/status");
+    if (file.open(QFile::ReadOnly)) {
+        foreach (const QByteArray& line, file.readAll().split('\n')) {
+            if (line.startsWith("VmRSS:"))
+                return line.mid(6).trimmed().split(' ').first().toLongLong() * 1024;
+        }
+    }
+#endif
+    return 0;
+}
+
+static void report(const QString& phase, const QElapsedTimer& timer)
+{
+    qint64 rss = residentMemory();
+    if (rss > 0)
+        printf("  %-50s %10.1f ms   rss %6lld MB\n", phase.toLocal8Bit().constData(),
+               timer.nsecsElapsed() / 1000000.0, rss / 1024 / 1024);
+    else
+        printf("  %-50s %10.1f ms\n", phase.toLocal8Bit().constData(), timer.nsecsElapsed() / 1000000.0);
+}
+
+static void reportSpeedup(qint64 oldTime, qint64 newTime)
+{
+    printf("  %-50s %10.2fx\n", "speedup", newTime > 0 ? (double)oldTime / newTime : 0.0);
+}
+
+static void benchLoad(const QTemporaryDir& dir, int largeLines)
+{
+    QString largeFileName = dir.filePath("large.c");
+    generateFile(largeFileName, largeLines);
+    printf("load: very large file, %d lines, %.1f MB\n",
+           largeLines, QFileInfo(largeFileName).size() / 1024.0 / 1024.0);
+    QElapsedTimer timer;
+    qint64 oldTime;
+    {
+        QStringList oldLines;
+        QList<QList<int>> glyphStartCharLists;
+        timer.start();
+        loadLineByLine(largeFileName, oldLines, glyphStartCharLists);
+        oldTime = timer.nsecsElapsed();
+        report("line by line (old)", timer);
+    }
+    qint64 newTime;
+    {
+        QSynedit::Document document(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+        QByteArray realEncoding;
+        timer.start();
+        document.loadFromFile(largeFileName, ENCODING_AUTO_DETECT, realEncoding);
+        newTime = timer.nsecsElapsed();
+        report("Document::loadFromFile()", timer);
+    }
+    reportSpeedup(oldTime, newTime);
+    QFile::remove(largeFileName);
+}
+
+static bool benchSyntaxStates(QSynedit::QSynEdit& edit, const QString& fileName)
+{
+    //a document without states yet, so the memory used by the interned states can be seen
+    QSynedit::PDocument document = std::make_shared<QSynedit::Document>(edit.font());
+    QByteArray realEncoding;
+    document->loadFromFile(fileName, ENCODING_UTF8, realEncoding);
+    QSynedit::PSyntaxer syntaxer = edit.syntaxer();
+    printf("states: %d lines\n", document->count());
+    QElapsedTimer timer;
+    qint64 rssBefore = residentMemory();
+    QVector<QSynedit::SyntaxState> states;
+    timer.start();
+    syntaxer->resetState();
+    for (int i = 0; i < document->count(); i++) {
+        syntaxer->setLine(document->getLine(i), i);
+        syntaxer->nextToEol();
+        states.append(syntaxer->getState());
+    }
+    qint64 oldTime = timer.nsecsElapsed();
+    report("a state for each line (old)", timer);
+    qint64 oldMemory = residentMemory() - rssBefore;
+
+    rssBefore = residentMemory();
+    timer.start();
+    syntaxer->resetState();
+    for (int i = 0; i < document->count(); i++) {
+        syntaxer->setLine(document->getLine(i), i);
+        syntaxer->nextToEol();
+        document->setSyntaxState(i, syntaxer->getState());
+    }
+    qint64 newTime = timer.nsecsElapsed();
+    report("interned by the document", timer);
+    qint64 newMemory = residentMemory() - rssBefore;
+    reportSpeedup(oldTime, newTime);
+    if (oldMemory > 0)
+        printf("  %-50s %7lld KB / %lld KB\n", "memory (old / interned)", oldMemory / 1024, newMemory / 1024);
+
+    bool same = true;
+    for (int i = 0; i < document->count() && same; i++)
+        same = document->getSyntaxState(i) == states[i];
+    printf("  %s\n", same ? "same states" : "DIFFERENT STATES");
+    return same;
+}
+
+static bool benchWidths(QSynedit::QSynEdit& edit)
+{
+    QSynedit::PDocument document = edit.document();
+    printf("widths: %d lines\n", document->count());
+    QSynedit::GlyphCalculator calculator(edit.font());
+    //the fast path is only used with the calculator's own font metrics
+    QFontMetrics fontMetrics(calculator.fontMetrics());
+    QElapsedTimer timer;
+    qint64 oldWidth = 0;
+    timer.start();
+    for (int i = 0; i < document->count(); i++) {
+        QString line = document->getLine(i);
+        int right = 0;
+        calculator.calcGlyphPositionList(line, calcGlyphStartCharListGlyphByGlyph(line), fontMetrics, 0, right);
+        oldWidth += right;
+    }
+    qint64 oldTime = timer.nsecsElapsed();
+    report("glyph by glyph (old)", timer);
+    qint64 newWidth = 0;
+    timer.start();
+    for (int i = 0; i < document->count(); i++) {
+        QString line = document->getLine(i);
+        int right = 0;
+        calculator.calcGlyphPositionList(line, QSynedit::calcGlyphStartCharList(line), 0, right);
+        newWidth += right;
+    }
+    qint64 newTime = timer.nsecsElapsed();
+    report("ascii fast path", timer);
+    reportSpeedup(oldTime, newTime);
+    printf("  %s\n", oldWidth == newWidth ? "same widths" : "DIFFERENT WIDTHS");
+
+    timer.start();
+    qint64 totalWidth = 0;
+    for (int i = 0; i < document->count(); i++)
+        totalWidth += document->lineWidth(i);
+    report("document line widths", timer);
+
+    QFont font = edit.font();
+    font.setPointSize(font.pointSize() + 2);
+    timer.start();
+    edit.setFont(font);
+    for (int i = 0; i < document->count(); i++)
+        totalWidth += document->lineWidth(i);
+    report("document line widths after font change", timer);
+    printf("  total width %lld\n", totalWidth);
+    return oldWidth == newWidth;
+}
+
+static bool benchSearch(QSynedit::QSynEdit& edit)
+{
+    QSynedit::PDocument document = edit.document();
+    qint64 textSize = 0;
+    for (int i = 0; i < document->count(); i++)
+        textSize += document->getLine(i).length();
+    //search the lines several times, so about 100 MB of text is searched without keeping it in memory
+    int searchRounds = std::max<qint64>(1, 100 * 1024 * 1024 / std::max<qint64>(1, textSize));
+    printf("search: %.1f MB of text (%d rounds)\n", textSize * searchRounds / 1024.0 / 1024.0, searchRounds);
+    struct SearchCase {
+        const char* name;
+        QSynedit::SearchOptions options;
+    };
+    const SearchCase searchCases[] = {
+        {"match case", QSynedit::ssoMatchCase},
+        {"ignore case", QSynedit::SearchOptions()},
+        {"whole word", QSynedit::ssoMatchCase | QSynedit::ssoWholeWord},
+    };
+    QElapsedTimer timer;
+    bool sameMatches = true;
+    foreach (const QString& pattern, QStringList{"total", "weighted count"}) {
+        for (const SearchCase& searchCase : searchCases) {
+            int oldFound = 0;
+            timer.start();
+            for (int round = 0; round < searchRounds; round++) {
+                for (int i = 0; i < document->count(); i++)
+                    oldFound += findAllWithIndexOf(document->getLine(i), pattern, searchCase.options);
+            }
+            qint64 oldTime = timer.nsecsElapsed();
+            report(QString("\"%1\", %2, indexOf (old)").arg(pattern, searchCase.name), timer);
+
+            QSynedit::BasicSearcher searcher;
+            searcher.setPattern(pattern);
+            searcher.setOptions(searchCase.options);
+            int newFound = 0;
+            timer.start();
+            for (int round = 0; round < searchRounds; round++) {
+                for (int i = 0; i < document->count(); i++)
+                    newFound += searcher.findAll(document->getLine(i));
+            }
+            qint64 newTime = timer.nsecsElapsed();
+            report(QString("\"%1\", %2, BasicSearcher").arg(pattern, searchCase.name), timer);
+            reportSpeedup(oldTime, newTime);
+            printf("  %d matches, %s\n", newFound,
+                   newFound == oldFound ? "same as old" : "DIFFERENT FROM OLD");
+            sameMatches = sameMatches && newFound == oldFound;
+        }
+    }
+    return sameMatches;
+}
+
+// paint frames, scrolling down by one line in each one if scroll is true.
+// If the render cache is not used, all glyph runs are laid out again in each frame.
+static qint64 paintFrames(QSynedit::QSynEdit& edit, int frames, bool scroll, bool useRenderCache)
+{
+    edit.setTopPos(0);
+    edit.repaint();
+    edit.resetPaintStatistics();
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < frames; i++) {
+        if (scroll)
+            edit.setTopPos(i * edit.textHeight());
+        if (!useRenderCache)
+            edit.invalidateRenderedLines();
+        edit.repaint();
+    }
+    qint64 time = timer.nsecsElapsed();
+    QString phase = QString(scroll ? "scroll by one line" : "repaint unchanged")
+            + (useRenderCache ? "" : ", no render cache (old)");
+    report(phase, timer);
+    const QSynedit::PaintStatistics& statistics = edit.paintStatistics();
+    printf("  %d frames, avg %.2f ms, max %.2f ms, glyph runs cached/prepared %d/%d, scrolls blitted %d\n",
+           statistics.frames,
+           statistics.frames > 0 ? statistics.totalFrameTime / 1000.0 / statistics.frames : 0.0,
+           statistics.maxFrameTime / 1000.0,
+           statistics.cachedRuns, statistics.preparedRuns, statistics.blittedScrolls);
+    return time;
+}
+
+static void benchPaint(QSynedit::QSynEdit& edit)
+{
+    printf("paint:\n");
+    edit.show();
+    const int frames = 500;
+    foreach (bool scroll, QList<bool>{true, false}) {
+        qint64 oldTime = paintFrames(edit, frames, scroll, false);
+        qint64 newTime = paintFrames(edit, frames, scroll, true);
+        reportSpeedup(oldTime, newTime);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    QApplication app(argc, argv);
+    int lines = argc > 1 ? std::max(1, atoi(argv[1])) : 500000;
+    int largeLines = argc > 2 ? std::max(1, atoi(argv[2])) : 3000000;
+    QStringList sections = QString(argc > 3 ? argv[3] : "load,states,widths,search,paint").split(',');
+
+    QTemporaryDir dir;
+    if (sections.contains("load"))
+        benchLoad(dir, largeLines);
+
+    QString fileName = dir.filePath("bench.c");
+    generateFile(fileName, lines);
+    QSynedit::QSynEdit edit;
+    edit.resize(1000, 800);
+    edit.setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    edit.setSyntaxer(std::make_shared<QSynedit::CppSyntaxer>());
+    QElapsedTimer timer;
+    timer.start();
+    QByteArray realEncoding;
+    edit.document()->loadFromFile(fileName, ENCODING_UTF8, realEncoding);
+    edit.reparseDocument();
+    printf("%d lines, loaded and parsed in %.1f ms\n", edit.document()->count(), timer.nsecsElapsed() / 1000000.0);
+
+    bool ok = true;
+    if (sections.contains("states"))
+        ok = benchSyntaxStates(edit, fileName) && ok;
+    if (sections.contains("widths"))
+        ok = benchWidths(edit) && ok;
+    if (sections.contains("search"))
+        ok = benchSearch(edit) && ok;
+    if (sections.contains("paint"))
+        benchPaint(edit);
+    return ok ? 0 : 1;
+}
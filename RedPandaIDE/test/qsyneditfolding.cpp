@@ -0,0 +1,122 @@
+// Edit a generated C file at random places, and check that the fold ranges rescanned
+// in the changed lines are the same as the ones found by a full rescan of the document.
+// Usage: test-qsynedit-folding [edits] [seed]
+// It runs on the offscreen platform unless QT_QPA_PLATFORM is set.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+#include <QApplication>
+#include <QFontDatabase>
+#include <QRandomGenerator>
+#include <QStringList>
+
+#include <qsynedit/document.h>
+#include <qsynedit/qsynedit.h>
+#include <qsynedit/syntaxer/cpp.h>
+
+static QString generateText(QRandomGenerator& random, int functions)
+{
+    QStringList lines;
+    for (int i = 0; i < functions; i++) {
+        lines.append(QString("int function%1(int n)").arg(i));
+        lines.append("{");
+        int depth = 1;
+        int statements = random.bounded(3, 12);
+        for (int j = 0; j < statements; j++) {
+            QString indent(depth * 4, ' ');
+            switch (random.bounded(4)) {
+            case 0:
+                lines.append(indent + "if (n > 0) {");
+                depth++;
+                break;
+            case 1:
+                if (depth > 1) {
+                    depth--;
+                    lines.append(QString(depth * 4, ' ') + "} else {");
+                    depth++;
+                } else {
+                    lines.append(indent + "n--; /* { */");
+                }
+                break;
+            case 2:
+                if (depth > 1) {
+                    depth--;
+                    lines.append(QString(depth * 4, ' ') + "}");
+                } else {
+                    lines.append(indent + "n++;");
+                }
+                break;
+            default:
+                lines.append(indent + "int a[] = { 1, 2, 3 };");
+            }
+        }
+        while (depth > 0) {
+            depth--;
+            lines.append(QString(depth * 4, ' ') + "}");
+        }
+        lines.append("");
+    }
+    return lines.join("\n");
+}
+
+int main(int argc, char *argv[])
+{
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    QApplication app(argc, argv);
+    int edits = argc > 1 ? std::max(1, atoi(argv[1])) : 2000;
+    quint32 seed = argc > 2 ? (quint32)atoi(argv[2]) : 20240517;
+    QRandomGenerator random(seed);
+
+    QSynedit::QSynEdit edit;
+    edit.resize(800, 600);
+    edit.setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    edit.setSyntaxer(std::make_shared<QSynedit::CppSyntaxer>());
+    edit.setUseCodeFolding(true);
+    edit.document()->setText(generateText(random, 200));
+    edit.finishPendingReparse();
+    if (!edit.foldRangesMatchFullRescan()) {
+        fprintf(stderr, "fold ranges differ after loading\n");
+        return 1;
+    }
+
+    static const char* const Insertions[] = {
+        "{", "}", "} else {", "\n", "{\n", "\n}", "/* ", " */", "// ",
+    };
+    const int insertionCount = sizeof(Insertions) / sizeof(Insertions[0]);
+    int failures = 0;
+    for (int i = 0; i < edits; i++) {
+        int lineCount = edit.document()->count();
+        int line = random.bounded(lineCount) + 1;
+        QString description;
+        if (lineCount > 1 && random.bounded(5) == 0) {
+            // delete some lines
+            int count = std::min(random.bounded(1, 4), lineCount - line);
+            if (count == 0) {
+                line--;
+                count = 1;
+            }
+            edit.setBlockBegin(QSynedit::BufferCoord{1, line});
+            edit.setBlockEnd(QSynedit::BufferCoord{1, line + count});
+            edit.setSelText("");
+            description = QString("delete %1 lines at line %2").arg(count).arg(line);
+        } else {
+            QString text = Insertions[random.bounded(insertionCount)];
+            int ch = random.bounded(edit.document()->getLine(line - 1).length() + 1) + 1;
+            edit.setCaretXY(QSynedit::BufferCoord{ch, line});
+            edit.setSelText(text);
+            description = QString("insert \"%1\" at %2:%3").arg(QString(text).replace("\n", "\\n")).arg(line).arg(ch);
+        }
+        edit.finishPendingReparse();
+        if (!edit.foldRangesMatchFullRescan()) {
+            fprintf(stderr, "edit %d: fold ranges differ after %s\n", i, description.toLocal8Bit().constData());
+            failures++;
+            // start again from the right fold ranges
+            edit.reparseDocument();
+        }
+    }
+    printf("%d edits, %d failures, seed %u\n", edits, failures, seed);
+    return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,77 @@
+// Tokenize all files in a directory (the newest libstdc++ headers by default) and print the time.
+// Usage: bench-tokenizer [directory] [rounds]
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QStringList>
+#include <QVector>
+
+#include "parser/cpptokenizer.h"
+
+static QString defaultHeaderDir()
+{
+    QDir dir("/usr/include/c++");
+    QStringList versions = dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name);
+    if (versions.isEmpty())
+        return QString();
+    std::sort(versions.begin(), versions.end(), [](const QString& s1, const QString& s2) {
+        return s1.split('.').first().toInt() < s2.split('.').first().toInt();
+    });
+    return dir.absoluteFilePath(versions.last());
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QString dirName = argc > 1 ? QString::fromLocal8Bit(argv[1]) : defaultHeaderDir();
+    int rounds = argc > 2 ? std::max(1, atoi(argv[2])) : 5;
+    if (dirName.isEmpty() || !QDir(dirName).exists()) {
+        fprintf(stderr, "Usage: %s [directory] [rounds]\n", argv[0]);
+        return 1;
+    }
+
+    QVector<QStringList> files;
+    qint64 lines = 0;
+    QDirIterator it(dirName, QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        QFile file(it.next());
+        if (!file.open(QFile::ReadOnly))
+            continue;
+        QStringList content = QString::fromUtf8(file.readAll()).split('\n');
+        lines += content.count();
+        files.append(content);
+    }
+
+    initParser();
+    CppTokenizer tokenizer;
+    tokenizer.setKeywords(CppKeywords);
+    qint64 tokens = 0;
+    qint64 minTime = -1;
+    qint64 totalTime = 0;
+    for (int i = 0; i < rounds; i++) {
+        tokens = 0;
+        QElapsedTimer timer;
+        timer.start();
+        foreach (const QStringList& content, files) {
+            tokenizer.tokenize(content);
+            tokens += tokenizer.tokenCount();
+        }
+        qint64 time = timer.nsecsElapsed() / 1000;
+        totalTime += time;
+        if (minTime < 0 || time < minTime)
+            minTime = time;
+    }
+    printf("%s: %d files, %lld lines, %lld tokens\n",
+           dirName.toLocal8Bit().constData(), files.count(), lines, tokens);
+    printf("%d rounds, min %.1f ms, avg %.1f ms, %.2f M tokens/s\n",
+           rounds, minTime / 1000.0, totalTime / 1000.0 / rounds,
+           minTime > 0 ? (double)tokens / minTime : 0.0);
+    return 0;
+}
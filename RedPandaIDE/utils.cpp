@@ -302,6 +302,9 @@ void resetCppParser(std::shared_ptr<CppParser> parser, int compilerSetIndex)
         parser->addHardDefineByLine("#define __TIME__  1");
     }
     parser->parseHardDefines();
+    if (pSettings->codeCompletion().cacheSystemHeaderSymbols())
+        parser->setSymbolCacheDir(includeTrailingPathDelimiter(pSettings->dirs().config())+"symbolcache");
+    parser->setParseFilesConcurrently(pSettings->codeCompletion().parseFilesConcurrently());
     pMainWindow->disconnect(parser.get(),
                             &CppParser::onStartParsing,
                             pMainWindow,
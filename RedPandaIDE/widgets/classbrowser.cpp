@@ -268,7 +268,7 @@ PClassBrowserNode ClassBrowserModel::addChild(ClassBrowserNode *node, const PSta
     }
     //don't show enum type's children values (they are displayed in parent scope)
 //    if (statement->kind != StatementKind::skEnumType) {
-        filterChildren(newNode.get(), statement->children);
+        filterChildren(newNode.get(), mParser->statementList().childrenStatements(statement));
 //    }
     return newNode;
 }
@@ -405,7 +405,7 @@ void ClassBrowserModel::filterChildren(ClassBrowserNode *node, const StatementMa
                 PStatement dummy = createDummy(statement);
                 scopeNode = addChild(parentNode,dummy);
             }
-            filterChildren(scopeNode.get(),statement->children);
+            filterChildren(scopeNode.get(),mParser->statementList().childrenStatements(statement));
         } else {
             addChild(parentNode,statement);
         }
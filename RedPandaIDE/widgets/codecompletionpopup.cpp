@@ -36,7 +36,7 @@ CodeCompletionPopup::CodeCompletionPopup(QWidget *parent) :
 {
     setWindowFlags(Qt::Popup);
     mListView = new CodeCompletionListView(this);
-    mModel=new CodeCompletionListModel(&mCompletionStatementList);
+    mModel=new CodeCompletionListModel(&mCompletionStatementList, &mMatches);
     mDelegate = new CodeCompletionListItemDelegate(mModel,this);
     QItemSelectionModel *m=mListView->selectionModel();
     mListView->setModel(mModel);
@@ -311,15 +311,16 @@ static bool nameComparator(PStatement statement1,PStatement statement2) {
     return statement1->command < statement2->command;
 }
 
-static bool defaultComparator(PStatement statement1,PStatement statement2) {
-    if (statement1->matchPosSpan!=statement2->matchPosSpan)
-        return statement1->matchPosSpan < statement2->matchPosSpan;
-    if (statement1->firstMatchLength != statement2->firstMatchLength)
-        return statement1->firstMatchLength > statement2->firstMatchLength;
-    if (statement1->matchPosTotal != statement2->matchPosTotal)
-        return statement1->matchPosTotal < statement2->matchPosTotal;
-    if (statement1->caseMatched != statement2->caseMatched)
-        return statement1->caseMatched > statement2->caseMatched;
+static bool defaultComparator(const PStatement& statement1, const CompletionMatch& match1,
+        const PStatement& statement2, const CompletionMatch& match2) {
+    if (match1.matchPosSpan!=match2.matchPosSpan)
+        return match1.matchPosSpan < match2.matchPosSpan;
+    if (match1.firstMatchLength != match2.firstMatchLength)
+        return match1.firstMatchLength > match2.firstMatchLength;
+    if (match1.matchPosTotal != match2.matchPosTotal)
+        return match1.matchPosTotal < match2.matchPosTotal;
+    if (match1.caseMatched != match2.caseMatched)
+        return match1.caseMatched > match2.caseMatched;
     // Show user template first
     if (statement1->kind == StatementKind::UserCodeSnippet) {
         if (statement2->kind != StatementKind::UserCodeSnippet)
@@ -339,15 +340,16 @@ static bool defaultComparator(PStatement statement1,PStatement statement2) {
         return nameComparator(statement1,statement2);
 }
 
-static bool sortByScopeComparator(PStatement statement1,PStatement statement2){
-    if (statement1->matchPosSpan!=statement2->matchPosSpan)
-        return statement1->matchPosSpan < statement2->matchPosSpan;
-    if (statement1->firstMatchLength != statement2->firstMatchLength)
-        return statement1->firstMatchLength > statement2->firstMatchLength;
-    if (statement1->matchPosTotal != statement2->matchPosTotal)
-        return statement1->matchPosTotal < statement2->matchPosTotal;
-    if (statement1->caseMatched != statement2->caseMatched)
-        return statement1->caseMatched > statement2->caseMatched;
+static bool sortByScopeComparator(const PStatement& statement1, const CompletionMatch& match1,
+        const PStatement& statement2, const CompletionMatch& match2){
+    if (match1.matchPosSpan!=match2.matchPosSpan)
+        return match1.matchPosSpan < match2.matchPosSpan;
+    if (match1.firstMatchLength != match2.firstMatchLength)
+        return match1.firstMatchLength > match2.firstMatchLength;
+    if (match1.matchPosTotal != match2.matchPosTotal)
+        return match1.matchPosTotal < match2.matchPosTotal;
+    if (match1.caseMatched != match2.caseMatched)
+        return match1.caseMatched > match2.caseMatched;
     // Show user template first
     if (statement1->kind == StatementKind::UserCodeSnippet) {
         if (statement2->kind != StatementKind::UserCodeSnippet)
@@ -383,15 +385,16 @@ static bool sortByScopeComparator(PStatement statement1,PStatement statement2){
         return nameComparator(statement1,statement2);
 }
 
-static bool sortWithUsageComparator(PStatement statement1,PStatement statement2) {
-    if (statement1->matchPosSpan!=statement2->matchPosSpan)
-        return statement1->matchPosSpan < statement2->matchPosSpan;
-    if (statement1->firstMatchLength != statement2->firstMatchLength)
-        return statement1->firstMatchLength > statement2->firstMatchLength;
-    if (statement1->matchPosTotal != statement2->matchPosTotal)
-        return statement1->matchPosTotal < statement2->matchPosTotal;
-    if (statement1->caseMatched != statement2->caseMatched)
-        return statement1->caseMatched > statement2->caseMatched;
+static bool sortWithUsageComparator(const PStatement& statement1, const CompletionMatch& match1,
+        const PStatement& statement2, const CompletionMatch& match2) {
+    if (match1.matchPosSpan!=match2.matchPosSpan)
+        return match1.matchPosSpan < match2.matchPosSpan;
+    if (match1.firstMatchLength != match2.firstMatchLength)
+        return match1.firstMatchLength > match2.firstMatchLength;
+    if (match1.matchPosTotal != match2.matchPosTotal)
+        return match1.matchPosTotal < match2.matchPosTotal;
+    if (match1.caseMatched != match2.caseMatched)
+        return match1.caseMatched > match2.caseMatched;
     // Show user template first
     if (statement1->kind == StatementKind::UserCodeSnippet) {
         if (statement2->kind != StatementKind::UserCodeSnippet)
@@ -402,8 +405,8 @@ static bool sortWithUsageComparator(PStatement statement1,PStatement statement2)
         return false;
         //show most freq first
     }
-    if (statement1->usageCount != statement2->usageCount)
-        return statement1->usageCount > statement2->usageCount;
+    if (match1.usageCount != match2.usageCount)
+        return match1.usageCount > match2.usageCount;
 
     if ((statement1->kind != StatementKind::Keyword)
                && (statement2->kind == StatementKind::Keyword)) {
@@ -415,15 +418,16 @@ static bool sortWithUsageComparator(PStatement statement1,PStatement statement2)
         return nameComparator(statement1,statement2);
 }
 
-static bool sortByScopeWithUsageComparator(PStatement statement1,PStatement statement2){
-    if (statement1->matchPosSpan!=statement2->matchPosSpan)
-        return statement1->matchPosSpan < statement2->matchPosSpan;
-    if (statement1->firstMatchLength != statement2->firstMatchLength)
-        return statement1->firstMatchLength > statement2->firstMatchLength;
-    if (statement1->matchPosTotal != statement2->matchPosTotal)
-        return statement1->matchPosTotal < statement2->matchPosTotal;
-    if (statement1->caseMatched != statement2->caseMatched)
-        return statement1->caseMatched > statement2->caseMatched;
+static bool sortByScopeWithUsageComparator(const PStatement& statement1, const CompletionMatch& match1,
+        const PStatement& statement2, const CompletionMatch& match2){
+    if (match1.matchPosSpan!=match2.matchPosSpan)
+        return match1.matchPosSpan < match2.matchPosSpan;
+    if (match1.firstMatchLength != match2.firstMatchLength)
+        return match1.firstMatchLength > match2.firstMatchLength;
+    if (match1.matchPosTotal != match2.matchPosTotal)
+        return match1.matchPosTotal < match2.matchPosTotal;
+    if (match1.caseMatched != match2.caseMatched)
+        return match1.caseMatched > match2.caseMatched;
     // Show user template first
     if (statement1->kind == StatementKind::UserCodeSnippet) {
         if (statement2->kind != StatementKind::UserCodeSnippet)
@@ -434,8 +438,8 @@ static bool sortByScopeWithUsageComparator(PStatement statement1,PStatement stat
         return false;
         //show most freq first
     }
-    if (statement1->usageCount != statement2->usageCount)
-        return statement1->usageCount > statement2->usageCount;
+    if (match1.usageCount != match2.usageCount)
+        return match1.usageCount > match2.usageCount;
 
         // show non-system defines before keyword
     if (statement1->kind == StatementKind::Keyword) {
@@ -488,7 +492,10 @@ void CodeCompletionPopup::filterList(const QString &member)
         int pos = 0;
         int lastPos = -10;
         int totalPos = 0;
-        statement->matchPositions.clear();
+        //statements may be shared by parsers of other editors, so the match
+        //  states are kept here instead of in the statements
+        CompletionMatch& match = mMatches[statement.get()];
+        match.matchPositions.clear();
         if (hideSymbolsTwoUnderline && statement->command.startsWith("__")) {
             continue;
         } else if (hideSymbolsUnderline && statement->command.startsWith("_")) {
@@ -503,12 +510,12 @@ void CodeCompletionPopup::filterList(const QString &member)
                     break;
                 }
                 if (pos == lastPos+1) {
-                    statement->matchPositions.last()->end++;
+                    match.matchPositions.last()->end++;
                 } else {
                     PStatementMathPosition matchPosition=std::make_shared<StatementMatchPosition>();
                     matchPosition->start = pos;
                     matchPosition->end = pos+1;
-                    statement->matchPositions.append(matchPosition);
+                    match.matchPositions.append(matchPosition);
                 }
                 if (ch==command[pos])
                     caseMatched++;
@@ -519,64 +526,48 @@ void CodeCompletionPopup::filterList(const QString &member)
             }
         }
 
-        if (mIgnoreCase && matched== len) {
-            statement->caseMatched = caseMatched;
-            statement->matchPosTotal = totalPos;
+        if ((mIgnoreCase && matched== len) || caseMatched == len) {
+            match.caseMatched = caseMatched;
+            match.matchPosTotal = totalPos;
             if (member.length()>0) {
-                statement->firstMatchLength = statement->matchPositions.front()->end - statement->matchPositions.front()->start;
-                statement->matchPosSpan = statement->matchPositions.last()->end - statement->matchPositions.front()->start;
-            } else
-                statement->firstMatchLength = 0;
-            mCompletionStatementList.append(statement);
-        } else if (caseMatched == len) {
-            statement->caseMatched = caseMatched;
-            statement->matchPosTotal = totalPos;
-            if (member.length()>0) {
-                statement->firstMatchLength = statement->matchPositions.front()->end - statement->matchPositions.front()->start;
-                statement->matchPosSpan = statement->matchPositions.last()->end - statement->matchPositions.front()->start;
-            } else
-                statement->firstMatchLength = 0;
+                match.firstMatchLength = match.matchPositions.front()->end - match.matchPositions.front()->start;
+                match.matchPosSpan = match.matchPositions.last()->end - match.matchPositions.front()->start;
+            } else {
+                match.firstMatchLength = 0;
+                match.matchPosSpan = 0;
+            }
             mCompletionStatementList.append(statement);
         } else {
-            statement->matchPositions.clear();
-            statement->caseMatched = 0;
-            statement->matchPosTotal = 0;
-            statement->firstMatchLength = 0;
-            statement->matchPosSpan = 0;
+            match.matchPositions.clear();
+            match.caseMatched = 0;
+            match.matchPosTotal = 0;
+            match.firstMatchLength = 0;
+            match.matchPosSpan = 0;
         }
     }
+    bool (*comparator)(const PStatement&, const CompletionMatch&,
+                       const PStatement&, const CompletionMatch&);
     if (mRecordUsage) {
-        int usageCount;
         foreach (const PStatement& statement,mCompletionStatementList) {
-            if (statement->usageCount == -1) {
-                PSymbolUsage usage = pMainWindow->symbolUsageManager()->findUsage(statement->fullName);
-                if (usage) {
-                    usageCount = usage->count;
-                } else {
-                    usageCount = 0;
-                }
-                statement->usageCount = usageCount;
+            CompletionMatch& match = mMatches[statement.get()];
+            if (match.usageCount == -1) {
+                PSymbolUsage usage;
+                if (statement->kind != StatementKind::UserCodeSnippet
+                        && statement->kind != StatementKind::Keyword)
+                    usage = pMainWindow->symbolUsageManager()->findUsage(statement->fullName);
+                match.usageCount = usage ? usage->count : 0;
             }
         }
-        if (mSortByScope) {
-            std::sort(mCompletionStatementList.begin(),
-                      mCompletionStatementList.end(),
-                      sortByScopeWithUsageComparator);
-        } else {
-            std::sort(mCompletionStatementList.begin(),
-                      mCompletionStatementList.end(),
-                      sortWithUsageComparator);
-        }
-    } else if (mSortByScope) {
-        std::sort(mCompletionStatementList.begin(),
-                  mCompletionStatementList.end(),
-                  sortByScopeComparator);
+        comparator = mSortByScope ? sortByScopeWithUsageComparator : sortWithUsageComparator;
     } else {
-        std::sort(mCompletionStatementList.begin(),
-                  mCompletionStatementList.end(),
-                  defaultComparator);
+        comparator = mSortByScope ? sortByScopeComparator : defaultComparator;
     }
-    //    }
+    std::sort(mCompletionStatementList.begin(),
+              mCompletionStatementList.end(),
+              [this,comparator](const PStatement& statement1, const PStatement& statement2) {
+        return comparator(statement1, mMatches.constFind(statement1.get()).value(),
+                          statement2, mMatches.constFind(statement2.get()).value());
+    });
 }
 
 void CodeCompletionPopup::getKeywordCompletionFor(const QSet<QString> &customKeywords)
@@ -646,7 +637,6 @@ void CodeCompletionPopup::getCompletionFor(
                     statement->value = codeIn->code;
                     statement->kind = StatementKind::UserCodeSnippet;
                     statement->fullName = codeIn->prefix;
-                    statement->usageCount = 0;
                     mFullCompletionStatementList.append(statement);
                 }
             }
@@ -1007,6 +997,7 @@ void CodeCompletionPopup::getCompletionForFunctionWithoutDefinition(const QStrin
 void CodeCompletionPopup::getCompletionListForComplexKeyword(const QString &preWord)
 {
     mFullCompletionStatementList.clear();
+    mMatches.clear();
     if (preWord == "long") {
         addKeyword("long");
         addKeyword("double");
@@ -1095,7 +1086,6 @@ void CodeCompletionPopup::addKeyword(const QString &keyword)
     statement->command = keyword;
     statement->kind = StatementKind::Keyword;
     statement->fullName = keyword;
-    statement->usageCount = 0;
     mFullCompletionStatementList.append(statement);
 }
 
@@ -1248,6 +1238,7 @@ void CodeCompletionPopup::hideEvent(QHideEvent *event)
 //        statement->matchPositions.clear();
 //    }
     mFullCompletionStatementList.clear();
+    mMatches.clear();
     mIncludedFiles.clear();
     mUsings.clear();
     mAddedStatements.clear();
@@ -1266,9 +1257,11 @@ bool CodeCompletionPopup::event(QEvent *event)
     return result;
 }
 
-CodeCompletionListModel::CodeCompletionListModel(const StatementList *statements, QObject *parent):
+CodeCompletionListModel::CodeCompletionListModel(const StatementList *statements,
+                                                 const CompletionMatchHash *matches, QObject *parent):
     QAbstractListModel(parent),
-    mStatements(statements)
+    mStatements(statements),
+    mMatches(matches)
 {
 
 }
@@ -1303,6 +1296,14 @@ PStatement CodeCompletionListModel::statement(const QModelIndex &index) const
     return mStatements->at(index.row());
 }
 
+QList<PStatementMathPosition> CodeCompletionListModel::matchPositions(const QModelIndex &index) const
+{
+    PStatement statement = this->statement(index);
+    if (!statement)
+        return QList<PStatementMathPosition>();
+    return mMatches->value(statement.get()).matchPositions;
+}
+
 QPixmap CodeCompletionListModel::statementIcon(const QModelIndex &index, int size) const
 {
     if (!index.isValid())
@@ -1349,7 +1350,7 @@ void CodeCompletionListItemDelegate::paint(QPainter *painter, const QStyleOption
         int pos=0;
         int padding = (option.rect.height()-painter->fontMetrics().height())/2;
         int y=option.rect.bottom()-painter->fontMetrics().descent()-padding;
-        foreach (const PStatementMathPosition& matchPosition, statement->matchPositions) {
+        foreach (const PStatementMathPosition& matchPosition, mModel->matchPositions(index)) {
             if (pos<matchPosition->start) {
                 QString t = text.mid(pos,matchPosition->start-pos);
                 painter->setPen(normalColor);
@@ -24,18 +24,36 @@
 #include "codecompletionlistview.h"
 
 class ColorSchemeItem;
+
+// how a statement matches the phrase being completed
+// (kept by the popup, since statements may be shared by the parsers of other editors)
+struct CompletionMatch {
+    int usageCount = -1; // -1: not read from the symbol usage manager yet
+    uint16_t matchPosTotal = 0; // total of matched positions
+    uint16_t matchPosSpan = 0; // distance between the first match pos and the last match pos;
+    uint16_t firstMatchLength = 0; // length of first match;
+    uint16_t caseMatched = 0; // if match with case
+    QList<PStatementMathPosition> matchPositions;
+};
+
+using CompletionMatchHash = QHash<const Statement*, CompletionMatch>;
+
 class CodeCompletionListModel : public QAbstractListModel {
     Q_OBJECT
 public:
-    explicit CodeCompletionListModel(const StatementList* statements,QObject *parent = nullptr);
+    explicit CodeCompletionListModel(const StatementList* statements,
+                                     const CompletionMatchHash* matches,
+                                     QObject *parent = nullptr);
     int rowCount(const QModelIndex &parent) const override;
     QVariant data(const QModelIndex &index, int role) const override;
     PStatement statement(const QModelIndex &index) const;
+    QList<PStatementMathPosition> matchPositions(const QModelIndex &index) const;
     QPixmap statementIcon(const QModelIndex &index, int size) const;
     void notifyUpdated();
 
 private:
     const StatementList* mStatements;
+    const CompletionMatchHash* mMatches;
 };
 
 enum class CodeCompletionType {
@@ -179,6 +197,7 @@ private:
     //QList<PStatement> mCodeInsStatements; //temporary (user code template) statements created when show code suggestion
     StatementList mFullCompletionStatementList;
     StatementList mCompletionStatementList;
+    CompletionMatchHash mMatches;
     QSet<QString> mIncludedFiles;
     QSet<QString> mUsings;
     QSet<QString> mAddedStatements;
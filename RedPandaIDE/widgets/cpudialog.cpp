@@ -173,6 +173,7 @@ void CPUDialog::updateSyntaxer()
     }
     syntaxerManager.applyColorScheme(ui->txtCode->syntaxer(),
                                         pSettings->editor().colorScheme());
+    ui->txtCode->invalidateRenderedLines();
 }
 
 void CPUDialog::closeEvent(QCloseEvent *event)
@@ -21,9 +21,17 @@
 #include <QDebug>
 #include <QProgressDialog>
 #include <QCompleter>
+#include <QCoreApplication>
 #include <QStack>
 #include <QFileDialog>
+#include <QElapsedTimer>
+#include <QQueue>
+#include <QRegularExpression>
+#include <QSemaphore>
+#include <QTextCodec>
+#include <QThreadPool>
 #include <qsynedit/document.h>
+#include <qt_utils/charsetinfo.h>
 #include <qsynedit/searcher/basicsearcher.h>
 #include <qsynedit/searcher/regexsearcher.h>
 #include "../editor.h"
@@ -183,67 +191,56 @@ void SearchInFileDialog::doSearch(bool replace)
         QDir::Filters filterOptions=QDir::Files | QDir::NoSymLinks;
         if (PATH_SENSITIVITY==Qt::CaseSensitive)
             filterOptions |= QDir::CaseSensitive;
+        // filters starting with '!' exclude files and folders, like in .gitignore
+        QStringList nameFilters;
+        QList<QRegularExpression> excludeFilters;
+        foreach (const QString& filter, ui->txtFilters->text().split(";")) {
+            QString f = filter.trimmed();
+            if (f.startsWith('!')) {
+                if (f.length()>1)
+                    excludeFilters.append(QRegularExpression(
+                                              QRegularExpression::wildcardToRegularExpression(f.mid(1)),
+                                              PATH_SENSITIVITY==Qt::CaseSensitive?
+                                                  QRegularExpression::NoPatternOption
+                                                : QRegularExpression::CaseInsensitiveOption));
+            } else if (!f.isEmpty()) {
+                nameFilters.append(f);
+            }
+        }
+        if (nameFilters.isEmpty())
+            nameFilters.append("*.*");
+        auto isExcluded = [&excludeFilters](const QFileInfo& entry) {
+            foreach (const QRegularExpression& filter, excludeFilters) {
+                if (filter.match(entry.fileName()).hasMatch())
+                    return true;
+            }
+            return false;
+        };
         while (!dirs.isEmpty()) {
             QDir dir=dirs.back();
             dirs.pop_back();
             foreach(const QFileInfo& entry, dir.entryInfoList(QDir::NoSymLinks | QDir::Dirs)) {
                 if (entry.fileName()==".." || entry.fileName()==".")
                     continue;
+                if (isExcluded(entry))
+                    continue;
                 if (!searched.contains(entry.absoluteFilePath())) {
                     dirs.push_back(QDir(entry.absoluteFilePath()));
                     searched.insert(entry.absoluteFilePath());
                 }
             }
-            foreach(const QFileInfo& entry, dir.entryInfoList(ui->txtFilters->text().split(";"), filterOptions)) {
-                files.append(entry);
+            foreach(const QFileInfo& entry, dir.entryInfoList(nameFilters, filterOptions)) {
+                if (!isExcluded(entry))
+                    files.append(entry);
             }
         }
         progressDlg.setMaximum(files.count());
-        int i=0;
+        QList<QPair<QString,QByteArray>> filesToSearch;
         foreach (const QFileInfo &info, files) {
-            QString curFilename =  info.absoluteFilePath();
-            i++;
-            progressDlg.setValue(i);
-            progressDlg.setLabelText(tr("Searching...")+"<br/>"+curFilename);
-
-            if (progressDlg.wasCanceled())
-                break;
-            Editor * e = pMainWindow->editorList()->getOpenedEditorByFilename(curFilename);
-            if (e) {
-                fileSearched++;
-                PSearchResultTreeItem parentItem = batchFindInEditor(
-                            e,
-                            e->filename(),
-                            keyword);
-                int t = parentItem->results.size();
-                findCount+=t;
-                if (t>0) {
-                    fileHitted++;
-                    results->results.append(parentItem);
-                }
-            } else if (fileExists(curFilename)) {
-                QSynedit::QSynEdit editor;
-                QByteArray realEncoding;
-                try{
-                    editor.document()->loadFromFile(curFilename,ENCODING_AUTO_DETECT, realEncoding);
-                } catch (QSynedit::BinaryFileError e) {
-                    continue;
-                } catch (FileError e) {
-                    continue;
-                }
-                fileSearched++;
-                PSearchResultTreeItem parentItem = batchFindInEditor(
-                            &editor,
-                            curFilename,
-                            keyword);
-                int t = parentItem->results.size();
-                findCount+=t;
-                if (t>0) {
-                    fileHitted++;
-                    results->results.append(parentItem);
-                }
-            }
+            filesToSearch.append(QPair<QString,QByteArray>(info.absoluteFilePath(), ENCODING_AUTO_DETECT));
         }
+        batchFindInFiles(filesToSearch, keyword, results, progressDlg,
+                         fileSearched, fileHitted, findCount);
         pMainWindow->searchResultModel()->notifySearchResultsUpdated();
     } else if (ui->rbCurrentFile->isChecked()) {
         PSearchResults results = pMainWindow->searchResultModel()->addSearchResults(
@@ -283,54 +280,15 @@ void SearchInFileDialog::doSearch(bool replace)
                     pMainWindow);
 
         progressDlg.setWindowModality(Qt::WindowModal);
-        int i=0;
+        QList<QPair<QString,QByteArray>> filesToSearch;
         foreach (PProjectUnit unit, pMainWindow->project()->unitList()) {
-            i++;
-            progressDlg.setValue(i);
-            progressDlg.setLabelText(tr("Searching...")+"<br/>"+unit->fileName());
-
-            if (progressDlg.wasCanceled())
-                break;
-            Editor * e = pMainWindow->project()->unitEditor(unit);
-            QString curFilename =  unit->fileName();
-            if (e) {
-                fileSearched++;
-                PSearchResultTreeItem parentItem = batchFindInEditor(
-                            e,
-                            e->filename(),
-                            keyword);
-                int t = parentItem->results.size();
-                findCount+=t;
-                if (t>0) {
-                    fileHitted++;
-                    results->results.append(parentItem);
-                }
-            } else if (fileExists(curFilename)) {
-                QSynedit::QSynEdit editor;
-                QByteArray encoding=unit->encoding();
-                if (encoding==ENCODING_PROJECT)
-                    encoding = projectEncoding;
-                QByteArray realEncoding;
-                try {
-                    editor.document()->loadFromFile(curFilename,encoding, realEncoding);
-                } catch (QSynedit::BinaryFileError e) {
-                    continue;
-                } catch (FileError e) {
-                    continue;
-                }
-                fileSearched++;
-                PSearchResultTreeItem parentItem = batchFindInEditor(
-                            &editor,
-                            curFilename,
-                            keyword);
-                int t = parentItem->results.size();
-                findCount+=t;
-                if (t>0) {
-                    fileHitted++;
-                    results->results.append(parentItem);
-                }
-            }
+            QByteArray encoding=unit->encoding();
+            if (encoding==ENCODING_PROJECT)
+                encoding = projectEncoding;
+            filesToSearch.append(QPair<QString,QByteArray>(unit->fileName(), encoding));
         }
+        batchFindInFiles(filesToSearch, keyword, results, progressDlg,
+                         fileSearched, fileHitted, findCount);
         pMainWindow->searchResultModel()->notifySearchResultsUpdated();
     }
     pMainWindow->showSearchPanel(replace);
@@ -365,6 +323,183 @@ int SearchInFileDialog::execute(QSynedit::QSynEdit *editor, const QString &sSear
                           searchEngine, matchCallback, confirmAroundCallback);
 }
 
+namespace {
+struct SearchingFile {
+    QString fileName;
+    QByteArray encoding;
+    Editor* editor;
+    PSearchResultTreeItem result;
+    QSemaphore searched;
+};
+}
+
+static QTextCodec* codecForContent(const QByteArray& content, const QByteArray& encoding, const QByteArray& systemEncoding)
+{
+    QByteArray realEncoding = encoding;
+    if (encoding == ENCODING_AUTO_DETECT) {
+        //BOM
+        QTextCodec* codec = QTextCodec::codecForUtfText(content, nullptr);
+        if (codec)
+            return codec;
+        realEncoding = guessTextEncoding(content);
+    }
+    if (realEncoding == ENCODING_ASCII || realEncoding == ENCODING_UTF8_BOM)
+        realEncoding = ENCODING_UTF8;
+    else if (realEncoding == ENCODING_UTF16_BOM)
+        realEncoding = ENCODING_UTF16;
+    else if (realEncoding == ENCODING_UTF32_BOM)
+        realEncoding = ENCODING_UTF32;
+    else if (realEncoding == ENCODING_SYSTEM_DEFAULT)
+        realEncoding = systemEncoding;
+    return QTextCodec::codecForName(realEncoding);
+}
+
+/**
+ * @brief search a file on disk without loading it into an editor
+ *
+ * It's run in the thread pool, so it must not touch any widget.
+ * @return nullptr if the file can't be read or is binary
+ */
+static PSearchResultTreeItem findInFile(const QString& fileName, const QByteArray& encoding,
+                                        const QByteArray& systemEncoding,
+                                        const QString& keyword, QSynedit::SearchOptions options)
+{
+    QFile file(fileName);
+    if (!file.open(QFile::ReadOnly))
+        return PSearchResultTreeItem();
+    qint64 size = file.size();
+    uchar* mapped = size>0?file.map(0, size):nullptr;
+    QByteArray content;
+    if (mapped)
+        content = QByteArray::fromRawData((const char*)mapped, size);
+    else
+        content = file.readAll();
+    auto action = finally([&file,mapped]{
+        if (mapped)
+            file.unmap(mapped);
+    });
+    QTextCodec* codec = codecForContent(content, encoding, systemEncoding);
+    if (!codec)
+        return PSearchResultTreeItem();
+    //utf-16/32 files contain zeros
+    if (!codec->name().startsWith("UTF-16")
+            && !codec->name().startsWith("UTF-32")
+            && isBinaryContent(content))
+        return PSearchResultTreeItem();
+    QString text = codec->toUnicode(content);
+
+    std::shared_ptr<QSynedit::BaseSearcher> searcher;
+    if (options.testFlag(QSynedit::ssoRegExp))
+        searcher = std::make_shared<QSynedit::RegexSearcher>();
+    else
+        searcher = std::make_shared<QSynedit::BasicSearcher>();
+    searcher->setOptions(options);
+    searcher->setPattern(keyword);
+
+    PSearchResultTreeItem parentItem = std::make_shared<SearchResultTreeItem>();
+    parentItem->filename = fileName;
+    parentItem->parent = nullptr;
+    int lineStart = 0;
+    int lineNo = 1;
+    while (lineStart <= text.length()) {
+        int lineEnd = text.indexOf('\n', lineStart);
+        int nextLineStart;
+        if (lineEnd<0) {
+            lineEnd = text.length();
+            nextLineStart = lineEnd + 1;
+        } else {
+            nextLineStart = lineEnd + 1;
+        }
+        if (lineEnd>lineStart && text[lineEnd-1]=='\r')
+            lineEnd--;
+        QString line = text.mid(lineStart, lineEnd-lineStart);
+        int count = searcher->findAll(line);
+        for (int i=0;i<count;i++) {
+            PSearchResultTreeItem item = std::make_shared<SearchResultTreeItem>();
+            item->filename = fileName;
+            item->line = lineNo;
+            item->start = searcher->result(i) + 1;
+            item->len = searcher->length(i);
+            item->parent = parentItem.get();
+            item->text = line;
+            item->text.replace('\t',' ');
+            parentItem->results.append(item);
+        }
+        lineStart = nextLineStart;
+        lineNo++;
+    }
+    return parentItem;
+}
+
+void SearchInFileDialog::batchFindInFiles(const QList<QPair<QString, QByteArray> > &files, const QString &keyword, PSearchResults results, QProgressDialog &progressDlg, int &fileSearched, int &fileHitted, int &findCount)
+{
+    // Files not opened in editors are searched in the thread pool, a few files ahead.
+    // Results are collected in order, and shown in the search panel while searching.
+    QThreadPool *pool = QThreadPool::globalInstance();
+    int maxPending = std::max(2, pool->maxThreadCount() * 2);
+    std::shared_ptr<QAtomicInt> canceled = std::make_shared<QAtomicInt>(0);
+    QByteArray systemEncoding = pCharsetInfoManager->getDefaultSystemEncoding();
+    QSynedit::SearchOptions options = mSearchOptions;
+    QQueue<std::shared_ptr<SearchingFile>> pendingFiles;
+    QElapsedTimer updateTimer;
+    updateTimer.start();
+    int next = 0;
+    int i = 0;
+    while (next < files.count() || !pendingFiles.isEmpty()) {
+        while (next < files.count() && pendingFiles.count() < maxPending) {
+            std::shared_ptr<SearchingFile> pendingFile = std::make_shared<SearchingFile>();
+            pendingFile->fileName = files[next].first;
+            pendingFile->encoding = files[next].second;
+            next++;
+            pendingFiles.enqueue(pendingFile);
+            // opened files must be searched in the editor (it may be not saved)
+            pendingFile->editor = pMainWindow->editorList()->getOpenedEditorByFilename(pendingFile->fileName);
+            if (pendingFile->editor) {
+                pendingFile->searched.release();
+                continue;
+            }
+            pool->start([pendingFile, systemEncoding, keyword, options, canceled]{
+                if (!canceled->loadAcquire())
+                    pendingFile->result = findInFile(pendingFile->fileName, pendingFile->encoding,
+                                                     systemEncoding, keyword, options);
+                pendingFile->searched.release();
+            });
+        }
+        std::shared_ptr<SearchingFile> pendingFile = pendingFiles.dequeue();
+        i++;
+        progressDlg.setValue(i);
+        progressDlg.setLabelText(tr("Searching...")+"<br/>"+pendingFile->fileName);
+        while (!pendingFile->searched.tryAcquire(1, 50) && !progressDlg.wasCanceled())
+            QCoreApplication::processEvents();
+        if (progressDlg.wasCanceled()) {
+            canceled->storeRelease(1);
+            break;
+        }
+        PSearchResultTreeItem parentItem;
+        if (pendingFile->editor) {
+            parentItem = batchFindInEditor(
+                        pendingFile->editor,
+                        pendingFile->editor->filename(),
+                        keyword);
+        } else {
+            parentItem = pendingFile->result;
+        }
+        if (!parentItem)
+            continue;
+        fileSearched++;
+        int t = parentItem->results.size();
+        findCount+=t;
+        if (t>0) {
+            fileHitted++;
+            results->results.append(parentItem);
+            if (updateTimer.elapsed()>200) {
+                pMainWindow->searchResultModel()->notifySearchResultsUpdated();
+                updateTimer.restart();
+            }
+        }
+    }
+}
+
 std::shared_ptr<SearchResultTreeItem> SearchInFileDialog::batchFindInEditor(QSynedit::QSynEdit *e, const QString& filename,const QString &keyword)
 {
     //backup
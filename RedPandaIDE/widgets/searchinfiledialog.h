@@ -26,6 +26,8 @@ class SearchInFileDialog;
 }
 
 struct SearchResultTreeItem;
+struct SearchResults;
+class QProgressDialog;
 class QTabBar;
 class Editor;
 class SearchInFileDialog : public QDialog
@@ -58,6 +60,18 @@ private:
                QSynedit::SearchMathedProc matchCallback = nullptr,
                QSynedit::SearchConfirmAroundProc confirmAroundCallback = nullptr);
    std::shared_ptr<SearchResultTreeItem> batchFindInEditor(QSynedit::QSynEdit * editor,const QString& filename, const QString& keyword);
+   /**
+    * @brief search the files, and append found results to results
+    *
+    * Files opened in editors are searched in the editor, others are read and
+    * searched in the thread pool.
+    * @param files file names and their encodings
+    */
+   void batchFindInFiles(const QList<QPair<QString,QByteArray>>& files,
+                         const QString& keyword,
+                         std::shared_ptr<SearchResults> results,
+                         QProgressDialog& progressDlg,
+                         int& fileSearched, int& fileHitted, int& findCount);
 private:
     Ui::SearchInFileDialog *ui;
     QSynedit::SearchOptions mSearchOptions;
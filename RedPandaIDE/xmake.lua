@@ -42,7 +42,9 @@ target("RedPandaIDE")
         "utils.cpp",
         "visithistorymanager.cpp",
         -- compiler
+        "compiler/compilecache.cpp",
         "compiler/compilerinfo.cpp",
+        "compiler/processoutputcapture.cpp",
         -- debugger
         "debugger/dapprotocol.cpp",
         "debugger/gdbmiresultparser.cpp",
@@ -50,6 +52,7 @@ target("RedPandaIDE")
         "parser/cpppreprocessor.cpp",
         "parser/cpptokenizer.cpp",
         "parser/parserutils.cpp",
+        "parser/symbolcache.cpp",
         -- problems
         "problems/freeprojectsetformat.cpp",
         "problems/ojproblemset.cpp",
@@ -187,6 +190,10 @@ target("RedPandaIDE")
         "resources/fonts/asciicontrol.ttf",
         {rule = "RedPandaIDE.auto_qrc"})
 
+    if is_os("linux") then
+        add_files("compiler/caseprocess.cpp")
+    end
+
     if is_os("windows") then
         add_ui_classes(
             "settingsdialog/environmentfileassociationwidget",
@@ -248,3 +255,65 @@ target("test-escape")
 
     add_files("utils/escape.cpp", "test/escape.cpp")
     add_includedirs(".")
+
+target("test-case-process")
+    set_kind("binary")
+    add_rules("qt.console")
+    add_deps("consolepauser")
+
+    set_default(false)
+    set_enabled(is_os("linux"))
+    add_tests("test-case-process")
+
+    add_files("compiler/caseprocess.cpp", "test/caseprocess.cpp")
+    add_includedirs(".")
+
+target("test-qsynedit-folding")
+    set_kind("binary")
+    add_rules("qt.console")
+    add_frameworks("QtGui", "QtWidgets")
+    add_deps("redpanda_qt_utils", "qsynedit")
+
+    set_default(false)
+    add_tests("test-qsynedit-folding")
+
+    add_files("test/qsyneditfolding.cpp")
+
+target("bench-tokenizer")
+    set_kind("binary")
+    add_rules("qt.console")
+    add_deps("redpanda_qt_utils")
+
+    set_default(false)
+
+    add_files("parser/cpptokenizer.cpp", "parser/parserutils.cpp", "test/tokenizerbench.cpp")
+    add_includedirs(".")
+
+target("bench-parser")
+    set_kind("binary")
+    add_rules("qt.console")
+    add_frameworks("QtGui", "QtWidgets")
+    add_deps("redpanda_qt_utils", "qsynedit")
+
+    set_default(false)
+
+    add_files(
+        "parser/cpppreprocessor.cpp",
+        "parser/cpptokenizer.cpp",
+        "parser/parserutils.cpp",
+        "parser/symbolcache.cpp",
+        "test/parserbench.cpp")
+    add_moc_classes(
+        "parser/cppparser",
+        "parser/statementmodel")
+    add_includedirs(".")
+
+target("bench-qsynedit")
+    set_kind("binary")
+    add_rules("qt.console")
+    add_frameworks("QtGui", "QtWidgets")
+    add_deps("redpanda_qt_utils", "qsynedit")
+
+    set_default(false)
+
+    add_files("test/qsyneditbench.cpp")
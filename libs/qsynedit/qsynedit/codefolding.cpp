@@ -16,6 +16,7 @@
  */
 #include "codefolding.h"
 #include "constants.h"
+#include <algorithm>
 
 
 namespace QSynedit {
@@ -49,6 +50,8 @@ void CodeFoldingRange::move(int count)
 {
     fromLine += count;
     toLine += count;
+    if (closeLine>=0)
+        closeLine += count;
 }
 
 CodeFoldingRange::CodeFoldingRange(PCodeFoldingRange parent,
@@ -56,6 +59,7 @@ CodeFoldingRange::CodeFoldingRange(PCodeFoldingRange parent,
                                    int toLine):
     fromLine(fromLine),
     toLine(toLine),
+    closeLine(-1),
     linesCollapsed(0),
     collapsed(false),
     parent(parent)
@@ -112,6 +116,43 @@ void CodeFoldingRanges::add(PCodeFoldingRange foldRange)
     mRanges.push_back(foldRange);
 }
 
+void CodeFoldingRanges::replace(int index, int count, const QVector<PCodeFoldingRange> &ranges)
+{
+    int common = std::min(count, ranges.count());
+    for (int i=0;i<common;i++)
+        mRanges[index+i] = ranges[i];
+    if (count > common)
+        mRanges.remove(index+common, count-common);
+    else if (ranges.count() > common) {
+        mRanges.insert(index+common, ranges.count()-common, PCodeFoldingRange());
+        for (int i=common;i<ranges.count();i++)
+            mRanges[index+i] = ranges[i];
+    }
+}
+
+int CodeFoldingRanges::indexOf(const PCodeFoldingRange &range) const
+{
+    auto it = std::lower_bound(mRanges.constBegin(), mRanges.constEnd(), range->fromLine,
+                               [](const PCodeFoldingRange& r, int line) {
+        return r->fromLine < line;
+    });
+    //nested ranges may start at the same line
+    for (;it!=mRanges.constEnd() && (*it)->fromLine == range->fromLine;++it) {
+        if (*it == range)
+            return it - mRanges.constBegin();
+    }
+    return -1;
+}
+
+int CodeFoldingRanges::upperBound(int fromLine) const
+{
+    auto it = std::upper_bound(mRanges.constBegin(), mRanges.constEnd(), fromLine,
+                               [](int line, const PCodeFoldingRange& r) {
+        return line < r->fromLine;
+    });
+    return it - mRanges.constBegin();
+}
+
 PCodeFoldingRange CodeFoldingRanges::operator[](int index) const
 {
     return mRanges[index];
@@ -122,4 +163,58 @@ const QVector<PCodeFoldingRange> &CodeFoldingRanges::ranges() const
     return mRanges;
 }
 
+CollapsedFoldIndex::CollapsedFoldIndex():
+    mValid{false}
+{
+
+}
+
+void CollapsedFoldIndex::rebuild(const PCodeFoldingRanges &allFoldRanges)
+{
+    mFolds.clear();
+    int linesCollapsed = 0;
+    //all fold ranges are sorted by fromLine
+    foreach (const PCodeFoldingRange& range, allFoldRanges->ranges()) {
+        if (range->collapsed && !range->parentCollapsed()) {
+            CollapsedFold fold;
+            fold.fromLine = range->fromLine;
+            fold.toLine = range->toLine;
+            fold.linesCollapsed = range->linesCollapsed;
+            fold.startRow = range->fromLine - linesCollapsed;
+            fold.linesCollapsedBefore = linesCollapsed;
+            mFolds.append(fold);
+            linesCollapsed += range->linesCollapsed;
+        }
+    }
+    mValid = true;
+}
+
+int CollapsedFoldIndex::rowToLine(int row) const
+{
+    //find the first fold that starts at or after the row
+    auto it = std::lower_bound(mFolds.begin(),mFolds.end(),row,
+                               [](const CollapsedFold& fold, int row) {
+        return fold.startRow < row;
+    });
+    if (it == mFolds.begin())
+        return row;
+    --it;
+    return row + it->linesCollapsedBefore + it->linesCollapsed;
+}
+
+int CollapsedFoldIndex::lineToRow(int line) const
+{
+    //find the first fold that starts at or after the line
+    auto it = std::lower_bound(mFolds.begin(),mFolds.end(),line,
+                               [](const CollapsedFold& fold, int line) {
+        return fold.fromLine < line;
+    });
+    if (it == mFolds.begin())
+        return line;
+    --it;
+    if (line <= it->toLine) // inside fold
+        return it->startRow;
+    return line - it->linesCollapsedBefore - it->linesCollapsed;
+}
+
 }
@@ -52,7 +52,13 @@ public:
 
     void insert(int index, PCodeFoldingRange range);
     void remove(int index);
+    // replace count ranges from index with the given ranges
+    void replace(int index, int count, const QVector<PCodeFoldingRange>& ranges);
     void add(PCodeFoldingRange foldRange);
+    // the ranges must be sorted by fromLine
+    int indexOf(const PCodeFoldingRange& range) const;
+    // index of the first range whose fromLine is greater than the line
+    int upperBound(int fromLine) const;
     PCodeFoldingRange operator[](int index) const;
     const QVector<PCodeFoldingRange> &ranges() const;
 
@@ -68,6 +74,7 @@ public:
     CodeFoldingRange& operator=(const CodeFoldingRange&)=delete;
     int fromLine; // Beginning line
     int toLine; // End line
+    int closeLine; // Index of the line that closes the fold, -1 if not closed
     int linesCollapsed; // Number of collapsed lines
     PCodeFoldingRanges subFoldRanges; // Sub fold ranges
     bool collapsed; // Is collapsed?
@@ -76,5 +83,35 @@ public:
     void move(int count);
 };
 
+/**
+ * @brief index of the visible collapsed folds, used to map between rows and lines
+ *
+ * Visible collapsed folds (collapsed folds whose parents are not collapsed)
+ * don't overlap, so they are kept sorted with the prefix sums of the collapsed lines,
+ * and rows/lines are mapped by binary search.
+ *
+ * The index must be invalidated when folds are collapsed, uncollapsed, moved
+ * or rescanned. It's rebuilt when used next time.
+ */
+class CollapsedFoldIndex {
+public:
+    explicit CollapsedFoldIndex();
+    void invalidate() { mValid = false; }
+    bool valid() const { return mValid; }
+    void rebuild(const PCodeFoldingRanges& allFoldRanges);
+    int rowToLine(int row) const;
+    int lineToRow(int line) const;
+private:
+    struct CollapsedFold {
+        int fromLine;
+        int toLine;
+        int linesCollapsed;
+        int startRow; // row of the fold's start line
+        int linesCollapsedBefore; // total collapsed lines of the folds before this one
+    };
+    QVector<CollapsedFold> mFolds;
+    bool mValid;
+};
+
 }
 #endif // CODEFOLDING_H
@@ -24,9 +24,12 @@
 #include <stdexcept>
 #include <QMessageBox>
 #include <cmath>
+#include <cstring>
 #include "qt_utils/charsetinfo.h"
 #include <QDateTime>
 #include <QDebug>
+#include <QElapsedTimer>
+#include <QTimer>
 
 namespace QSynedit {
 
@@ -39,13 +42,17 @@ Document::Document(const QFont& font, QObject *parent):
 {
     mAppendNewLineAtEOF = true;
     mNewlineType = NewlineType::Windows;
-    mIndexOfLongestLine = -1;
+    mMeasureFrom = -1;
+    mMeasureTimer = new QTimer(this);
+    mMeasureTimer->setSingleShot(true);
+    connect(mMeasureTimer, &QTimer::timeout, this, &Document::measureLinesWidth);
     mUpdateCount = 0;
     mUpdateDocumentLineWidthFunc = std::bind(&GlyphCalculator::calcLineWidth,
         &mGlyphCalculator,
         std::placeholders::_1,
         std::placeholders::_2,
         std::placeholders::_3);
+    resetSyntaxStates();
 }
 
 static void listIndexOutOfBounds(int index) {
@@ -58,7 +65,7 @@ int Document::parenthesisLevel(int line) const
 {
     QMutexLocker locker(&mMutex);
     if (line>=0 && line < mLines.size()) {
-        return mLines[line]->syntaxState().parenthesisLevel;
+        return mSyntaxStates[mLines[line]->syntaxStateId()].parenthesisLevel;
     } else
         return 0;
 }
@@ -67,7 +74,7 @@ int Document::bracketLevel(int line) const
 {
     QMutexLocker locker(&mMutex);
     if (line>=0 && line < mLines.size()) {
-        return mLines[line]->syntaxState().bracketLevel;
+        return mSyntaxStates[mLines[line]->syntaxStateId()].bracketLevel;
     } else
         return 0;
 }
@@ -76,7 +83,7 @@ int Document::braceLevel(int line) const
 {
     QMutexLocker locker(&mMutex);
     if (line>=0 && line < mLines.size()) {
-        return mLines[line]->syntaxState().braceLevel;
+        return mSyntaxStates[mLines[line]->syntaxStateId()].braceLevel;
     } else
         return 0;
 }
@@ -109,7 +116,7 @@ int Document::blockLevel(int line) const
 {
     QMutexLocker locker(&mMutex);
     if (line>=0 && line < mLines.size()) {
-        return mLines[line]->syntaxState().blockLevel;
+        return mSyntaxStates[mLines[line]->syntaxStateId()].blockLevel;
     } else
         return 0;
 }
@@ -118,7 +125,7 @@ int Document::blockStarted(int line) const
 {
     QMutexLocker locker(&mMutex);
     if (line>=0 && line < mLines.size()) {
-        return mLines[line]->syntaxState().blockStarted;
+        return mSyntaxStates[mLines[line]->syntaxStateId()].blockStarted;
     } else
         return 0;
 }
@@ -127,7 +134,7 @@ int Document::blockEnded(int line) const
 {
     QMutexLocker locker(&mMutex);
     if (line>=0 && line < mLines.size()) {
-        int result = mLines[line]->syntaxState().blockEnded;
+        int result = mSyntaxStates[mLines[line]->syntaxStateId()].blockEnded;
 //        if (index+1 < mLines.size())
 //            result += mLines[index+1]->syntaxState.blockEndedLastLine;
         return result;
@@ -137,12 +144,9 @@ int Document::blockEnded(int line) const
 
 int Document::maxLineWidth() const {
     QMutexLocker locker(&mMutex);
-    if (mIndexOfLongestLine >= 0) {
-        return mLines[mIndexOfLongestLine]->width();
-    } else if (mLines.isEmpty()) {
+    if (mLines.isEmpty())
         return 0;
-    } else
-        return -1;
+    return countedMaxLineWidth();
 }
 
 QString Document::lineBreak() const
@@ -162,7 +166,7 @@ SyntaxState Document::getSyntaxState(int line) const
 {
     QMutexLocker locker(&mMutex);
     if (line>=0 && line < mLines.size()) {
-        return mLines[line]->syntaxState();
+        return mSyntaxStates[mLines[line]->syntaxStateId()];
     } else {
          listIndexOutOfBounds(line);
     }
@@ -176,7 +180,9 @@ void Document::insertItem(int line, const QString &s)
                 mUpdateDocumentLineWidthFunc);
     documentLine->setLineText(s);
     mLines.insert(line,documentLine);
-    mIndexOfLongestLine = -1;
+    if (mMeasureFrom>=line)
+        mMeasureFrom++;
+    measureLineWidth(documentLine);
     endUpdate();
 }
 
@@ -186,6 +192,7 @@ void Document::addItem(const QString &s)
     PDocumentLine line = std::make_shared<DocumentLine>(mUpdateDocumentLineWidthFunc);
     line->setLineText(s);
     mLines.append(line);
+    scheduleMeasureLinesWidth(mLines.count()-1);
     endUpdate();
 }
 
@@ -201,13 +208,69 @@ void Document::setAppendNewLineAtEOF(bool appendNewLineAtEOF)
     mAppendNewLineAtEOF = appendNewLineAtEOF;
 }
 
-void Document::setSyntaxState(int line, const SyntaxState& state)
+int Document::syntaxStateId(int line) const
 {
     QMutexLocker locker(&mMutex);
     if (line<0 || line>=mLines.count()) {
         listIndexOutOfBounds(line);
     }
-    mLines[line]->setSyntaxState(state);
+    return mLines[line]->syntaxStateId();
+}
+
+bool Document::setSyntaxState(int line, const SyntaxState& state)
+{
+    QMutexLocker locker(&mMutex);
+    if (line<0 || line>=mLines.count()) {
+        listIndexOutOfBounds(line);
+    }
+    int id = internSyntaxState(state);
+    if (mLines[line]->syntaxStateId() == id)
+        return false;
+    mLines[line]->setSyntaxStateId(id);
+    return true;
+}
+
+int Document::internSyntaxState(const SyntaxState &state)
+{
+    auto it = mSyntaxStateIds.constFind(state);
+    if (it!=mSyntaxStateIds.constEnd())
+        return it.value();
+    //drop states that are not used by any line anymore
+    if (mSyntaxStates.count() >= std::max(1024, mLines.count()*2))
+        compactSyntaxStates();
+    int id = mSyntaxStates.count();
+    mSyntaxStates.append(state);
+    mSyntaxStateIds.insert(state,id);
+    return id;
+}
+
+void Document::compactSyntaxStates()
+{
+    QVector<int> newIds(mSyntaxStates.count(),-1);
+    QVector<SyntaxState> states;
+    states.append(mSyntaxStates[0]);
+    newIds[0]=0;
+    foreach (const PDocumentLine& line, mLines) {
+        int id = line->syntaxStateId();
+        if (newIds[id]<0) {
+            newIds[id] = states.count();
+            states.append(mSyntaxStates[id]);
+        }
+        line->setSyntaxStateId(newIds[id]);
+    }
+    mSyntaxStates = states;
+    mSyntaxStateIds.clear();
+    mSyntaxStateIds.reserve(mSyntaxStates.count());
+    for (int i=0;i<mSyntaxStates.count();i++)
+        mSyntaxStateIds.insert(mSyntaxStates[i],i);
+}
+
+void Document::resetSyntaxStates()
+{
+    mSyntaxStates.clear();
+    mSyntaxStateIds.clear();
+    mSyntaxStates.append(SyntaxState());
+    mSyntaxStateIds.insert(mSyntaxStates[0],0);
 }
 
 QString Document::getLine(int line) const
@@ -269,7 +332,6 @@ void Document::setContents(const QStringList &text)
         foreach (const QString& s,text) {
             addItem(s);
         }
-        mIndexOfLongestLine = -1;
         emit inserted(FirstAdded,text.count());
     }
 }
@@ -327,7 +389,6 @@ void Document::addLines(const QStringList &strings)
         for (const QString& s:strings) {
             addItem(s);
         }
-        mIndexOfLongestLine = -1;
         emit inserted(FirstAdded,strings.count());
     }
 }
@@ -365,18 +426,18 @@ void Document::deleteLines(int index, int numLines)
     auto action = finally([this]{
         endUpdate();
     });
-    if (mIndexOfLongestLine>=index) {
-        if (mIndexOfLongestLine <index+numLines) {
-            mIndexOfLongestLine = -1;
-        } else {
-            mIndexOfLongestLine -= numLines;
-        }
-    }
     int LinesAfter = mLines.count() - (index + numLines);
     if (LinesAfter < 0) {
        numLines = mLines.count() - index;
     }
+    int oldMaxWidth = countedMaxLineWidth();
+    for (int i=index;i<index+numLines;i++)
+        removeLineWidthCount(mLines[i]);
+    if (mMeasureFrom>index)
+        mMeasureFrom = std::max(index, mMeasureFrom-numLines);
     mLines.remove(index,numLines);
+    if (countedMaxLineWidth()!=oldMaxWidth)
+        updateMaxLineWidthChanged();
     emit deleted(index,numLines);
 }
 
@@ -394,11 +455,6 @@ void Document::exchange(int index1, int index2)
     mLines[index1]=mLines[index2];
     mLines[index2]=temp;
     //mList.swapItemsAt(Index1,Index2);
-    if (mIndexOfLongestLine == index1) {
-        mIndexOfLongestLine = index2;
-    } else if (mIndexOfLongestLine == index2) {
-        mIndexOfLongestLine = index1;
-    }
     endUpdate();
 }
 
@@ -421,11 +477,13 @@ void Document::deleteAt(int index)
         listIndexOutOfBounds(index);
     }
     beginUpdate();
-    if (mIndexOfLongestLine == index)
-        mIndexOfLongestLine = -1;
-    else if (mIndexOfLongestLine>index)
-        mIndexOfLongestLine -= 1;
+    int oldMaxWidth = countedMaxLineWidth();
+    removeLineWidthCount(mLines[index]);
+    if (mMeasureFrom>index)
+        mMeasureFrom--;
     mLines.removeAt(index);
+    if (countedMaxLineWidth()!=oldMaxWidth)
+        updateMaxLineWidthChanged();
     emit deleted(index,1);
     endUpdate();
 }
@@ -454,10 +512,7 @@ void Document::putLine(int index, const QString &s, bool notify) {
         }
         beginUpdate();
         mLines[index]->setLineText(s);
-        if (mIndexOfLongestLine == index) {
-            // width is invalidated, so we must recalculate longest line
-            mIndexOfLongestLine = -1;
-        }
+        measureLineWidth(mLines[index]);
         if (notify)
             emit putted(index);
         endUpdate();
@@ -489,8 +544,10 @@ void Document::insertLines(int index, int numLines)
     for (int i=index;i<index+numLines;i++) {
         line = std::make_shared<DocumentLine>(mUpdateDocumentLineWidthFunc);
         mLines[i]=line;
+        measureLineWidth(line);
     }
-    mIndexOfLongestLine = -1;
+    if (mMeasureFrom>=index)
+        mMeasureFrom+=numLines;
     emit inserted(index,numLines);
 }
 
@@ -638,33 +695,59 @@ void Document::loadFromFile(const QString& filename, const QByteArray& encoding,
         }
 
         internalClear();
-        while (true) {
-            if (line.endsWith("\r\n")) {
-                line.remove(line.length()-2,2);
-            } else if (line.endsWith("\r")) {
-                line.remove(line.length()-1,1);
-            } else if (line.endsWith("\n")){
-                line.remove(line.length()-1,1);
-            }
+        // returns false if the line can't be decoded by the codec
+        auto addLine = [&](const char* text, int len) {
+            if (len>0 && text[len-1]=='\n')
+                len--;
+            if (len>0 && text[len-1]=='\r')
+                len--;
+            QByteArray line = QByteArray::fromRawData(text, len);
             if (isBinaryContent(line))
                 throw BinaryFileError(tr("'%1' is a binaray File!").arg(filename));
             if (allAscii) {
                 allAscii = isTextAllAscii(line);
             }
             if (allAscii) {
-                addItem(QString::fromLatin1(line));
+                addItem(QString::fromLatin1(text, len));
             } else {
-                QString newLine = codec->toUnicode(line.constData(),line.length(),&state);
-                if (state.invalidChars>0) {
+                QString newLine = codec->toUnicode(text, len, &state);
+                if (state.invalidChars>0)
+                    return false;
+                addItem(newLine);
+            }
+            return true;
+        };
+        needReread = !addLine(line.constData(), line.length());
+        if (!needReread && !file.atEnd()) {
+            // Split the rest of the file in memory instead of reading it line by line,
+            // it's much faster for large files.
+            qint64 startPos = file.pos();
+            qint64 fileSize = file.size();
+            uchar* mapped = file.map(0, fileSize);
+            QByteArray content;
+            const char* start;
+            const char* end;
+            if (mapped) {
+                start = (const char*)mapped + startPos;
+                end = (const char*)mapped + fileSize;
+            } else {
+                content = file.readAll();
+                start = content.constData();
+                end = start + content.length();
+            }
+            auto unmapAction = finally([&file,mapped]{
+                if (mapped)
+                    file.unmap(mapped);
+            });
+            while (start<end) {
+                const char* lineEnd = (const char*)memchr(start, '\n', end-start);
+                lineEnd = lineEnd?lineEnd+1:end;
+                if (!addLine(start, lineEnd-start)) {
                     needReread = true;
                     break;
                 }
-                addItem(newLine);
+                start = lineEnd;
             }
-            if (file.atEnd()){
-                break;
-            }
-            line = file.readLine();
         }
         if (!needReread) {
             if (allAscii)
@@ -824,9 +907,27 @@ int Document::charToGlyphStartChar(int line, int charPos) const
 //     return mLines[line]->glyphStartColumn(glyphIdx);
 // }
 
+// OR all code units together, so the compiler can vectorize the loop
+static bool isAsciiText(const QString &text)
+{
+    const ushort* p = text.utf16();
+    int len = text.length();
+    ushort bits = 0;
+    for (int i=0;i<len;i++)
+        bits |= p[i];
+    return bits < 0x80;
+}
+
 QList<int> calcGlyphStartCharList(const QString &text)
 {
     QList<int> glyphStartCharList;
+    if (isAsciiText(text)) {
+        //each ascii char is a glyph
+        glyphStartCharList.reserve(text.length());
+        for (int i=0;i<text.length();i++)
+            glyphStartCharList.append(i);
+        return glyphStartCharList;
+    }
     //parse mGlyphs
     int i=0;
     bool consecutive = false;
@@ -959,6 +1060,21 @@ QList<int> GlyphCalculator::calcGlyphPositionList(const QString &lineText, const
     right = std::max(0,left);
     int start,end;
     QList<int> glyphPostionList;
+    if (&fontMetrics == &mFontMetrics
+            && glyphStartCharList.length() == lineText.length()
+            && isAsciiText(lineText)) {
+        //each char is a glyph, and we know their widths
+        const ushort* p = lineText.utf16();
+        glyphPostionList.reserve(lineText.length());
+        for (int i=0;i<lineText.length();i++) {
+            glyphPostionList.append(right);
+            if (p[i] == '\t')
+                right += glyphWidth("\t", right, fontMetrics, mForceMonospace);
+            else
+                right += mAsciiCharWidths[p[i]];
+        }
+        return glyphPostionList;
+    }
     for (int i=0;i<glyphStartCharList.length();i++) {
         start = glyphStartCharList[i];
         if (i+1<glyphStartCharList.length()) {
@@ -1119,7 +1235,10 @@ void Document::internalClear()
         beginUpdate();
         int oldCount = mLines.count();
         mLines.clear();
-        mIndexOfLongestLine = -1;
+        resetSyntaxStates();
+        mLineWidthCounts.clear();
+        mMeasureFrom = -1;
+        mMeasureTimer->stop();
         emit deleted(0,oldCount);
         endUpdate();
     }
@@ -1144,8 +1263,8 @@ void Document::endSetLinesWidth()
 {
     mSetLineWidthLockCount--;
     if (mSetLineWidthLockCount == 0) {
-        if (mMaxLineChangedInSetLinesWidth)
-            updateMaxLineWidthAndNotify();
+        if (mMaxLineChangedInSetLinesWidth && countedMaxLineWidth()>=0)
+            emit maxLineWidthChanged();
     }
 }
 
@@ -1154,26 +1273,15 @@ void Document::setLineWidth(int line, int newWidth, const QList<int> glyphStartP
     QMutexLocker locker(&mMutex);
     if (line<0 || line>=count())
         return ;
-    int oldWidth = mLines[line]->mWidth;
-    // qDebug()<<line<<oldWidth<<newWidth;
+    // qDebug()<<line<<mLines[line]->mWidth<<newWidth;
+    int oldMaxWidth = countedMaxLineWidth();
     mLines[line]->mWidth = newWidth;
     mLines[line]->mIsTempWidth = false;
     mLines[line]->mGlyphStartPositionList = glyphStartPositionList;
-    if (mIndexOfLongestLine<0) {
-        mIndexOfLongestLine = line;
-        updateMaxLineWidthChanged();
-    } else if (mIndexOfLongestLine == line) {
-        if (oldWidth > newWidth) {
-            mIndexOfLongestLine = -1;
-            updateMaxLineWidthChanged();
-        } else if (oldWidth < newWidth) {
-            updateMaxLineWidthChanged();
-        }
-    } else if (mLines[mIndexOfLongestLine]->mWidth < newWidth) {
-        mIndexOfLongestLine = line;
+    updateLineWidthCount(mLines[line]);
+    if (countedMaxLineWidth()!=oldMaxWidth)
         updateMaxLineWidthChanged();
-    }
-    Q_ASSERT(mLines[line]->mGlyphStartPositionList.length() == mLines[line]->mGlyphStartCharList.length());
+    Q_ASSERT(mLines[line]->mGlyphStartPositionList.length() == mLines[line]->glyphsCount());
 }
 
 void Document::updateMaxLineWidthChanged()
@@ -1186,21 +1294,77 @@ void Document::updateMaxLineWidthChanged()
     }
 }
 
-void Document::updateMaxLineWidthAndNotify()
+int Document::countedMaxLineWidth() const
 {
-    int MaxLen = -1;
-    mIndexOfLongestLine = -1;
-    if (mLines.count() > 0 ) {
-        for (int i=0;i<mLines.size();i++) {
-            int len = mLines[i]->mWidth;
-            if (len > MaxLen) {
-                MaxLen = len;
-                mIndexOfLongestLine = i;
-            }
-        }
+    if (mLineWidthCounts.isEmpty())
+        return -1;
+    return mLineWidthCounts.lastKey();
+}
+
+void Document::updateLineWidthCount(const PDocumentLine &line)
+{
+    if (line->mCountedWidth == line->mWidth)
+        return;
+    removeLineWidthCount(line);
+    if (line->mWidth>=0) {
+        mLineWidthCounts[line->mWidth]++;
+        line->mCountedWidth = line->mWidth;
     }
-    if (mIndexOfLongestLine>=0)
-        emit maxLineWidthChanged();
+}
+
+void Document::removeLineWidthCount(const PDocumentLine &line)
+{
+    if (line->mCountedWidth<0)
+        return;
+    auto it = mLineWidthCounts.find(line->mCountedWidth);
+    if (it!=mLineWidthCounts.end()) {
+        it.value()--;
+        if (it.value()<=0)
+            mLineWidthCounts.erase(it);
+    }
+    line->mCountedWidth = -1;
+}
+
+void Document::measureLineWidth(const PDocumentLine &line)
+{
+    int oldMaxWidth = countedMaxLineWidth();
+    line->width();
+    updateLineWidthCount(line);
+    if (countedMaxLineWidth()!=oldMaxWidth)
+        updateMaxLineWidthChanged();
+}
+
+void Document::scheduleMeasureLinesWidth(int fromLine)
+{
+    if (mMeasureFrom<0 || fromLine<mMeasureFrom)
+        mMeasureFrom = fromLine;
+    if (!mMeasureTimer->isActive())
+        mMeasureTimer->start(0);
+}
+
+void Document::measureLinesWidth()
+{
+    QMutexLocker locker(&mMutex);
+    if (mMeasureFrom<0)
+        return;
+    QElapsedTimer timer;
+    timer.start();
+    int oldMaxWidth = countedMaxLineWidth();
+    int i = mMeasureFrom;
+    while (i<mLines.count()) {
+        mLines[i]->width();
+        updateLineWidthCount(mLines[i]);
+        i++;
+        if ((i % 256) == 0 && timer.elapsed()>=10)
+            break;
+    }
+    if (i<mLines.count()) {
+        mMeasureFrom = i;
+        mMeasureTimer->start(0);
+    } else
+        mMeasureFrom = -1;
+    if (countedMaxLineWidth()!=oldMaxWidth)
+        updateMaxLineWidthChanged();
 }
 
 QList<int> GlyphCalculator::calcGlyphPositionList(const QString &lineText, int &width) const
@@ -1256,8 +1420,11 @@ void Document::invalidateAllLineWidth()
     QMutexLocker locker(&mMutex);
     for (PDocumentLine& line:mLines) {
         line->invalidateWidth();
+        line->mCountedWidth = -1;
     }
-    mIndexOfLongestLine = -1;
+    mLineWidthCounts.clear();
+    if (!mLines.isEmpty())
+        scheduleMeasureLinesWidth(0);
 }
 
 void Document::invalidateAllNonTempLineWidth()
@@ -1270,8 +1437,10 @@ void Document::invalidateAllNonTempLineWidth()
 }
 
 DocumentLine::DocumentLine(DocumentLine::UpdateWidthFunc updateWidthFunc):
-    mSyntaxState{},
+    mGlyphStartCharListValid{true},
+    mSyntaxStateId{0},
     mWidth{-1},
+    mCountedWidth{-1},
     mIsTempWidth{true},
     mUpdateWidthFunc{updateWidthFunc}
 {
@@ -1279,12 +1448,12 @@ DocumentLine::DocumentLine(DocumentLine::UpdateWidthFunc updateWidthFunc):
 
 int DocumentLine::glyphLength(int i) const
 {
-    return calcSegmentInterval(mGlyphStartCharList, mLineText.length(), i);
+    return calcSegmentInterval(glyphStartCharList(), mLineText.length(), i);
 }
 
 QString DocumentLine::glyph(int i) const
 {
-   if (i<0 || i>=mGlyphStartCharList.length())
+   if (i<0 || i>=glyphsCount())
        return QString();
    return mLineText.mid(glyphStartChar(i),glyphLength(i));
 }
@@ -1317,14 +1486,21 @@ int DocumentLine::width()
 void DocumentLine::setLineText(const QString &newLineText)
 {
     mLineText = newLineText;
-    mGlyphStartCharList = calcGlyphStartCharList(newLineText);
+    mGlyphStartCharList.clear();
+    mGlyphStartCharListValid = false;
     invalidateWidth();
 }
 
+void DocumentLine::updateGlyphStartCharList() const
+{
+    mGlyphStartCharList = calcGlyphStartCharList(mLineText);
+    mGlyphStartCharListValid = true;
+}
+
 void DocumentLine::updateWidth()
 {
     Q_ASSERT(mUpdateWidthFunc!=nullptr);
-    mGlyphStartPositionList = mUpdateWidthFunc(mLineText, mGlyphStartCharList, mWidth);
+    mGlyphStartPositionList = mUpdateWidthFunc(mLineText, glyphStartCharList(), mWidth);
 //    qDebug()<<"Update Width"<<mLineText<<mWidth<<mGlyphPositionList;
 }
 
@@ -1339,15 +1515,22 @@ int DocumentLine::glyphStartChar(int i) const
 {
    if (i<0)
        return 0;
-   if (i>=mGlyphStartCharList.length())
+   const QList<int>& startCharList = glyphStartCharList();
+   if (i>=startCharList.length())
        return mLineText.length();
-   return mGlyphStartCharList[i];
+   return startCharList[i];
 }
 
+// change texts longer than it (in chars) are compressed
+static const int UndoCompressThreshold = 4096;
+
 UndoList::UndoList():QObject()
 {
     mNextChangeNumber = 1;
     mInsideRedo = false;
+    mMaxUndoActions = 0;
+    mMaxMemoryUsage = 0;
+    mMemoryUsage = 0;
 
     mBlockChangeNumber=0;
     mBlockLock=0;
@@ -1361,6 +1544,11 @@ void UndoList::addChange(ChangeReason reason, const BufferCoord &startPos,
                                 const BufferCoord &endPos, const QStringList& changeText,
                                 SelectionMode selMode)
 {
+    if (mergeInsertion(reason, startPos, endPos, changeText, selMode)) {
+        if (!inBlock())
+            emit addedUndo();
+        return;
+    }
     int changeNumber;
     if (inBlock()) {
         changeNumber = mBlockChangeNumber;
@@ -1371,7 +1559,7 @@ void UndoList::addChange(ChangeReason reason, const BufferCoord &startPos,
                 reason,
                 selMode,startPos,endPos,changeText,
                 changeNumber);
-    mItems.append(newItem);
+    appendItem(newItem);
 
     if (reason!=ChangeReason::GroupBreak && !inBlock()) {
         emit addedUndo();
@@ -1389,7 +1577,7 @@ void UndoList::restoreChange(ChangeReason AReason, const BufferCoord &AStart, co
 void UndoList::restoreChange(PUndoItem item)
 {
     size_t changeNumber = item->changeNumber();
-    mItems.append(item);
+    appendItem(item);
     if (changeNumber>mNextChangeNumber)
         mNextChangeNumber=changeNumber;
     if (changeNumber!=mLastRestoredItemChangeNumber) {
@@ -1420,6 +1608,7 @@ void UndoList::beginBlock()
 void UndoList::clear()
 {
     mItems.clear();
+    mMemoryUsage = 0;
     mFullUndoImposible = false;
     mInitialChangeNumber=0;
     mLastPoppedItemChangeNumber=0;
@@ -1482,6 +1671,7 @@ PUndoItem UndoList::popItem()
 //        qDebug()<<"popped"<<item->changeNumber()<<item->changeText()<<(int)item->changeReason()<<mLastPoppedItemChangeNumber;
         mLastPoppedItemChangeNumber =  item->changeNumber();
         mItems.removeLast();
+        mMemoryUsage -= item->memoryUsage();
         return item;
     }
 }
@@ -1496,10 +1686,38 @@ int UndoList::itemCount()
     return mItems.count();
 }
 
+int UndoList::maxUndoActions() const
+{
+    return mMaxUndoActions;
+}
+
+void UndoList::setMaxUndoActions(int maxUndoActions)
+{
+    mMaxUndoActions = maxUndoActions;
+    ensureMaxEntries();
+}
+
+qint64 UndoList::maxMemoryUsage() const
+{
+    return mMaxMemoryUsage;
+}
+
+void UndoList::setMaxMemoryUsage(qint64 maxMemoryUsage)
+{
+    mMaxMemoryUsage = maxMemoryUsage;
+    ensureMaxEntries();
+}
+
+qint64 UndoList::memoryUsage() const
+{
+    return mMemoryUsage;
+}
+
 bool UndoList::initialState()
 {
     if (itemCount() == 0) {
-        return mInitialChangeNumber==0;
+        //can't be the initial state if its changes are dropped
+        return mInitialChangeNumber==0 && !mFullUndoImposible;
     } else {
         return peekItem()->changeNumber() == mInitialChangeNumber;
     }
@@ -1528,6 +1746,68 @@ bool UndoList::fullUndoImposible() const
     return mFullUndoImposible;
 }
 
+bool UndoList::mergeInsertion(ChangeReason reason, const BufferCoord &start, const BufferCoord &end, const QStringList &changeText, SelectionMode selMode)
+{
+    // Merge chars typed one by one into one insertion,
+    // so each keystroke doesn't cost an undo item.
+    // (Typing a word boundary adds a group break, so words are not merged.)
+    if (reason!=ChangeReason::Insert || selMode!=SelectionMode::Normal
+            || !changeText.isEmpty() || start.line!=end.line)
+        return false;
+    PUndoItem item = peekItem();
+    if (!item || item->changeReason()!=ChangeReason::Insert
+            || item->changeSelMode()!=SelectionMode::Normal
+            || item->changeStartPos().line!=item->changeEndPos().line
+            || item->changeEndPos()!=start)
+        return false;
+    if (inBlock()) {
+        if (item->changeNumber()!=mBlockChangeNumber)
+            return false;
+    } else {
+        //only merge the keystrokes of the last change
+        if (item->changeNumber()!=mNextChangeNumber-1)
+            return false;
+    }
+    // the file is saved after the item is added
+    if (item->changeNumber()==mInitialChangeNumber)
+        return false;
+    item->setChangeEndPos(end);
+    return true;
+}
+
+void UndoList::appendItem(PUndoItem item)
+{
+    mItems.append(item);
+    mMemoryUsage += item->memoryUsage();
+    ensureMaxEntries();
+}
+
+void UndoList::ensureMaxEntries()
+{
+    if (mItems.isEmpty())
+        return;
+    //drop the oldest changes, but always keep the last one
+    size_t lastChangeNumber = mItems.last()->changeNumber();
+    int count = 0;
+    qint64 memoryUsage = mMemoryUsage;
+    while (count<mItems.count()
+           && ((mMaxUndoActions>0 && mItems.count()-count>mMaxUndoActions)
+               || (mMaxMemoryUsage>0 && memoryUsage>mMaxMemoryUsage))) {
+        size_t changeNumber = mItems[count]->changeNumber();
+        if (changeNumber == lastChangeNumber)
+            break;
+        while (count<mItems.count() && mItems[count]->changeNumber()==changeNumber) {
+            memoryUsage -= mItems[count]->memoryUsage();
+            count++;
+        }
+    }
+    if (count>0) {
+        mItems.remove(0,count);
+        mMemoryUsage = memoryUsage;
+        mFullUndoImposible = true;
+    }
+}
+
 SelectionMode UndoItem::changeSelMode() const
 {
     return mChangeSelMode;
@@ -1545,6 +1825,10 @@ BufferCoord UndoItem::changeEndPos() const
 
 QStringList UndoItem::changeText() const
 {
+    if (!mCompressedText.isEmpty()) {
+        QByteArray data = qUncompress(mCompressedText);
+        return QString((const QChar*)data.constData(), data.length()/sizeof(QChar)).split('\n');
+    }
     return mChangeText;
 }
 
@@ -1561,12 +1845,32 @@ UndoItem::UndoItem(ChangeReason reason, SelectionMode selMode,
     mChangeSelMode = selMode;
     mChangeStartPos = startPos;
     mChangeEndPos = endPos;
-    mChangeText = text;
     mChangeNumber = number;
     int length=0;
     foreach (const QString& s, text) {
         length+=s.length();
     }
+    if (length > UndoCompressThreshold) {
+        // lines don't contain line breaks, so they can be safely joined by '\n'
+        QString joined = text.join('\n');
+        mCompressedText = qCompress(
+                    QByteArray::fromRawData((const char*)joined.constData(), joined.length()*sizeof(QChar)),
+                    1);
+        mMemoryUsage = sizeof(UndoItem) + mCompressedText.size();
+    } else {
+        mChangeText = text;
+        mMemoryUsage = sizeof(UndoItem) + length*sizeof(QChar) + text.count()*sizeof(QString);
+    }
+}
+
+qint64 UndoItem::memoryUsage() const
+{
+    return mMemoryUsage;
+}
+
+void UndoItem::setChangeEndPos(const BufferCoord &endPos)
+{
+    mChangeEndPos = endPos;
 }
 
 ChangeReason UndoItem::changeReason() const
@@ -1576,7 +1880,7 @@ ChangeReason UndoItem::changeReason() const
 
 RedoList::RedoList()
 {
-
+    mMemoryUsage = 0;
 }
 
 void RedoList::addRedo(ChangeReason AReason, const BufferCoord &AStart, const BufferCoord &AEnd, const QStringList &ChangeText, SelectionMode SelMode, size_t changeNumber)
@@ -1585,17 +1889,19 @@ void RedoList::addRedo(ChangeReason AReason, const BufferCoord &AStart, const Bu
                 AReason,
                 SelMode,AStart,AEnd,ChangeText,
                 changeNumber);
-    mItems.append(newItem);
+    addRedo(newItem);
 }
 
 void RedoList::addRedo(PUndoItem item)
 {
     mItems.append(item);
+    mMemoryUsage += item->memoryUsage();
 }
 
 void RedoList::clear()
 {
     mItems.clear();
+    mMemoryUsage = 0;
 }
 
 ChangeReason RedoList::lastChangeReason()
@@ -1626,6 +1932,7 @@ PUndoItem RedoList::popItem()
     else {
         PUndoItem item = mItems.last();
         mItems.removeLast();
+        mMemoryUsage -= item->memoryUsage();
         return item;
     }
 }
@@ -1640,6 +1947,11 @@ int RedoList::itemCount()
     return mItems.count();
 }
 
+qint64 RedoList::memoryUsage() const
+{
+    return mMemoryUsage;
+}
+
 BinaryFileError::BinaryFileError(const QString& reason):
     FileError(reason)
 {
@@ -1709,6 +2021,9 @@ int GlyphCalculator::glyphWidth(const QString &glyph, int left, const QFontMetri
     QChar ch = glyph[0];
     if (ch == '\t') {
         glyphWidth = tabWidth() - left % tabWidth();
+    } else if (glyph.length()==1 && ch.unicode()<128
+               && &fontMetrics == &mFontMetrics && forceMonospace == mForceMonospace) {
+        return mAsciiCharWidths[ch.unicode()];
     } else {
         glyphWidth = fontMetrics.horizontalAdvance(glyph);
         //qDebug()<<glyph<<glyphCols<<width<<mCharWidth;
@@ -1753,6 +2068,7 @@ GlyphCalculator::GlyphCalculator(const QFont &font):
 {
     mCharWidth =  mFontMetrics.horizontalAdvance("M");
     mSpaceWidth = mFontMetrics.horizontalAdvance(" ");
+    updateAsciiCharWidths();
 }
 
 void GlyphCalculator::setFont(const QFont &newFont)
@@ -1760,6 +2076,27 @@ void GlyphCalculator::setFont(const QFont &newFont)
     mFontMetrics = QFontMetrics(newFont);
     mCharWidth =  mFontMetrics.horizontalAdvance("M");
     mSpaceWidth = mFontMetrics.horizontalAdvance(" ");
+    updateAsciiCharWidths();
+}
+
+void GlyphCalculator::setForceMonospace(bool newForceMonospace)
+{
+    if (mForceMonospace == newForceMonospace)
+        return;
+    mForceMonospace = newForceMonospace;
+    updateAsciiCharWidths();
+}
+
+void GlyphCalculator::updateAsciiCharWidths()
+{
+    for (int i=0;i<128;i++) {
+        int width = mFontMetrics.horizontalAdvance(QString(QChar(i)));
+        if (mForceMonospace) {
+            int cols = std::ceil(width / (double)mCharWidth);
+            width = cols * mCharWidth;
+        }
+        mAsciiCharWidths[i] = width;
+    }
 }
 
 }
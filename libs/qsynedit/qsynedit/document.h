@@ -21,12 +21,16 @@
 #include <QFontMetrics>
 #include <QMutex>
 #include <QVector>
+#include <QHash>
+#include <QMap>
 #include <memory>
 #include <QFile>
 #include "miscprocs.h"
 #include "types.h"
 #include "qt_utils/utils.h"
 
+class QTimer;
+
 namespace QSynedit {
 
 int searchForSegmentIdx(const QList<int> &segList, int minVal, int maxVal, int value);
@@ -68,13 +72,17 @@ private:
      *
      * @return the glyphs count
      */
-    int glyphsCount() const { return mGlyphStartCharList.length(); }
+    int glyphsCount() const { return glyphStartCharList().length(); }
 
     /**
      * @brief get list of start index of the glyphs in the line text
      * @return start indice of the glyph.
      */
-    const QList<int>& glyphStartCharList() const { return mGlyphStartCharList; }
+    const QList<int>& glyphStartCharList() const {
+        if (!mGlyphStartCharListValid)
+            updateGlyphStartCharList();
+        return mGlyphStartCharList;
+    }
 
     /**
      * @brief get list of start position of the glyphs in the line text
@@ -130,17 +138,20 @@ private:
     int width();
 
     /**
-     * @brief get the state of the syntax highlighter after this line is parsed
+     * @brief get id of the state of the syntax highlighter after this line is parsed
+     *
+     * States are interned by the document, see Document::getSyntaxState()
      * @return
      */
-    const SyntaxState& syntaxState() const { return mSyntaxState; }
+    int syntaxStateId() const { return mSyntaxStateId; }
     /**
-     * @brief set the state of the syntax highlighter after this line is parsed
-     * @param newSyntaxState
+     * @brief set id of the state of the syntax highlighter after this line is parsed
+     * @param newSyntaxStateId
      */
-    void setSyntaxState(const SyntaxState &newSyntaxState) { mSyntaxState = newSyntaxState; }
+    void setSyntaxStateId(int newSyntaxStateId) { mSyntaxStateId = newSyntaxStateId; }
 
     void setLineText(const QString &newLineText);
+    void updateGlyphStartCharList() const;
     void updateWidth();
     void invalidateWidth() { mWidth = -1; mGlyphStartPositionList.clear(); mIsTempWidth = true;}
 private:
@@ -151,8 +162,12 @@ private:
      * A glyph may be defined by more than one code points.
      * Each lement of mGlyphStartCharList (position) is the start index
      *  of the code points in the mLineText.
+     *
+     * It's calculated when first used, so loading a large file
+     * doesn't need to calculate it for each line.
      */
-    QList<int> mGlyphStartCharList;
+    mutable QList<int> mGlyphStartCharList;
+    mutable bool mGlyphStartCharListValid;
     /**
      * @brief start columns of the glyphs
      *
@@ -163,12 +178,14 @@ private:
      */
     QList<int> mGlyphStartPositionList;
     /**
-     * @brief state of the syntax highlighter after this line is parsed
+     * @brief id of the state of the syntax highlighter after this line is parsed
      *
      * QSynedit use this state to speed up syntax highlight parsing.
      * Which is also used in auto-indent calculating and other functions.
+     * Most lines share the same few states, so they are interned by the document
+     * and each line only keeps the index in the document's state table.
      */
-    SyntaxState mSyntaxState;
+    int mSyntaxStateId;
     /**
      * @brief total width (pixel) of the line text
      *
@@ -176,6 +193,10 @@ private:
      * so it must be recalculated each time the font is changed.
      */
     int mWidth;
+    /**
+     * @brief the width counted in Document::mLineWidthCounts, -1 if not counted
+     */
+    int mCountedWidth;
     bool mIsTempWidth;
     UpdateWidthFunc mUpdateWidthFunc;
     friend class Document;
@@ -216,7 +237,7 @@ public:
 
     bool forceMonospace() const { return mForceMonospace; }
 
-    void setForceMonospace(bool newForceMonospace) { mForceMonospace = newForceMonospace; }
+    void setForceMonospace(bool newForceMonospace);
 
     const QFontMetrics &fontMetrics() const { return mFontMetrics; }
 
@@ -265,12 +286,22 @@ public:
             const QFontMetrics &fontMetrics,
             QList<int> &glyphStartPositionList,
             int left, int &right, int &startGlyph, int &endGlyph) const;
+private:
+    void updateAsciiCharWidths();
 private:
     QFontMetrics mFontMetrics;
     int mTabSize;
     int mCharWidth;
     int mSpaceWidth;
     bool mForceMonospace;
+    /**
+     * @brief widths of ascii chars in mFontMetrics
+     *
+     * Most lines in source files are pure ascii, so we measure these chars
+     * once when the font is changed, instead of measuring them glyph by glyph.
+     * Widths are already rounded if mForceMonospace is true.
+     */
+    int mAsciiCharWidths[128];
 };
 
 /**
@@ -399,8 +430,19 @@ public:
      *
      * @param line line index (starts frome 0)
      * @param state the new state
+     * @return false if the line's state is not changed
+     */
+    bool setSyntaxState(int line, const SyntaxState& state);
+
+    /**
+     * @brief id of the interned syntax state of the specified line
+     *
+     * Lines with the same id have equal states. Ids may change when unused states are dropped.
+     * It's thread safe.
+     *
+     * @param line line index (starts frome 0)
      */
-    void setSyntaxState(int line, const SyntaxState& state);
+    int syntaxStateId(int line) const;
 
     /**
      * @brief get line text of the specified line.
@@ -636,7 +678,12 @@ private:
     void endSetLinesWidth();
     void setLineWidth(int line, int newWidth, const QList<int> glyphStartPositionList);
     void updateMaxLineWidthChanged();
-    void updateMaxLineWidthAndNotify();
+    int countedMaxLineWidth() const;
+    void updateLineWidthCount(const PDocumentLine& line);
+    void removeLineWidthCount(const PDocumentLine& line);
+    void measureLineWidth(const PDocumentLine& line);
+    void scheduleMeasureLinesWidth(int fromLine);
+    void measureLinesWidth();
 
     int xposToGlyphIndex(int strWidth, QList<int> glyphPositionList, int xpos) const;
     int charToGlyphIndex(const QString& str, QList<int> glyphStartCharList, int charPos) const;
@@ -644,6 +691,9 @@ private:
     QList<int> getGlyphStartCharList(int line);
     QList<int> getGlyphStartPositionList(int line);
     int getLineWidth(int line);
+    int internSyntaxState(const SyntaxState& state);
+    void compactSyntaxStates();
+    void resetSyntaxStates();
     bool tryLoadFileByEncoding(QByteArray encodingName, QFile& file);
     void loadUTF16BOMFile(QFile& file);
     void loadUTF32BOMFile(QFile& file);
@@ -657,13 +707,33 @@ private:
 
     NewlineType mNewlineType;
     bool mAppendNewLineAtEOF;
-    int mIndexOfLongestLine;
+    /**
+     * @brief count of lines of each width
+     *
+     * Only measured lines are counted, and the last key is the max line width.
+     * Lines not measured yet are measured in idle time (see measureLinesWidth()),
+     * so we don't need to measure all lines to get the max line width.
+     */
+    QMap<int,int> mLineWidthCounts;
+    QTimer* mMeasureTimer;
+    int mMeasureFrom; // lines before it are all measured, -1 if all lines are measured
     int mUpdateCount;
 
     int mSetLineWidthLockCount;
     bool mMaxLineChangedInSetLinesWidth;
     mutable QRecursiveMutex mMutex;
 
+    /**
+     * @brief table of the distinct syntax states used by lines
+     *
+     * Each line keeps the index of its state in the table, so equal states are
+     * stored only once and comparing two lines' states is an integer compare.
+     * Index 0 is always the initial state. Unused states are dropped when the
+     * table grows too large (see compactSyntaxStates()).
+     */
+    QVector<SyntaxState> mSyntaxStates;
+    QHash<SyntaxState,int> mSyntaxStateIds;
+
     GlyphCalculator mGlyphCalculator;
 
     friend class QSynEditPainter;
@@ -690,7 +760,9 @@ private:
     BufferCoord mChangeStartPos;
     BufferCoord mChangeEndPos;
     QStringList mChangeText;
+    QByteArray mCompressedText; // large change texts are kept compressed, and mChangeText is empty
     size_t mChangeNumber;
+    qint64 mMemoryUsage;
 public:
     UndoItem(ChangeReason reason,
         SelectionMode selMode,
@@ -705,6 +777,14 @@ public:
     BufferCoord changeEndPos() const;
     QStringList changeText() const;
     size_t changeNumber() const;
+    /**
+     * @brief approximate bytes used by the item (including the change text)
+     */
+    qint64 memoryUsage() const;
+    /**
+     * @brief extend an insertion to the text typed right after it
+     */
+    void setChangeEndPos(const BufferCoord& endPos);
 };
 
 using PUndoItem = std::shared_ptr<UndoItem>;
@@ -737,6 +817,14 @@ public:
 
     int maxUndoActions() const;
     void setMaxUndoActions(int maxUndoActions);
+    /**
+     * @brief max bytes used by the undo items, 0 means unlimited
+     *
+     * Oldest undo steps are dropped when the list grows beyond it.
+     */
+    qint64 maxMemoryUsage() const;
+    void setMaxMemoryUsage(qint64 maxMemoryUsage);
+    qint64 memoryUsage() const;
     bool initialState();
     void setInitialState();
 
@@ -750,6 +838,10 @@ signals:
 protected:
     bool inBlock();
     unsigned int getNextChangeNumber();
+    bool mergeInsertion(ChangeReason reason, const BufferCoord& start, const BufferCoord& end,
+                        const QStringList& changeText, SelectionMode selMode);
+    void appendItem(PUndoItem item);
+    void ensureMaxEntries();
 protected:
     size_t mBlockChangeNumber;
     int mBlockLock;
@@ -760,6 +852,9 @@ protected:
     unsigned int mNextChangeNumber;
     unsigned int mInitialChangeNumber;
     bool mInsideRedo;
+    int mMaxUndoActions;
+    qint64 mMaxMemoryUsage;
+    qint64 mMemoryUsage;
 };
 
 class RedoList : public QObject {
@@ -779,9 +874,11 @@ public:
 
     bool canRedo();
     int itemCount();
+    qint64 memoryUsage() const;
 
 protected:
     QVector<PUndoItem> mItems;
+    qint64 mMemoryUsage;
 };
 
 
@@ -41,6 +41,7 @@ void QSynEditPainter::paintEditingArea(const QRect& clip)
     mFirstLine = mEdit->rowToLine(mFirstRow);
     mLastLine = mEdit->rowToLine(mLastRow);
     mIsCurrentLine = false;
+    mPaintingLine = 0;
     // If the right edge is visible and in the invalid area, prepare to paint it.
     // Do this first to realize the pen when getting the dc variable.
     bDoRightEdge = false;
@@ -343,11 +344,25 @@ void QSynEditPainter::paintLine()
 
     QFont font;
     QFontMetrics fm{font};
+    qreal ascent = QFontMetricsF{font}.ascent();
     int lineHeight = mRcLine.height();
+    // Glyph runs are laid out once and reused, as long as the line paints the same runs.
+    RenderedLine& cachedLine = mEdit->mRenderCache[mPaintingLine];
+    int startSyntaxStateId = 0;
+    if (mPaintingLine>1 && mPaintingLine-2 < mEdit->mDocument->count())
+        startSyntaxStateId = mEdit->mDocument->syntaxStateId(mPaintingLine-2);
+    if (cachedLine.startSyntaxStateId != startSyntaxStateId) {
+        cachedLine.startSyntaxStateId = startSyntaxStateId;
+        cachedLine.runs.clear();
+    }
+    const QVector<RenderedGlyphRun>& cachedRuns = cachedLine.runs;
+    QVector<RenderedGlyphRun> runs;
+    runs.reserve(mLineTokens.length());
     for (int i=0;i<mLineTokens.length();i++) {
         if (font!=mLineTokens[i].font) {
             font = mLineTokens[i].font;
             fm = QFontMetrics{font};
+            ascent = QFontMetricsF{font}.ascent();
         }
         int fontHeight = fm.descent() + fm.ascent();
         int linePadding = (lineHeight - fontHeight) / 2;
@@ -357,8 +372,25 @@ void QSynEditPainter::paintLine()
         QPen pen(mLineTokens[i].foreground);
         if (pen!=mPainter->pen())
             mPainter->setPen(pen);
-        mPainter->drawText(mLineTokens[i].left,nY, mLineTokens[i].token);
+        if (i<cachedRuns.length()
+                && cachedRuns[i].text == mLineTokens[i].token
+                && cachedRuns[i].font == font) {
+            runs.append(cachedRuns[i]);
+            mEdit->mPaintStatistics.cachedRuns++;
+        } else {
+            RenderedGlyphRun run;
+            run.text = mLineTokens[i].token;
+            run.font = font;
+            run.staticText.setTextFormat(Qt::PlainText);
+            run.staticText.setText(run.text);
+            run.staticText.prepare(mPainter->deviceTransform(), font);
+            runs.append(run);
+            mEdit->mPaintStatistics.preparedRuns++;
+        }
+        // QStaticText is positioned by its top left corner, not the baseline
+        mPainter->drawStaticText(QPointF(mLineTokens[i].left, nY - ascent), runs.back().staticText);
     }
+    cachedLine.runs.swap(runs);
     mLineTokens.clear();
     mLineTokenBackgrounds.clear();
 }
@@ -973,6 +1005,7 @@ void QSynEditPainter::paintLines()
         bool lineTextChanged = false;
         if (vLine > mEdit->mDocument->count() && mEdit->mDocument->count() != 0)
             break;
+        mPaintingLine = vLine;
 
         // Get the line.
         sLine = mEdit->lineText(vLine);
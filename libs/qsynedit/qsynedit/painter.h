@@ -128,6 +128,7 @@ private:
     // painting the background and the text
     QRect mRcLine, mRcToken;
     int mFirstLine, mLastLine;
+    int mPaintingLine; // line whose tokens are in mLineTokens
     QList<TokenTextInfo> mLineTokens;
     QList<TokenBackgroundInfo> mLineTokenBackgrounds;
 
@@ -21,6 +21,7 @@
 #include <QFontMetrics>
 #include <algorithm>
 #include <cmath>
+#include <cstring>
 #include <QScrollBar>
 #include <QPaintEvent>
 #include <QPainter>
@@ -40,6 +41,7 @@
 #include <QMimeData>
 #include <QTextEdit>
 #include <QMimeData>
+#include <QElapsedTimer>
 
 #define UPDATE_HORIZONTAL_SCROLLBAR_EVENT ((QEvent::Type)(QEvent::User+1))
 #define UPDATE_VERTICAL_SCROLLBAR_EVENT ((QEvent::Type)(QEvent::User+2))
@@ -138,11 +140,22 @@ QSynEdit::QSynEdit(QWidget *parent) : QAbstractScrollArea(parent),
     //mScrollTimer->setInterval(100);
     connect(mScrollTimer, &QTimer::timeout,this, &QSynEdit::onScrollTimeout);
 
+    mReparseFrom = -1;
+    mReparseTo = -1;
+    mReparseTimer = new QTimer(this);
+    mReparseTimer->setSingleShot(true);
+    connect(mReparseTimer, &QTimer::timeout,this, &QSynEdit::onReparseTimeout);
+
     qreal dpr=devicePixelRatioF();
     mContentImage = std::make_shared<QImage>(clientWidth()*dpr,clientHeight()*dpr,QImage::Format_ARGB32);
     mContentImage->setDevicePixelRatio(dpr);
+    resetPaintStatistics();
 
     mAllFoldRanges = std::make_shared<CodeFoldingRanges>();
+    mTopLevelFoldRanges = std::make_shared<CodeFoldingRanges>();
+    mFoldRescanFrom = -1;
+    mFoldRescanTo = -1;
+    mFullFoldRescan = false;
     mUseCodeFolding = true;
     m_blinkTimerId = 0;
     m_blinkStatus = 0;
@@ -284,6 +297,21 @@ bool QSynEdit::canRedo() const
     return !mReadOnly && mRedoList->canRedo();
 }
 
+qint64 QSynEdit::undoMemoryUsage() const
+{
+    return mUndoList->memoryUsage() + mRedoList->memoryUsage();
+}
+
+qint64 QSynEdit::maxUndoMemoryUsage() const
+{
+    return mUndoList->maxMemoryUsage();
+}
+
+void QSynEdit::setMaxUndoMemoryUsage(qint64 bytes)
+{
+    mUndoList->setMaxMemoryUsage(bytes);
+}
+
 int QSynEdit::maxScrollWidth() const
 {
     int maxWidth = mDocument->maxLineWidth();
@@ -398,9 +426,48 @@ void QSynEdit::addSelectionToUndo()
 
 void QSynEdit::replaceAll(const QString &text)
 {
+    // Only replace the lines between the unchanged head and tail of the document,
+    // so the undo history doesn't keep a copy of the whole document.
+    QStringList newLines = splitStrings(text);
+    int oldCount = mDocument->count();
+    int newCount = newLines.count();
+    int minCount = std::min(oldCount, newCount);
+    int head = 0;
+    while (head < minCount && mDocument->getLine(head) == newLines[head])
+        head++;
+    int tail = 0;
+    while (tail < minCount - head
+           && mDocument->getLine(oldCount - 1 - tail) == newLines[newCount - 1 - tail])
+        tail++;
+    if (head == oldCount && head == newCount) {
+        //nothing changed
+        return;
+    }
     mUndoList->addChange(ChangeReason::Selection,mBlockBegin,mBlockEnd,QStringList(), activeSelectionMode());
-    selectAll();
-    setSelText(text);
+    if (oldCount == 0 || (head == 0 && tail == 0)) {
+        selectAll();
+        setSelText(text);
+    } else if (tail > 0) {
+        // replace lines [head, oldCount-tail) with newLines [head, newCount-tail)
+        setCaretAndSelection(BufferCoord{1, head+1},
+                             BufferCoord{1, head+1},
+                             BufferCoord{1, oldCount-tail+1});
+        QStringList changedLines = newLines.mid(head, newCount - tail - head);
+        if (changedLines.isEmpty())
+            setSelText("");
+        else
+            setSelText(changedLines.join(lineBreak()) + lineBreak());
+    } else {
+        // replace the text after the end of line head
+        BufferCoord start{mDocument->getLine(head-1).length()+1, head};
+        setCaretAndSelection(start, start,
+                             BufferCoord{mDocument->getLine(oldCount-1).length()+1, oldCount});
+        QStringList changedLines = newLines.mid(head);
+        if (changedLines.isEmpty())
+            setSelText("");
+        else
+            setSelText(lineBreak() + changedLines.join(lineBreak()));
+    }
 }
 
 void QSynEdit::doTrimTrailingSpaces()
@@ -876,31 +943,16 @@ int QSynEdit::lineToRow(int aLine) const
 
 int QSynEdit::foldRowToLine(int row) const
 {
-    int result = row;
-    for (int i=0;i<mAllFoldRanges->count();i++) {
-        PCodeFoldingRange range = (*mAllFoldRanges)[i];
-        if (range->collapsed && !range->parentCollapsed() && range->fromLine < result) {
-            result += range->linesCollapsed;
-        }
-    }
-    return result;
+    if (!mCollapsedFoldIndex.valid())
+        mCollapsedFoldIndex.rebuild(mAllFoldRanges);
+    return mCollapsedFoldIndex.rowToLine(row);
 }
 
 int QSynEdit::foldLineToRow(int line) const
 {
-    int result = line;
-    for (int i=mAllFoldRanges->count()-1;i>=0;i--) {
-        PCodeFoldingRange range =(*mAllFoldRanges)[i];
-        if (range->collapsed && !range->parentCollapsed()) {
-            // Line is found after fold
-            if (range->toLine < line)
-                result -= range->linesCollapsed;
-            // Inside fold
-            else if (range->fromLine < line && line <= range->toLine)
-                result -= line - range->fromLine;
-        }
-    }
-    return result;
+    if (!mCollapsedFoldIndex.valid())
+        mCollapsedFoldIndex.rebuild(mAllFoldRanges);
+    return mCollapsedFoldIndex.lineToRow(line);
 }
 
 void QSynEdit::setDefaultKeystrokes()
@@ -916,6 +968,7 @@ void QSynEdit::setExtraKeystrokes()
 void QSynEdit::invalidateLine(int line)
 {
     QRect rcInval;
+    mRenderCache.remove(line);
     if (line<1 || (line>mDocument->count() &&
                    line!=1) || !isVisible())
         return;
@@ -934,6 +987,7 @@ void QSynEdit::invalidateLine(int line)
 
 void QSynEdit::invalidateLines(int firstLine, int lastLine)
 {
+    invalidateRenderCache(firstLine, lastLine);
     if (!isVisible())
         return;
     if (firstLine == -1 && lastLine == -1) {
@@ -1733,7 +1787,9 @@ void QSynEdit::endEditing()
     if (mEditingCount==0) {
         if (!mUndoing)
             mUndoList->endBlock();
-        reparseDocument();
+        //folds are rescanned by the pending reparse when it's finished
+        if (mReparseFrom<0 && useCodeFolding())
+            rescanFolds();
     }
     decPaintLock();
 }
@@ -2665,7 +2721,7 @@ void QSynEdit::doAddChar(const QChar& ch)
                 && undoItem->changeEndPos().line == mCaretY
                 && undoItem->changeEndPos().ch == mCaretX
                 && undoItem->changeStartPos().line == mCaretY
-                && undoItem->changeStartPos().ch == mCaretX-1) {
+                && undoItem->changeStartPos().ch < mCaretX) {
             QString s = mDocument->getLine(mCaretY-1);
             int i=mCaretX-2;
             if (i>=0 && i<s.length())
@@ -3005,6 +3061,72 @@ void QSynEdit::ensureCaretVisibleEx(bool ForceToMiddle)
         setLeftPos(leftPos());
 }
 
+void QSynEdit::invalidateRenderedLines()
+{
+    invalidateRenderCache(-1, -1);
+    invalidate();
+}
+
+void QSynEdit::invalidateRenderCache(int firstLine, int lastLine)
+{
+    if (firstLine == -1 && lastLine == -1) {
+        mRenderCache.clear();
+        return;
+    }
+    if (lastLine < firstLine)
+        std::swap(lastLine, firstLine);
+    if ((qint64)lastLine - firstLine >= mRenderCache.count()) {
+        for (auto it=mRenderCache.begin();it!=mRenderCache.end();) {
+            if (it.key()>=firstLine && it.key()<=lastLine)
+                it = mRenderCache.erase(it);
+            else
+                ++it;
+        }
+    } else {
+        for (int line=firstLine;line<=lastLine;line++)
+            mRenderCache.remove(line);
+    }
+}
+
+void QSynEdit::trimRenderCache()
+{
+    //only keep glyph runs of lines near the viewport
+    if (mRenderCache.count() <= std::max(256, mLinesInWindow * 4))
+        return;
+    int firstLine = rowToLine(std::max(1, yposToRow(0) - mLinesInWindow));
+    int lastLine = rowToLine(yposToRow(clientHeight()) + mLinesInWindow);
+    for (auto it=mRenderCache.begin();it!=mRenderCache.end();) {
+        if (it.key()<firstLine || it.key()>lastLine)
+            it = mRenderCache.erase(it);
+        else
+            ++it;
+    }
+}
+
+bool QSynEdit::scrollContentImage(int dy)
+{
+    // Move the painted content by dy pixels, so only the exposed strip is repainted.
+    if (dy == 0 || std::abs(dy) >= clientHeight() || !isVisible())
+        return false;
+    qreal dpr = mContentImage->devicePixelRatioF();
+    qreal scaledDy = dy * dpr;
+    if (scaledDy != std::round(scaledDy))
+        return false;
+    int pixelDy = std::round(scaledDy);
+    int imageHeight = mContentImage->height();
+    if (std::abs(pixelDy) >= imageHeight)
+        return false;
+    int bytesPerLine = mContentImage->bytesPerLine();
+    uchar* bits = mContentImage->bits();
+    if (pixelDy > 0)
+        memmove(bits + pixelDy * bytesPerLine, bits, (imageHeight - pixelDy) * bytesPerLine);
+    else
+        memmove(bits, bits - pixelDy * bytesPerLine, (imageHeight + pixelDy) * bytesPerLine);
+    viewport()->scroll(0, dy);
+    mPaintStatistics.blittedScrolls++;
+    return true;
+}
+
 void QSynEdit::scrollWindow(int dx, int dy)
 {
     int nx = horizontalScrollBar()->value()+dx;
@@ -3248,41 +3370,131 @@ void QSynEdit::updateModifiedStatus()
 
 int QSynEdit::reparseLines(int startLine, int endLine)
 {
-
-    SyntaxState state;
     startLine = std::max(0,startLine);
     endLine = std::min(endLine, mDocument->count());
 
     if (startLine >= endLine)
         return startLine;
 
-    if (startLine == 0) {
+    //merge with the pending reparse
+    if (mReparseFrom<0 || startLine<mReparseFrom)
+        mReparseFrom = startLine;
+    mReparseTo = std::max(mReparseTo, endLine);
+    int fromLine = mReparseFrom;
+
+    //only lines before the end of the viewport are reparsed immediately,
+    //the rest is done in idle time
+    int line = continueReparse(std::max(endLine, visibleLineLimit()), 0);
+    if (mReparseFrom>=0) {
+        mReparseTimer->start(0);
+        return line;
+    }
+
+    //don't rescan folds if only currentLine is reparsed
+    if (line-fromLine==1)
+        return line;
+
+    if (mEditingCount>0)
+        return line;
+
+    if (useCodeFolding())
+        rescanFolds();
+    return line;
+}
+
+int QSynEdit::continueReparse(int lineLimit, int timeLimit)
+{
+    if (mReparseFrom<0)
+        return 0;
+    QElapsedTimer timer;
+    timer.start();
+    int line = mReparseFrom;
+    if (line == 0) {
         mSyntaxer->resetState();
     } else {
-        mSyntaxer->setState(mDocument->getSyntaxState(startLine-1));
+        mSyntaxer->setState(mDocument->getSyntaxState(line-1));
     }
-    int line = startLine;
-    do {
+    bool finished = true;
+    int changedFrom = -1;
+    int changedTo = -1;
+    while (line < mDocument->count()) {
         mSyntaxer->setLine(mDocument->getLine(line), line);
         mSyntaxer->nextToEol();
-        state = mSyntaxer->getState();
-        if (line >= endLine && state == mDocument->getSyntaxState(line)) {
+        //states are interned by the document, so this is only an integer compare
+        if (mDocument->setSyntaxState(line,mSyntaxer->getState())) {
+            if (changedFrom<0)
+                changedFrom = line;
+            changedTo = line+1;
+        } else if (line >= mReparseTo) {
             break;
         }
-        mDocument->setSyntaxState(line,state);
         line++;
-    } while (line < mDocument->count());
+        if (line >= lineLimit
+                || (timeLimit>0 && (line % 64)==0 && timer.elapsed()>=timeLimit)) {
+            finished = (line >= mDocument->count());
+            break;
+        }
+    }
+    if (changedFrom>=0)
+        markFoldRescan(changedFrom, changedTo);
+    if (finished) {
+        mReparseFrom = -1;
+        mReparseTo = -1;
+        //when it's finished by painting, the changed folds are rescanned by the timer
+        if (mFoldRescanFrom>=0 || mFullFoldRescan)
+            mReparseTimer->start(0);
+        else
+            mReparseTimer->stop();
+    } else {
+        mReparseFrom = line;
+    }
+    return line;
+}
 
-    //don't rescan folds if only currentLine is reparsed
-    if (line-startLine==1)
-        return line;
+int QSynEdit::visibleLineLimit() const
+{
+    return rowToLine(yposToRow(clientHeight())) + 1;
+}
 
-    if (mEditingCount>0)
-        return line;
+const PaintStatistics &QSynEdit::paintStatistics() const
+{
+    return mPaintStatistics;
+}
 
-    if (useCodeFolding())
+void QSynEdit::resetPaintStatistics()
+{
+    mPaintStatistics.frames = 0;
+    mPaintStatistics.lastFrameTime = 0;
+    mPaintStatistics.maxFrameTime = 0;
+    mPaintStatistics.totalFrameTime = 0;
+    mPaintStatistics.cachedRuns = 0;
+    mPaintStatistics.preparedRuns = 0;
+    mPaintStatistics.blittedScrolls = 0;
+}
+
+void QSynEdit::finishPendingReparse()
+{
+    if (mReparseFrom>=0)
+        continueReparse(INT_MAX, 0);
+    if (mEditingCount==0 && useCodeFolding())
         rescanFolds();
-    return line;
+}
+
+void QSynEdit::onReparseTimeout()
+{
+    if (mReparseFrom<0) {
+        if (mEditingCount==0 && useCodeFolding())
+            rescanFolds();
+        return;
+    }
+    int fromLine = mReparseFrom;
+    int line = continueReparse(INT_MAX, 20);
+    if (mReparseFrom>=0) {
+        mReparseTimer->start(0);
+    } else if (mEditingCount==0 && useCodeFolding()) {
+        rescanFolds();
+    }
+    invalidateLines(fromLine+1, line+1);
 }
 
 // void QSynEdit::reparseLine(int line)
@@ -3307,6 +3519,9 @@ int QSynEdit::reparseLines(int startLine, int endLine)
 
 void QSynEdit::reparseDocument()
 {
+    mReparseFrom = -1;
+    mReparseTo = -1;
+    mReparseTimer->stop();
     if (!mDocument->empty()) {
 //        qint64 begin=QDateTime::currentMSecsSinceEpoch();
         mSyntaxer->resetState();
@@ -3319,6 +3534,7 @@ void QSynEdit::reparseDocument()
 
 //        qDebug()<<diff<<mDocument->count();
     }
+    mFullFoldRescan = true;
     if (useCodeFolding())
         rescanFolds();
 }
@@ -3327,6 +3543,7 @@ void QSynEdit::uncollapse(PCodeFoldingRange FoldRange)
 {
     FoldRange->linesCollapsed = 0;
     FoldRange->collapsed = false;
+    mCollapsedFoldIndex.invalidate();
 
     // Redraw the collapsed line
     invalidateLines(FoldRange->fromLine, INT_MAX);
@@ -3341,6 +3558,7 @@ void QSynEdit::collapse(PCodeFoldingRange FoldRange)
 {
     FoldRange->linesCollapsed = FoldRange->toLine - FoldRange->fromLine;
     FoldRange->collapsed = true;
+    mCollapsedFoldIndex.invalidate();
 
     // Extract caret from fold
     if ((mCaretY > FoldRange->fromLine) && (mCaretY <= FoldRange->toLine)) {
@@ -3360,30 +3578,53 @@ void QSynEdit::collapse(PCodeFoldingRange FoldRange)
 
 void QSynEdit::foldOnLinesInserted(int Line, int Count)
 {
+    mCollapsedFoldIndex.invalidate();
     // Delete collapsed inside selection
     for (int i = mAllFoldRanges->count()-1;i>=0;i--) {
         PCodeFoldingRange range = (*mAllFoldRanges)[i];
+        if (range->fromLine >= Line) {// insertion of count lines above FromLine
+            range->move(Count);
+            continue;
+        }
         if (range->fromLine == Line - 1) {// insertion starts at fold line
             if (range->collapsed)
                 uncollapse(range);
-        } else if (range->fromLine >= Line) // insertion of count lines above FromLine
-            range->move(Count);
+        }
+        if (range->closeLine >= Line - 1) { // fold contains the inserted lines
+            range->toLine += Count;
+            range->closeLine += Count;
+            if (range->collapsed)
+                range->linesCollapsed += Count;
+        }
     }
 }
 
 void QSynEdit::foldOnLinesDeleted(int Line, int Count)
 {
+    mCollapsedFoldIndex.invalidate();
     // Delete collapsed inside selection
     for (int i = mAllFoldRanges->count()-1;i>=0;i--) {
         PCodeFoldingRange range = (*mAllFoldRanges)[i];
         if (range->fromLine == Line && Count == 1)  {// open up because we are messing with the starting line
             if (range->collapsed)
                 uncollapse(range);
-        } else if (range->fromLine >= Line - 1 && range->fromLine < Line + Count) // delete inside affectec area
+            mFullFoldRescan = true;
+        } else if (range->fromLine >= Line - 1 && range->fromLine < Line + Count) {// delete inside affectec area
+            //mTopLevelFoldRanges is rebuilt by the full rescan
             mAllFoldRanges->remove(i);
-        else if (range->fromLine >= Line + Count) // Move after affected area
+            mFullFoldRescan = true;
+        } else if (range->fromLine >= Line + Count) // Move after affected area
             range->move(-Count);
-
+        else if (range->closeLine >= Line - 1) { // fold contains the deleted lines
+            if (range->closeLine < Line - 1 + Count) {
+                mFullFoldRescan = true;
+            } else {
+                range->toLine -= Count;
+                range->closeLine -= Count;
+                if (range->collapsed)
+                    range->linesCollapsed -= Count;
+            }
+        }
     }
 
 }
@@ -3391,21 +3632,40 @@ void QSynEdit::foldOnLinesDeleted(int Line, int Count)
 void QSynEdit::foldOnListCleared()
 {
     mAllFoldRanges->clear();
+    mTopLevelFoldRanges->clear();
+    mCollapsedFoldIndex.invalidate();
+    mFoldRescanFrom = -1;
+    mFoldRescanTo = -1;
+    mFullFoldRescan = false;
+}
+
+void QSynEdit::markFoldRescan(int startLine, int endLine)
+{
+    if (mFoldRescanFrom<0 || startLine<mFoldRescanFrom)
+        mFoldRescanFrom = startLine;
+    mFoldRescanTo = std::max(mFoldRescanTo, endLine);
 }
 
 void QSynEdit::rescanFolds()
 {
     if (!useCodeFolding())
         return;
+    if (!mFullFoldRescan && mFoldRescanFrom<0)
+        return;
 
     incPaintLock();
-    rescanForFoldRanges();
+    if (mFullFoldRescan || !rescanFoldRangesInLines(mFoldRescanFrom, mFoldRescanTo))
+        rescanForFoldRanges();
+    mFoldRescanFrom = -1;
+    mFoldRescanTo = -1;
+    mFullFoldRescan = false;
     invalidateGutter();
     decPaintLock();
 }
 
 void QSynEdit::rescanForFoldRanges()
 {
+    mCollapsedFoldIndex.invalidate();
     // Delete all uncollapsed folds
 //    for (int i=mAllFoldRanges.count()-1;i>=0;i--) {
 //        PSynEditFoldRange range =mAllFoldRanges[i];
@@ -3443,16 +3703,21 @@ void QSynEdit::rescanForFoldRanges()
         PCodeFoldingRanges temp{mAllFoldRanges};
         scanForFoldRanges(temp);
     }
+    mTopLevelFoldRanges->clear();
+    foreach (const PCodeFoldingRange& range, mAllFoldRanges->ranges()) {
+        if (!range->parent.lock())
+            mTopLevelFoldRanges->add(range);
+    }
 }
 
-void QSynEdit::scanForFoldRanges(PCodeFoldingRanges topFoldRanges)
+void QSynEdit::scanForFoldRanges(PCodeFoldingRanges topFoldRanges) const
 {
     PCodeFoldingRanges parentFoldRanges = topFoldRanges;
 
     findSubFoldRange(topFoldRanges, parentFoldRanges,PCodeFoldingRange());
 }
 
-void QSynEdit::findSubFoldRange(PCodeFoldingRanges topFoldRanges, PCodeFoldingRanges& parentFoldRanges, PCodeFoldingRange parent)
+void QSynEdit::findSubFoldRange(PCodeFoldingRanges topFoldRanges, PCodeFoldingRanges& parentFoldRanges, PCodeFoldingRange parent) const
 {
     PCodeFoldingRange  collapsedFold;
     int line = 0;
@@ -3474,6 +3739,7 @@ void QSynEdit::findSubFoldRange(PCodeFoldingRanges topFoldRanges, PCodeFoldingRa
                         parent->toLine = line;
                     else
                         parent->toLine = line + 1;
+                    parent->closeLine = line;
                     parent = parent->parent.lock();
                     if (!parent) {
                         parentFoldRanges = topFoldRanges;
@@ -3498,6 +3764,188 @@ void QSynEdit::findSubFoldRange(PCodeFoldingRanges topFoldRanges, PCodeFoldingRa
     }
 }
 
+bool QSynEdit::rescanFoldRangesInLines(int startLine, int endLine)
+{
+    if (mDocument->empty()) {
+        mAllFoldRanges->clear();
+        mTopLevelFoldRanges->clear();
+        return true;
+    }
+    startLine = std::min(startLine, mDocument->count()-1);
+    endLine = std::max(startLine+1, std::min(endLine, mDocument->count()));
+
+    // Lines before startLine and after endLine are not changed, so only sub ranges of
+    // the deepest fold that is opened before startLine and closed after endLine need rescan.
+    PCodeFoldingRange parent;
+    PCodeFoldingRanges children = mTopLevelFoldRanges;
+    while (true) {
+        // children don't overlap, so only the last one opened before startLine may contain the lines
+        int i = children->upperBound(startLine) - 1;
+        if (i<0 || children->range(i)->closeLine < endLine)
+            break;
+        parent = children->range(i);
+        children = parent->subFoldRanges;
+    }
+    // If the parent's own block is changed, try its parent
+    while (!rescanSubFoldRanges(parent, startLine, endLine)) {
+        if (!parent)
+            return false;
+        parent = parent->parent.lock();
+    }
+    mCollapsedFoldIndex.invalidate();
+    return true;
+}
+
+bool QSynEdit::rescanSubFoldRanges(PCodeFoldingRange parent, int startLine, int endLine)
+{
+    PCodeFoldingRanges siblings = parent?parent->subFoldRanges:mTopLevelFoldRanges;
+    QVector<PCodeFoldingRange> children = siblings->ranges();
+    // skip children that are closed before startLine (children don't overlap, so they are the first ones)
+    int first = std::partition_point(children.constBegin(), children.constEnd(),
+                                     [startLine](const PCodeFoldingRange& range) {
+        return range->fromLine - 1 < startLine
+                && range->closeLine >= 0
+                && range->closeLine < startLine;
+    }) - children.constBegin();
+    int scanFrom = startLine;
+    int parentsOpenedAtScanFrom = 0;
+    if (first<children.count() && children[first]->fromLine - 1 < startLine) {
+        // the child is opened before startLine, rescan from its start
+        scanFrom = children[first]->fromLine - 1;
+        PCodeFoldingRange p = parent;
+        while (p && p->fromLine - 1 == scanFrom) {
+            parentsOpenedAtScanFrom++;
+            p = p->parent.lock();
+        }
+    }
+
+    QVector<PCodeFoldingRange> newChildren;
+    QVector<PCodeFoldingRange> newRanges;
+    PCodeFoldingRange current = parent;
+    int depth = 0;
+    int last = first;
+    int line = scanFrom;
+    bool reachEnd = true;
+    while (line < mDocument->count()) {
+        int blockEnded=mDocument->blockEnded(line);
+        int blockStarted=mDocument->blockStarted(line);
+        int foldsToOpen = blockStarted;
+        if (line == scanFrom && scanFrom < startLine) {
+            // blocks closed in this line are before the first child
+            blockEnded = 0;
+            foldsToOpen -= parentsOpenedAtScanFrom;
+        }
+        for (int i=0; i<blockEnded;i++) {
+            if (depth>0) {
+                if (blockStarted>0)
+                    current->toLine = line;
+                else
+                    current->toLine = line + 1;
+                current->closeLine = line;
+                current = current->parent.lock();
+                depth--;
+            } else if (parent) {
+                // parent is closed here
+                return false;
+            }
+        }
+        if (parent && parent->closeLine >= 0 && line >= parent->closeLine) {
+            // parent is not closed at its old close line anymore
+            return false;
+        }
+        for (int i=0; i<foldsToOpen;i++) {
+            PCodeFoldingRange range = std::make_shared<CodeFoldingRange>(current, line + 1, line + 1);
+            if (depth == 0)
+                newChildren.append(range);
+            else
+                current->subFoldRanges->add(range);
+            newRanges.append(range);
+            current = range;
+            depth++;
+        }
+        if (depth == 0 && line >= endLine - 1) {
+            // stop if the line is not inside old children neither
+            while (last<children.count()
+                   && children[last]->closeLine >= 0
+                   && children[last]->closeLine <= line)
+                last++;
+            if (last>=children.count() || children[last]->fromLine - 1 > line) {
+                reachEnd = false;
+                break;
+            }
+        }
+        line++;
+    }
+    if (reachEnd) {
+        // parent is not closed anymore
+        if (parent)
+            return false;
+        last = children.count();
+    }
+
+    // collect the old ranges to be replaced
+    QSet<CodeFoldingRange*> oldRanges;
+    QMap<QString,PCodeFoldingRange> collapsedRanges;
+    QVector<PCodeFoldingRange> stack;
+    for (int i=first;i<last;i++)
+        stack.append(children[i]);
+    while (!stack.isEmpty()) {
+        PCodeFoldingRange range = stack.takeLast();
+        oldRanges.insert(range.get());
+        if (range->collapsed)
+            collapsedRanges.insert(QString("%1-%2").arg(range->fromLine).arg(range->toLine),range);
+        foreach (const PCodeFoldingRange& subRange, range->subFoldRanges->ranges())
+            stack.append(subRange);
+    }
+    foreach (const PCodeFoldingRange& range, newRanges) {
+        PCodeFoldingRange oldRange = collapsedRanges.value(QString("%1-%2").arg(range->fromLine).arg(range->toLine),
+                                                           PCodeFoldingRange());
+        if (oldRange) {
+            range->collapsed=true;
+            range->linesCollapsed=range->toLine - range->fromLine;
+        }
+    }
+
+    // the old ranges are contiguous in mAllFoldRanges (sorted by line, parents before children)
+    int index = (first<last) ? mAllFoldRanges->indexOf(children[first]) : mAllFoldRanges->upperBound(scanFrom + 1);
+    if (index<0)
+        return false;
+    // splice new ranges into the tree
+    children.clear(); // don't copy the siblings when they are changed
+    siblings->replace(first, last-first, newChildren);
+    mAllFoldRanges->replace(index, oldRanges.count(), newRanges);
+    return true;
+}
+
+bool QSynEdit::foldRangesMatchFullRescan() const
+{
+    PCodeFoldingRanges ranges = std::make_shared<CodeFoldingRanges>();
+    scanForFoldRanges(ranges);
+    if (ranges->count() != mAllFoldRanges->count())
+        return false;
+    int topLevelCount = 0;
+    for (int i=0;i<ranges->count();i++) {
+        PCodeFoldingRange expected = ranges->range(i);
+        PCodeFoldingRange range = mAllFoldRanges->range(i);
+        PCodeFoldingRange expectedParent = expected->parent.lock();
+        PCodeFoldingRange parent = range->parent.lock();
+        if (range->fromLine != expected->fromLine
+                || range->toLine != expected->toLine
+                || range->closeLine != expected->closeLine
+                || range->subFoldRanges->count() != expected->subFoldRanges->count()
+                || (parent?parent->fromLine:0) != (expectedParent?expectedParent->fromLine:0)
+                || (range->collapsed && range->linesCollapsed != range->toLine - range->fromLine))
+            return false;
+        if (!parent) {
+            if (topLevelCount >= mTopLevelFoldRanges->count()
+                    || mTopLevelFoldRanges->range(topLevelCount) != range)
+                return false;
+            topLevelCount++;
+        }
+    }
+    return topLevelCount == mTopLevelFoldRanges->count();
+}
+
 PCodeFoldingRange QSynEdit::collapsedFoldStartAtLine(int Line)
 {
     for (int i = 0; i< mAllFoldRanges->count() - 1; i++ ) {
@@ -3714,6 +4162,7 @@ EditCommand QSynEdit::TranslateKeyCode(int key, Qt::KeyboardModifiers modifiers)
 
 void QSynEdit::onSizeOrFontChanged()
 {
+    mRenderCache.clear();
     mLinesInWindow = clientHeight() / mTextHeight;
     if (mGutter.showLineNumbers())
         onGutterChanged();
@@ -3735,8 +4184,10 @@ void QSynEdit::onHScrolled(int value)
 
 void QSynEdit::onVScrolled(int value)
 {
+    int dy = mTopPos - value;
     mTopPos = value;
-    invalidate();
+    if (!scrollContentImage(dy))
+        invalidate();
 }
 
 
@@ -4681,7 +5132,7 @@ void QSynEdit::setSyntaxer(const PSyntaxer &syntaxer)
         mDocument->endUpdate();
     }
     mDocument->invalidateAllNonTempLineWidth();
-    invalidate();
+    invalidateRenderedLines();
 }
 
 const PDocument& QSynEdit::document() const
@@ -5822,8 +6273,8 @@ void QSynEdit::beginEditingWithoutUndo()
 void QSynEdit::endEditingWithoutUndo()
 {
     mEditingCount--;
-    if (mEditingCount==0)
-        reparseDocument();
+    if (mEditingCount==0 && mReparseFrom<0 && useCodeFolding())
+        rescanFolds();
 }
 
 bool QSynEdit::isIdentChar(const QChar &ch)
@@ -5894,6 +6345,8 @@ void QSynEdit::paintEvent(QPaintEvent *event)
         painter.drawImage(rcCaret,*mContentImage,cacheRC);
     } else {
         //qDebug()<<"paint event:"<<QDateTime::currentDateTime()<<rcClip;
+        QElapsedTimer frameTimer;
+        frameTimer.start();
         QRect rcDraw;
         int nL1, nL2, nX1, nX2;
         // Compute the invalid area in lines / columns.
@@ -5908,6 +6361,10 @@ void QSynEdit::paintEvent(QPaintEvent *event)
 
         //qDebug()<<"Paint:"<<nL1<<nL2<<nC1<<nC2;
 
+        //lines to be painted must have up-to-date syntax states
+        if (mReparseFrom>=0 && mReparseFrom < rowToLine(nL2))
+            continueReparse(rowToLine(nL2), 0);
+
         QPainter cachePainter(mContentImage.get());
         cachePainter.setFont(font());
         QSynEditPainter textPainter(this, &cachePainter,
@@ -5938,6 +6395,13 @@ void QSynEdit::paintEvent(QPaintEvent *event)
         painter.drawImage(rcClip,*mContentImage,cacheRC);
         //glyph positions may be updated while painting, so we need to recalc here.
         rcCaret = calculateCaretRect();
+        trimRenderCache();
+
+        qint64 frameTime = frameTimer.nsecsElapsed() / 1000;
+        mPaintStatistics.frames++;
+        mPaintStatistics.lastFrameTime = frameTime;
+        mPaintStatistics.maxFrameTime = std::max(mPaintStatistics.maxFrameTime, frameTime);
+        mPaintStatistics.totalFrameTime += frameTime;
     }
     paintCaret(painter, rcCaret);
 }
@@ -6508,9 +6972,15 @@ void QSynEdit::onLinesChanging()
 
 void QSynEdit::onLinesCleared()
 {
+    mReparseFrom = -1;
+    mReparseTo = -1;
+    mReparseTimer->stop();
     if (useCodeFolding())
         foldOnListCleared();
+    else
+        mFullFoldRescan = true;
     clearUndo();
+    mRenderCache.clear();
     // invalidate the *whole* client area
     invalidate();
     // set caret and selected block to start of text
@@ -6523,8 +6993,19 @@ void QSynEdit::onLinesCleared()
 
 void QSynEdit::onLinesDeleted(int line, int count)
 {
+    if (mReparseFrom>line)
+        mReparseFrom = std::max(line, mReparseFrom-count);
+    if (mReparseTo>line)
+        mReparseTo = std::max(line, mReparseTo-count);
+    if (mFoldRescanFrom>line)
+        mFoldRescanFrom = std::max(line, mFoldRescanFrom-count);
+    if (mFoldRescanTo>line)
+        mFoldRescanTo = std::max(line, mFoldRescanTo-count);
     if (useCodeFolding())
         foldOnLinesDeleted(line + 1, count);
+    else
+        mFullFoldRescan = true;
+    markFoldRescan(line, line + 1);
     if (mSyntaxer->needsLineState()) {
         reparseLines(line, line + 1);
     }
@@ -6533,8 +7014,19 @@ void QSynEdit::onLinesDeleted(int line, int count)
 
 void QSynEdit::onLinesInserted(int line, int count)
 {
+    if (mReparseFrom>=line)
+        mReparseFrom += count;
+    if (mReparseTo>=line)
+        mReparseTo += count;
+    if (mFoldRescanFrom>=line)
+        mFoldRescanFrom += count;
+    if (mFoldRescanTo>=line)
+        mFoldRescanTo += count;
     if (useCodeFolding())
         foldOnLinesInserted(line + 1, count);
+    else
+        mFullFoldRescan = true;
+    markFoldRescan(line, line + count);
     if (mSyntaxer->needsLineState()) {
         reparseLines(line, line + count);
     } else {
@@ -21,6 +21,8 @@
 #include <QCursor>
 #include <QDateTime>
 #include <QFrame>
+#include <QHash>
+#include <QStaticText>
 #include <QStringList>
 #include <QTimer>
 #include <QWidget>
@@ -130,6 +132,41 @@ struct GlyphPostionsListCache {
     int strWidth;
 };
 
+/**
+ * @brief a glyph run drawn by the painter, and its prepared layout
+ */
+struct RenderedGlyphRun {
+    QString text;
+    QFont font;
+    QStaticText staticText;
+};
+
+/**
+ * @brief glyph runs painted on a line
+ *
+ * The runs are reused only if the line is painted from the same syntax state, and
+ * each run has the same text and font. Colors are not part of the prepared runs
+ * (they are drawn with the painter's pen).
+ */
+struct RenderedLine {
+    int startSyntaxStateId = -1; // id of the syntax state of the previous line (see Document::syntaxStateId())
+    QVector<RenderedGlyphRun> runs;
+};
+
+/**
+ * @brief frame times of the editor, and how many glyph runs are painted from the render cache
+ *
+ * Times are in microseconds.
+ */
+struct PaintStatistics {
+    int frames;
+    qint64 lastFrameTime;
+    qint64 maxFrameTime;
+    qint64 totalFrameTime;
+    int cachedRuns;
+    int preparedRuns;
+    int blittedScrolls;
+};
 
 class QSynEdit;
 using PSynEdit = std::shared_ptr<QSynEdit>;
@@ -212,6 +249,12 @@ public:
     void setExtraKeystrokes();
     void invalidateLine(int line);
     void invalidateLines(int firstLine, int lastLine);
+    /**
+     * @brief repaint all lines, and lay out their glyph runs again
+     *
+     * Call it after the syntaxer's token attributes are changed (e.g. a new color scheme).
+     */
+    void invalidateRenderedLines();
     void invalidateSelection();
     void invalidateRect(const QRect& rect);
     void invalidate();
@@ -381,6 +424,22 @@ public:
 
     QStringList getContent(BufferCoord startPos, BufferCoord endPos, SelectionMode mode) const;
     void reparseDocument();
+    /**
+     * @brief finish the pending (time-sliced) syntax state rescan and fold rescan right now
+     *
+     * Only lines around the viewport are rescanned immediately after an edit.
+     * Call this before reading syntax states of lines far from the viewport, or fold ranges.
+     */
+    void finishPendingReparse();
+    /**
+     * @brief check the fold ranges against a full rescan of the document
+     *
+     * Used by tests of the incremental fold rescan, it rescans the whole document.
+     */
+    bool foldRangesMatchFullRescan() const;
+
+    const PaintStatistics& paintStatistics() const;
+    void resetPaintStatistics();
 
     QString lineBreak() const;
 
@@ -413,6 +472,12 @@ public:
 
     bool canUndo() const;
     bool canRedo() const;
+    /**
+     * @brief bytes used by the undo and redo history
+     */
+    qint64 undoMemoryUsage() const;
+    qint64 maxUndoMemoryUsage() const;
+    void setMaxUndoMemoryUsage(qint64 bytes);
 
     int textHeight() const;
 
@@ -508,6 +573,9 @@ private:
     void computeScroll(bool isDragging);
 
     void synFontChanged();
+    void invalidateRenderCache(int firstLine, int lastLine);
+    void trimRenderCache();
+    bool scrollContentImage(int dy);
 
     void doSetSelText(const QString& value);
 
@@ -529,6 +597,8 @@ private:
     void recalcCharExtent();
     void updateModifiedStatus();
     int reparseLines(int startLine, int endLine);
+    int continueReparse(int lineLimit, int timeLimit);
+    int visibleLineLimit() const;
     //void reparseLine(int line);
     void uncollapse(PCodeFoldingRange FoldRange);
     void collapse(PCodeFoldingRange FoldRange);
@@ -538,8 +608,11 @@ private:
     void foldOnListCleared();
     void rescanFolds(); // rescan for folds
     void rescanForFoldRanges();
-    void scanForFoldRanges(PCodeFoldingRanges topFoldRanges);
-    void findSubFoldRange(PCodeFoldingRanges topFoldRanges,PCodeFoldingRanges& parentFoldRanges, PCodeFoldingRange Parent);
+    bool rescanFoldRangesInLines(int startLine, int endLine);
+    bool rescanSubFoldRanges(PCodeFoldingRange parent, int startLine, int endLine);
+    void markFoldRescan(int startLine, int endLine);
+    void scanForFoldRanges(PCodeFoldingRanges topFoldRanges) const;
+    void findSubFoldRange(PCodeFoldingRanges topFoldRanges,PCodeFoldingRanges& parentFoldRanges, PCodeFoldingRange Parent) const;
     PCodeFoldingRange collapsedFoldStartAtLine(int Line);
     void initializeCaret();
     PCodeFoldingRange foldStartAtLine(int Line) const;
@@ -656,6 +729,7 @@ private slots:
     //void onRedoAdded();
     void onScrollTimeout();
     void onDraggingScrollTimeout();
+    void onReparseTimeout();
     void onUndoAdded();
     void onSizeOrFontChanged();
     void onChanged();
@@ -664,7 +738,12 @@ private slots:
 
 private:
     std::shared_ptr<QImage> mContentImage;
-    PCodeFoldingRanges mAllFoldRanges;
+    PCodeFoldingRanges mAllFoldRanges; // all fold ranges, sorted by fromLine
+    PCodeFoldingRanges mTopLevelFoldRanges; // fold ranges without parent
+    mutable CollapsedFoldIndex mCollapsedFoldIndex;
+    int mFoldRescanFrom; // first line changed after the last fold rescan, -1 if none
+    int mFoldRescanTo;
+    bool mFullFoldRescan; // fold ranges are out of sync with lines, must be fully rescanned
     CodeFoldingOptions mCodeFolding;
     int mEditingCount;
     bool mUseCodeFolding;
@@ -723,6 +802,9 @@ private:
     int mLastKey;
     Qt::KeyboardModifiers mLastKeyModifiers;
     QTimer*  mScrollTimer;
+    QTimer*  mReparseTimer;
+    int mReparseFrom; // first line whose syntax state is not up to date, -1 if none
+    int mReparseTo; // syntax states can't converge before this line
 
     PSynEdit  fChainedEditor;
 
@@ -751,6 +833,8 @@ private:
 
     PFormatter mFormatter;
     GlyphPostionsListCache mGlyphPostionCacheForInputMethod;
+    QHash<int,RenderedLine> mRenderCache; // glyph runs painted on each line, keyed by line (1-based)
+    PaintStatistics mPaintStatistics;
 
 friend class QSynEditPainter;
 
@@ -15,12 +15,13 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 #include "basicsearcher.h"
+#include <algorithm>
 
 namespace QSynedit {
 
 BasicSearcher::BasicSearcher(QObject *parent):BaseSearcher(parent)
 {
-
+    compilePattern();
 }
 
 int BasicSearcher::length(int aIndex)
@@ -45,35 +46,66 @@ int BasicSearcher::resultCount()
 int BasicSearcher::findAll(const QString &text)
 {
     mResults.clear();
-    if (pattern().isEmpty())
+    int patternLen = mFoldedPattern.length();
+    int textLen = text.length();
+    if (patternLen==0 || textLen<patternLen)
         return 0;
-    int start=0;
-    int next=-1;
-    while (true) {
-        if (options().testFlag(ssoMatchCase)) {
-            next = text.indexOf(pattern(),start,Qt::CaseSensitive);
-        } else {
-            next = text.indexOf(pattern(),start,Qt::CaseInsensitive);
-        }
-        if (next<0) {
-            break;
-        }
-        start = next + pattern().length();
-        if (options().testFlag(ssoWholeWord)) {
-            if (((next<=0) || isDelimitChar(text[next-1]))
-                    &&
-                    ( (start>=text.length()) || isDelimitChar(text[start]) )
-                 ) {
-                mResults.append(next);
+    // Boyer-Moore-Horspool: compare the last char of the window first,
+    // and skip by the table when it doesn't match.
+    // Chars are case folded one by one, so no lowered copy of the text is needed.
+    const QChar* t = text.constData();
+    const QChar* p = mFoldedPattern.constData();
+    int last = patternLen - 1;
+    bool wholeWord = options().testFlag(ssoWholeWord);
+    int pos = 0;
+    while (pos <= textLen - patternLen) {
+        QChar ch = foldCase(t[pos+last]);
+        if (ch == p[last]) {
+            int i = 0;
+            while (i<last && foldCase(t[pos+i]) == p[i])
+                i++;
+            if (i==last) {
+                int end = pos + patternLen;
+                if (!wholeWord
+                        || (((pos==0) || isDelimitChar(t[pos-1]))
+                            && ((end>=textLen) || isDelimitChar(t[end])))) {
+                    mResults.append(pos);
+                }
+                pos = end;
+                continue;
             }
-        } else {
-            mResults.append(next);
         }
-
+        pos += mSkipTable[ch.unicode() & 0xFF];
     }
     return mResults.size();
 }
 
+void BasicSearcher::setPattern(const QString &value)
+{
+    BaseSearcher::setPattern(value);
+    compilePattern();
+}
+
+void BasicSearcher::setOptions(const SearchOptions &options)
+{
+    BaseSearcher::setOptions(options);
+    compilePattern();
+}
+
+void BasicSearcher::compilePattern()
+{
+    mCaseSensitive = options().testFlag(ssoMatchCase);
+    QString s = pattern();
+    mFoldedPattern.resize(s.length());
+    for (int i=0;i<s.length();i++)
+        mFoldedPattern[i] = foldCase(s[i]);
+    int patternLen = mFoldedPattern.length();
+    for (int i=0;i<256;i++)
+        mSkipTable[i] = std::max(patternLen,1);
+    for (int i=0;i<patternLen-1;i++)
+        mSkipTable[mFoldedPattern[i].unicode() & 0xFF] = patternLen - 1 - i;
+}
+
 QString BasicSearcher::replace(const QString &, const QString &aReplacement)
 {
     return aReplacement;
@@ -33,8 +33,24 @@ public:
     int resultCount() override;
     int findAll(const QString &text) override;
     QString replace(const QString &aOccurrence, const QString &aReplacement) override;
+    void setPattern(const QString &value) override;
+    void setOptions(const SearchOptions &options) override;
+private:
+    void compilePattern();
+    QChar foldCase(QChar ch) const {
+        return mCaseSensitive?ch:ch.toCaseFolded();
+    }
 private:
     QList<int> mResults;
+    /**
+     * @brief the (case folded if not match case) pattern and its Horspool skip table
+     *
+     * The table is indexed by the low byte of a char, so chars sharing the low
+     * byte share the smallest skip, which is always safe.
+     */
+    QString mFoldedPattern;
+    int mSkipTable[256];
+    bool mCaseSensitive;
 };
 }
 
@@ -156,7 +156,7 @@ TokenAttribute::TokenAttribute(const QString &name, TokenType tokenType):
 
 }
 
-bool SyntaxState::operator==(const SyntaxState &s2)
+bool SyntaxState::operator==(const SyntaxState &s2) const
 {
     // indents contains the information of brace/parenthesis/brackets embedded levels
     return (state == s2.state)
@@ -169,10 +169,33 @@ bool SyntaxState::operator==(const SyntaxState &s2)
             && (parenthesisLevel == s2.parenthesisLevel) // current parenthesis embedding level (needed by rainbow color)
             && (indents == s2.indents)
             && (lastUnindent == s2.lastUnindent)
+            && (hasTrailingSpaces == s2.hasTrailingSpaces)
             && (extraData == s2.extraData)
             ;
 }
 
+uint qHash(const SyntaxState &state, uint seed)
+{
+    //extraData is not hashed, it's only compared by operator==
+    uint h = seed;
+    h = h*31 + uint(state.state);
+    h = h*31 + uint(state.blockLevel);
+    h = h*31 + uint(state.blockStarted);
+    h = h*31 + uint(state.blockEnded);
+    h = h*31 + uint(state.blockEndedLastLine);
+    h = h*31 + uint(state.braceLevel);
+    h = h*31 + uint(state.bracketLevel);
+    h = h*31 + uint(state.parenthesisLevel);
+    foreach (const IndentInfo& indent, state.indents) {
+        h = h*31 + uint(indent.type);
+        h = h*31 + uint(indent.line);
+    }
+    h = h*31 + uint(state.lastUnindent.type);
+    h = h*31 + uint(state.lastUnindent.line);
+    h = h*31 + uint(state.hasTrailingSpaces);
+    return h;
+}
+
 IndentInfo SyntaxState::getLastIndent()
 {
     if (indents.isEmpty())
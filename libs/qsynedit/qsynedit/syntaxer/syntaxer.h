@@ -59,12 +59,14 @@ struct SyntaxState {
     bool hasTrailingSpaces;
     QMap<QString,QVariant> extraData;
 
-    bool operator==(const SyntaxState& s2);
+    bool operator==(const SyntaxState& s2) const;
     IndentInfo getLastIndent();
     IndentType getLastIndentType();
     SyntaxState();
 };
 
+uint qHash(const SyntaxState& state, uint seed = 0);
+
 enum class TokenType {
     Default,
     Comment, // any comment
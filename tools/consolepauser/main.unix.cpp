@@ -32,12 +32,17 @@ using std::vector;
 #include <sys/time.h>
 #include <sys/resource.h>
 #include <sys/wait.h>
+#ifdef __linux__
+#include <signal.h>
+#include <sys/prctl.h>
+#endif
 #define MAX_COMMAND_LENGTH 32768
 #define MAX_ERROR_LENGTH 2048
 
 enum RunProgramFlag {
     RPF_PAUSE_CONSOLE =     0x0001,
-    RPF_REDIRECT_INPUT =    0x0002
+    RPF_REDIRECT_INPUT =    0x0002,
+    RPF_REPORT_USAGE =      0x0004
 };
 
 
@@ -86,54 +91,55 @@ string unescapeSpaces(const string& s) {
     return result;
 }
 
+void RunProgram(vector<string>& command,bool reInp) {
+    string path_to_command;
+    char * * argv;
+    int command_begin;
+    int command_size;
+    if (reInp) {
+        if (command.size()<2) {
+            fprintf(stderr,"not enough arguments1!\n");
+            exit(-1);
+        }
+        freopen(unescapeSpaces(command[0]).c_str(),"r",stdin);
+        path_to_command = unescapeSpaces(command[1]);
+        command_size = command.size()+1;
+        command_begin = 1;
+    } else {
+        if (command.size()<1) {
+            fprintf(stderr,"not enough arguments2!\n");
+            exit(-1);
+        }
+        path_to_command = unescapeSpaces(command[0]);
+        command_size = command.size()+1;
+        command_begin = 0;
+    }
+    argv = (char * *)malloc(sizeof(char *)*command_size);
+    for (size_t i=command_begin;i<command.size();i++) {
+        argv[i-command_begin] = (char *)command[i].c_str();
+    }
+    argv[command.size()-command_begin]=NULL;
+    //child process
+    int pos = path_to_command.find_last_of('/');
+    std::string file = path_to_command;
+    if (pos>=0) {
+        file = path_to_command.substr(pos+1);
+    }
+    argv[0]=(char *)file.c_str();
+    execv(path_to_command.c_str(),argv);
+    fprintf(stderr,"Failed to start command %s %s!\n",path_to_command.c_str(), file.c_str());
+    fprintf(stderr,"errno %d: %s\n",errno,strerror(errno));
+    char* current_dir = getcwd(nullptr, 0);
+    fprintf(stderr,"current dir: %s",current_dir);
+    free(current_dir);
+    exit(-1);
+}
+
 int ExecuteCommand(vector<string>& command,bool reInp, long int &peakMemory) {
     peakMemory = 0;
     pid_t pid = fork();
     if (pid == 0) {
-        string path_to_command;
-        char * * argv;
-        int command_begin;
-        int command_size;
-        if (reInp) {
-            if (command.size()<2) {
-                fprintf(stderr,"not enough arguments1!\n");
-                exit(-1);
-            }
-            freopen(unescapeSpaces(command[0]).c_str(),"r",stdin);
-            path_to_command = unescapeSpaces(command[1]);
-            command_size = command.size()+1;
-            command_begin = 1;
-        } else {
-            if (command.size()<1) {
-                fprintf(stderr,"not enough arguments2!\n");
-                exit(-1);
-            }
-            path_to_command = unescapeSpaces(command[0]);
-            command_size = command.size()+1;
-            command_begin = 0;
-        }
-        argv = (char * *)malloc(sizeof(char *)*command_size);
-        for (size_t i=command_begin;i<command.size();i++) {
-            argv[i-command_begin] = (char *)command[i].c_str();
-        }
-        argv[command.size()-command_begin]=NULL;
-        //child process
-        int pos = path_to_command.find_last_of('/');
-        std::string file = path_to_command;
-        if (pos>=0) {
-            file = path_to_command.substr(pos+1);
-        }
-        argv[0]=(char *)file.c_str();
-        int result=execv(path_to_command.c_str(),argv);
-        if (result) {
-            fprintf(stderr,"Failed to start command %s %s!\n",path_to_command.c_str(), file.c_str());
-            fprintf(stderr,"errno %d: %s\n",errno,strerror(errno));
-            char* current_dir = getcwd(nullptr, 0);
-            fprintf(stderr,"current dir: %s",current_dir);
-            free(current_dir);
-            exit(-1);
-        }
-        free(argv);
+        RunProgram(command, reInp);
     } else {
         int status;
         pid_t w;
@@ -153,6 +159,113 @@ int ExecuteCommand(vector<string>& command,bool reInp, long int &peakMemory) {
     return 0;
 }
 
+#ifdef __linux__
+//value of the key in a cgroup file like memory.events, -1 if not found
+long long CGroupValue(const string& fileName, const string& key) {
+    FILE* file = fopen(fileName.c_str(),"r");
+    if (!file)
+        return -1;
+    char line[256];
+    long long value = -1;
+    while (fgets(line,sizeof(line),file)) {
+        if (strncmp(line,key.c_str(),key.length())==0 && line[key.length()]==' ') {
+            value = atoll(line+key.length()+1);
+            break;
+        }
+    }
+    fclose(file);
+    return value;
+}
+
+//directory of the (v2) cgroup we are in, empty if not found
+string CGroupDir() {
+    FILE* file = fopen("/proc/self/cgroup","r");
+    if (!file)
+        return string();
+    char line[4096];
+    string dir;
+    while (fgets(line,sizeof(line),file)) {
+        if (strncmp(line,"0::",3)==0) {
+            dir = string("/sys/fs/cgroup") + (line+3);
+            while (!dir.empty() && dir.back()=='\n')
+                dir.pop_back();
+            break;
+        }
+    }
+    fclose(file);
+    return dir;
+}
+#endif
+
+/*
+ * Used by the problem case runner of Red Panda C++, which can't get the resource usage of
+ * the program by itself: a child forked from the (large) ide inherits its peak rss.
+ * Run the program, and write its pid and then its resource usage to the report file:
+ *   pid <pid>
+ *   cpu_usec <user+system time in microseconds>
+ *   max_rss_kb <peak resident memory in KB>
+ *   oom_kill <number of processes killed by the oom killer in our cgroup>
+ * oom_kill is written only on linux with cgroup v2, and is only meaningful when we are
+ * run in our own cgroup (like a scope created by systemd-run).
+ * Nothing else is printed, and we exit with the program's exit code.
+ */
+int RunAndReportUsage(vector<string>& command, const char* reportFileName) {
+    FILE* report = fopen(reportFileName,"w");
+    if (!report) {
+        fprintf(stderr,"Can't open report file %s: %s\n",reportFileName,strerror(errno));
+        return 127;
+    }
+    fcntl(fileno(report),F_SETFD,FD_CLOEXEC);
+#ifdef __linux__
+    pid_t parentPid = getpid();
+#endif
+    pid_t pid = fork();
+    if (pid == -1) {
+        fprintf(stderr,"fork failed %d:%s\n",errno,strerror(errno));
+        return 127;
+    }
+    if (pid == 0) {
+#ifdef __linux__
+        //the program is killed with us (when it's out of the time limit, or stopped by the user)
+        prctl(PR_SET_PDEATHSIG, SIGKILL);
+        if (getppid()!=parentPid)
+            _exit(127);
+#endif
+        RunProgram(command, false);
+    }
+    fprintf(report,"pid %d\n",(int)pid);
+    fflush(report);
+    int status;
+    struct rusage usage;
+    while (wait4(pid, &status, 0, &usage)==-1) {
+        if (errno!=EINTR) {
+            fprintf(stderr,"wait4 failed %d:%s\n",errno,strerror(errno));
+            return 127;
+        }
+    }
+    long long cpuTime = (long long)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000
+            + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+#ifdef __APPLE__
+    long long maxRSS = usage.ru_maxrss / 1024; //in bytes on macOS
+#else
+    long long maxRSS = usage.ru_maxrss;
+#endif
+    fprintf(report,"cpu_usec %lld\n",cpuTime);
+    fprintf(report,"max_rss_kb %lld\n",maxRSS);
+#ifdef __linux__
+    string cgroupDir = CGroupDir();
+    if (!cgroupDir.empty()) {
+        long long oomKill = CGroupValue(cgroupDir+"/memory.events","oom_kill");
+        if (oomKill>=0)
+            fprintf(report,"oom_kill %lld\n",oomKill);
+    }
+#endif
+    fclose(report);
+    if (WIFEXITED(status))
+        return WEXITSTATUS(status);
+    return 128+WTERMSIG(status);
+}
+
 int main(int argc, char** argv) {
     char* sharedMemoryId;
     // First make sure we aren't going to read nonexistent arrays
@@ -163,6 +276,13 @@ int main(int argc, char** argv) {
         PauseExit(EXIT_SUCCESS,false);
     }
 
+    if (atoi(argv[1]) & RPF_REPORT_USAGE) {
+        bool reInp;
+        bool pauseAfterExit;
+        vector<string> command = GetCommand(argc,argv,reInp,pauseAfterExit);
+        return RunAndReportUsage(command,argv[2]);
+    }
+
     // Make us look like the paused program
     //SetConsoleTitleA(argv[3]);
     sharedMemoryId = argv[2];